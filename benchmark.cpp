@@ -0,0 +1,143 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <iomanip>
+
+namespace {
+
+/**
+ * @brief Наблюдатель, относящий приращения счётчиков к этапам запроса.
+ */
+class PhaseCounterObserver : public SearchServer::QueryPhaseObserver {
+public:
+    PhaseCounterObserver(const PerfCounters& counters, BenchmarkReport& report)
+            : counters_(counters)
+            , report_(report) {
+    }
+
+    /**
+     * @brief Запоминает значения счётчиков перед запросом.
+     */
+    void Start() {
+        last_ = counters_.Read();
+    }
+
+    void OnPhaseEnd(SearchServer::QueryPhase phase) override {
+        const PerfSample now = counters_.Read();
+        report_.phases[static_cast<size_t>(phase)] += now - last_;
+        last_ = now;
+    }
+
+    void OnQueryEnd(size_t postings_scanned, size_t candidates_scored) override {
+        report_.postings_scanned += postings_scanned;
+        report_.candidates_scored += candidates_scored;
+    }
+
+private:
+    const PerfCounters& counters_;  ///< Счётчики.
+    BenchmarkReport& report_;       ///< Заполняемый результат.
+    PerfSample last_;               ///< Значения счётчиков на последней границе этапа.
+};
+
+/**
+ * @brief Устанавливает наблюдатель этапов запросов потока на время своей жизни.
+ * @details Наблюдатель снимается и при исключении из запроса, иначе поток сохранил бы
+ *          указатель на уничтоженный объект.
+ */
+class ScopedQueryPhaseObserver {
+public:
+    explicit ScopedQueryPhaseObserver(SearchServer::QueryPhaseObserver* observer) {
+        SearchServer::SetQueryPhaseObserver(observer);
+    }
+
+    ScopedQueryPhaseObserver(const ScopedQueryPhaseObserver&) = delete;
+    ScopedQueryPhaseObserver& operator=(const ScopedQueryPhaseObserver&) = delete;
+
+    ~ScopedQueryPhaseObserver() {
+        SearchServer::SetQueryPhaseObserver(nullptr);
+    }
+};
+
+/**
+ * @brief Выводит значение счётчика или n/a, если он недоступен.
+ */
+void PrintValue(std::ostream& out, bool available, double value) {
+    if (available) {
+        out << std::setw(16) << value;
+    } else {
+        out << std::setw(16) << "n/a";
+    }
+}
+
+} // namespace
+
+/**
+ * @brief Выполняет запросы FindTopDocuments и собирает счётчики производительности.
+ * @param name Название замера.
+ * @param search_server Поисковый сервер.
+ * @param queries Запросы.
+ * @param repetitions Количество проходов по запросам.
+ * @return Результат замера.
+ */
+BenchmarkReport BenchmarkQueries(const std::string& name, const SearchServer& search_server,
+                                 const std::vector<std::string>& queries, size_t repetitions) {
+    BenchmarkReport report;
+    report.name = name;
+    const PerfCounters counters;
+    for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+        report.available[i] = counters.IsAvailable(static_cast<PerfEvent>(i));
+    }
+
+    PhaseCounterObserver observer(counters, report);
+    const ScopedQueryPhaseObserver observer_installation(&observer);
+    const PerfSample start_sample = counters.Read();
+    const auto start_time = std::chrono::steady_clock::now();
+    for (size_t repetition = 0; repetition < repetitions; ++repetition) {
+        for (const std::string& query : queries) {
+            observer.Start();
+            search_server.FindTopDocuments(query);
+            ++report.query_count;
+        }
+    }
+    report.elapsed = std::chrono::steady_clock::now() - start_time;
+    report.total = counters.Read() - start_sample;
+    return report;
+}
+
+/**
+ * @brief Выводит результат замера: итоги, значения на запрос и на словопозицию и значения этапов на запрос.
+ * @param out Поток вывода.
+ * @param report Результат замера.
+ */
+void PrintBenchmarkReport(std::ostream& out, const BenchmarkReport& report) {
+    static const char* const phase_names[QUERY_PHASE_COUNT] = {"parse", "score", "select"};
+    const double queries = std::max<size_t>(report.query_count, 1);
+    const double postings = std::max<size_t>(report.postings_scanned, 1);
+
+    out << report.name << ": " << report.query_count << " queries, " << report.postings_scanned << " postings, "
+        << report.candidates_scored << " candidates, "
+        << std::chrono::duration_cast<std::chrono::microseconds>(report.elapsed).count() << " us\n";
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    out << std::fixed << std::setprecision(2);
+    out << std::setw(16) << "event" << std::setw(16) << "total" << std::setw(16) << "per query"
+        << std::setw(16) << "per posting";
+    for (const char* phase_name : phase_names) {
+        out << std::setw(16) << phase_name;
+    }
+    out << '\n';
+    for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+        const auto event = static_cast<PerfEvent>(i);
+        const bool available = report.available[i];
+        out << std::setw(16) << PerfCounters::GetEventName(event);
+        PrintValue(out, available, report.total[event]);
+        PrintValue(out, available, report.total[event] / queries);
+        PrintValue(out, available, report.total[event] / postings);
+        for (const PerfSample& phase : report.phases) {
+            PrintValue(out, available, phase[event] / queries);
+        }
+        out << '\n';
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
@@ -0,0 +1,52 @@
+/**
+ * @file benchmark.h
+ * @brief Содержит замер запросов SearchServer со счётчиками производительности.
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "perf_counters.h"
+#include "search_server.h"
+
+constexpr size_t QUERY_PHASE_COUNT = 3; ///< Количество этапов SearchServer::QueryPhase.
+
+/**
+ * @brief Результат замера набора запросов.
+ */
+struct BenchmarkReport {
+    std::string name;                                       ///< Название замера.
+    size_t query_count = 0;                                 ///< Количество выполненных запросов.
+    size_t postings_scanned = 0;                            ///< Количество просмотренных словопозиций.
+    size_t candidates_scored = 0;                           ///< Количество документов, получивших релевантность.
+    std::chrono::nanoseconds elapsed{0};                    ///< Общее время запросов.
+    PerfSample total;                                       ///< Счётчики всех запросов.
+    std::array<PerfSample, QUERY_PHASE_COUNT> phases;       ///< Счётчики по этапам, индексируемые QueryPhase.
+    std::array<bool, PERF_EVENT_COUNT> available = {};      ///< Доступность счётчиков, индексируемая PerfEvent.
+};
+
+/**
+ * @brief Выполняет запросы FindTopDocuments и собирает счётчики производительности.
+ * @details Счётчики читаются до и после каждого запроса и на границах его этапов, поэтому
+ *          в значения этапов входит и стоимость самого чтения (несколько системных вызовов).
+ *          Недоступные счётчики отмечаются в BenchmarkReport::available и остаются нулевыми.
+ * @param name Название замера.
+ * @param search_server Поисковый сервер.
+ * @param queries Запросы.
+ * @param repetitions Количество проходов по запросам.
+ * @return Результат замера.
+ */
+BenchmarkReport BenchmarkQueries(const std::string& name, const SearchServer& search_server,
+                                 const std::vector<std::string>& queries, size_t repetitions = 1);
+
+/**
+ * @brief Выводит результат замера: итоги, значения на запрос и на словопозицию и значения этапов на запрос.
+ * @param out Поток вывода.
+ * @param report Результат замера.
+ */
+void PrintBenchmarkReport(std::ostream& out, const BenchmarkReport& report);
@@ -0,0 +1,108 @@
+/**
+ * @file bounded_queue.h
+ * @brief Содержит ограниченную неблокирующую очередь для нескольких производителей и потребителей.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+/**
+ * @brief Ограниченная неблокирующая очередь (кольцевой буфер Вьюкова).
+ * @details Каждая ячейка хранит порядковый номер, по которому производитель и потребитель узнают,
+ *          свободна ли она. Операции не выделяют память и не берут блокировок: одна атомарная
+ *          операция compare-exchange на позицию и одна запись номера ячейки.
+ * @tparam T Тип элементов; должен быть конструируемым по умолчанию и перемещаемым.
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    /**
+     * @brief Конструктор класса BoundedQueue.
+     * @param capacity Вместимость очереди; степень двойки не меньше 2.
+     * @throws invalid_argument Если вместимость не является степенью двойки.
+     */
+    explicit BoundedQueue(size_t capacity)
+            : mask_(capacity - 1)
+            , cells_(new Cell[capacity]) {
+        if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+            throw std::invalid_argument("Queue capacity must be a power of two");
+        }
+        for (size_t i = 0; i < capacity; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    /**
+     * @brief Добавляет элемент, если в очереди есть место.
+     * @param value Элемент; перемещается только при успехе.
+     * @return true, если элемент добавлен; false, если очередь заполнена.
+     */
+    bool TryPush(T& value) {
+        size_t position = enqueue_position_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[position & mask_];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+            if (difference == 0) {
+                if (enqueue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = enqueue_position_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Извлекает элемент, если очередь не пуста.
+     * @param value Переменная для извлечённого элемента.
+     * @return true, если элемент извлечён; false, если очередь пуста.
+     */
+    bool TryPop(T& value) {
+        size_t position = dequeue_position_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[position & mask_];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position + 1);
+            if (difference == 0) {
+                if (dequeue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    value = std::move(cell.value);
+                    cell.sequence.store(position + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (difference < 0) {
+                return false;
+            } else {
+                position = dequeue_position_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    /**
+     * @brief Ячейка очереди.
+     */
+    struct Cell {
+        std::atomic<size_t> sequence{0};    ///< Порядковый номер ячейки.
+        T value{};                          ///< Элемент.
+    };
+
+    static constexpr size_t CACHE_LINE_SIZE = 64; ///< Размер кеш-линии.
+
+    const size_t mask_;                                                 ///< Маска номера ячейки.
+    std::unique_ptr<Cell[]> cells_;                                     ///< Ячейки.
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> enqueue_position_{0};  ///< Позиция записи.
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> dequeue_position_{0};  ///< Позиция чтения.
+};
@@ -0,0 +1,281 @@
+#include "collection_server.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+/**
+ * @brief Ищет в отсортированном по идентификатору массиве первый элемент с идентификатором не меньше id.
+ * @param items Массив.
+ * @param id Идентификатор.
+ * @param get_id Возвращает идентификатор элемента.
+ * @return Итератор найденного элемента или конец массива.
+ */
+template <typename Items, typename Id, typename GetId>
+auto LowerBoundById(Items& items, Id id, GetId get_id) {
+    return std::lower_bound(items.begin(), items.end(), id, [&get_id](const auto& item, Id value) {
+        return get_id(item) < value;
+    });
+}
+
+}  // namespace
+
+/**
+ * @brief Создаёт пустую коллекцию.
+ * @param collection_id Идентификатор коллекции.
+ * @throws invalid_argument Если коллекция уже существует.
+ */
+void CollectionServer::CreateCollection(int collection_id) {
+    if (!collections_.try_emplace(collection_id).second) {
+        throw std::invalid_argument("Collection " + std::to_string(collection_id) + " already exists");
+    }
+}
+
+/**
+ * @brief Удаляет коллекцию и освобождает её слова.
+ * @param collection_id Идентификатор коллекции.
+ */
+void CollectionServer::RemoveCollection(int collection_id) {
+    const auto it = collections_.find(collection_id);
+    if (it == collections_.end()) {
+        return;
+    }
+    for (const TermPostings& term_postings : it->second.terms) {
+        dictionary_.Release(term_postings.term);
+    }
+    collections_.erase(it);
+}
+
+/**
+ * @brief Проверяет, существует ли коллекция.
+ * @param collection_id Идентификатор коллекции.
+ * @return true, если коллекция существует.
+ */
+bool CollectionServer::HasCollection(int collection_id) const {
+    return collections_.count(collection_id) > 0;
+}
+
+/**
+ * @brief Возвращает количество коллекций.
+ * @return Количество коллекций.
+ */
+size_t CollectionServer::GetCollectionCount() const {
+    return collections_.size();
+}
+
+/**
+ * @brief Возвращает количество документов коллекции.
+ * @param collection_id Идентификатор коллекции.
+ * @return Количество документов.
+ * @throws out_of_range Если коллекции нет.
+ */
+size_t CollectionServer::GetDocumentCount(int collection_id) const {
+    return GetCollection(collection_id).documents.size();
+}
+
+/**
+ * @brief Возвращает количество слов общего словаря.
+ * @return Количество слов.
+ */
+size_t CollectionServer::GetTermCount() const {
+    return dictionary_.GetSize();
+}
+
+/**
+ * @brief Добавляет документ в коллекцию, создавая её при отсутствии.
+ * @param collection_id Идентификатор коллекции.
+ * @param document_id Идентификатор документа.
+ * @param document Текст документа.
+ * @param status Статус документа.
+ * @param ratings Рейтинги документа.
+ * @throws invalid_argument В тех же случаях, что SearchServer::AddDocument.
+ */
+void CollectionServer::AddDocument(int collection_id, int document_id, const std::string& document,
+                                   DocumentStatus status, const std::vector<int>& ratings) {
+    Collection& collection = collections_[collection_id];
+    const auto position = LowerBoundById(collection.documents, document_id,
+                                         [](const DocumentEntry& entry) { return entry.id; });
+    if (document_id < 0 || (position != collection.documents.end() && position->id == document_id)) {
+        throw std::invalid_argument("Document id less than zero or already exists");
+    }
+
+    // Частоты накапливаются в том же порядке, что и в SearchServer::AddDocument, и совпадают до бита
+    const std::vector<std::string> words = parser_.SplitIntoWordsNoStop(document);
+    const double inv_word_count = 1.0 / words.size();
+    std::map<std::string_view, double> word_freqs;
+    for (const std::string& word : words) {
+        word_freqs[word] += inv_word_count;
+    }
+
+    DocumentEntry entry{document_id, SearchServer::ComputeAverageRating(ratings), status, {}};
+    entry.term_freqs.reserve(word_freqs.size());
+    std::vector<TermPostings> new_terms;
+    for (const auto& [word, term_freq] : word_freqs) {
+        // Слово коллекции уже держится её ссылкой, поэтому его идентификатор не может смениться
+        const std::optional<TermDictionary::TermId> known_term = dictionary_.Find(word);
+        auto term_it = collection.terms.end();
+        if (known_term) {
+            term_it = LowerBoundById(collection.terms, *known_term,
+                                     [](const TermPostings& term_postings) { return term_postings.term; });
+        }
+        if (term_it != collection.terms.end() && term_it->term == *known_term) {
+            std::vector<Posting>& postings = term_it->postings;
+            postings.insert(LowerBoundById(postings, document_id, [](const Posting& posting) {
+                                return posting.document_id;
+                            }),
+                            Posting{document_id, term_freq});
+            entry.term_freqs.emplace_back(*known_term, term_freq);
+        } else {
+            const TermDictionary::TermId term = dictionary_.Acquire(word);
+            new_terms.push_back({term, {Posting{document_id, term_freq}}});
+            entry.term_freqs.emplace_back(term, term_freq);
+        }
+    }
+
+    // Новые слова вливаются одним проходом, а не вставкой каждого в середину массива
+    const auto by_term = [](const TermPostings& lhs, const TermPostings& rhs) {
+        return lhs.term < rhs.term;
+    };
+    std::sort(new_terms.begin(), new_terms.end(), by_term);
+    const size_t old_term_count = collection.terms.size();
+    std::move(new_terms.begin(), new_terms.end(), std::back_inserter(collection.terms));
+    std::inplace_merge(collection.terms.begin(), collection.terms.begin() + old_term_count, collection.terms.end(),
+                       by_term);
+
+    std::sort(entry.term_freqs.begin(), entry.term_freqs.end());
+    collection.documents.insert(position, std::move(entry));
+}
+
+/**
+ * @brief Удаляет документ из коллекции и освобождает слова, оставшиеся без документов.
+ * @param collection_id Идентификатор коллекции.
+ * @param document_id Идентификатор документа.
+ * @throws out_of_range Если коллекции нет.
+ */
+void CollectionServer::RemoveDocument(int collection_id, int document_id) {
+    const auto collection_it = collections_.find(collection_id);
+    if (collection_it == collections_.end()) {
+        throw std::out_of_range("Collection " + std::to_string(collection_id) + " not found");
+    }
+    Collection& collection = collection_it->second;
+    const auto document_it = LowerBoundById(collection.documents, document_id,
+                                            [](const DocumentEntry& entry) { return entry.id; });
+    if (document_it == collection.documents.end() || document_it->id != document_id) {
+        return;
+    }
+
+    bool has_empty_terms = false;
+    for (const auto& [term, _] : document_it->term_freqs) {
+        const auto term_it = LowerBoundById(collection.terms, term,
+                                            [](const TermPostings& term_postings) { return term_postings.term; });
+        std::vector<Posting>& postings = term_it->postings;
+        postings.erase(LowerBoundById(postings, document_id, [](const Posting& posting) {
+            return posting.document_id;
+        }));
+        if (postings.empty()) {
+            dictionary_.Release(term);
+            has_empty_terms = true;
+        }
+    }
+    if (has_empty_terms) {
+        collection.terms.erase(std::remove_if(collection.terms.begin(), collection.terms.end(),
+                                              [](const TermPostings& term_postings) {
+                                                  return term_postings.postings.empty();
+                                              }),
+                               collection.terms.end());
+    }
+    collection.documents.erase(document_it);
+}
+
+/**
+ * @brief Поиск топовых документов коллекции по запросу с указанным статусом.
+ * @param collection_id Идентификатор коллекции.
+ * @param raw_query Необработанный запрос.
+ * @param status Статус документа для поиска.
+ * @return Документы коллекции, найденные по запросу.
+ * @throws out_of_range Если коллекции нет.
+ * @throws invalid_argument Если запрос содержит недопустимые символы.
+ */
+std::vector<Document> CollectionServer::FindTopDocuments(int collection_id, const std::string& raw_query,
+                                                         DocumentStatus status) const {
+    const Collection& collection = GetCollection(collection_id);
+    if (!SearchServer::IsValidWord(raw_query)) {
+        throw std::invalid_argument("Invalid word in FindTopDocuments function");
+    }
+    const SearchServer::Query query = parser_.ParseQuery(raw_query);
+    const auto find_document = [&collection](int document_id) -> const DocumentEntry& {
+        return *LowerBoundById(collection.documents, document_id, [](const DocumentEntry& entry) { return entry.id; });
+    };
+
+    // Релевантность считается так же, как в SearchServer::ComputeDocumentRelevance
+    std::map<int, double> document_to_relevance;
+    for (const std::string& word : query.plus_words) {
+        const TermPostings* term_postings = FindTerm(collection, word);
+        if (!term_postings) {
+            continue;
+        }
+        const double inverse_document_freq = std::log(collection.documents.size() * 1.0
+                                                      / term_postings->postings.size());
+        for (const auto& [document_id, term_freq] : term_postings->postings) {
+            if (find_document(document_id).status == status) {
+                document_to_relevance[document_id] += ComputeTermRelevance(term_freq, inverse_document_freq);
+            }
+        }
+    }
+    for (const std::string& word : query.minus_words) {
+        const TermPostings* term_postings = FindTerm(collection, word);
+        if (!term_postings) {
+            continue;
+        }
+        for (const Posting& posting : term_postings->postings) {
+            document_to_relevance.erase(posting.document_id);
+        }
+    }
+
+    // Документы идут по возрастанию идентификатора, что задаёт последний критерий ранжирования
+    std::vector<Document> matched_documents;
+    matched_documents.reserve(document_to_relevance.size());
+    for (const auto& [document_id, relevance] : document_to_relevance) {
+        matched_documents.push_back({document_id, relevance, find_document(document_id).rating});
+    }
+    return SearchServer::SelectTopDocuments(std::move(matched_documents), MAX_RESULT_DOCUMENT_COUNT);
+}
+
+/**
+ * @brief Возвращает коллекцию.
+ * @param collection_id Идентификатор коллекции.
+ * @return Коллекция.
+ * @throws out_of_range Если коллекции нет.
+ */
+const CollectionServer::Collection& CollectionServer::GetCollection(int collection_id) const {
+    const auto it = collections_.find(collection_id);
+    if (it == collections_.end()) {
+        throw std::out_of_range("Collection " + std::to_string(collection_id) + " not found");
+    }
+    return it->second;
+}
+
+/**
+ * @brief Ищет список слова в коллекции.
+ * @details Идентификатор слова, найденный в словаре, может быть освобождён и выдан другому слову
+ *          изменением другой коллекции. Новое слово не может уже быть в этой коллекции, а слова
+ *          коллекции держатся её ссылками, поэтому ложного совпадения не бывает.
+ * @param collection Коллекция.
+ * @param word Слово.
+ * @return Список или nullptr, если слова в коллекции нет.
+ */
+const CollectionServer::TermPostings* CollectionServer::FindTerm(const Collection& collection,
+                                                                 std::string_view word) const {
+    const std::optional<TermDictionary::TermId> term = dictionary_.Find(word);
+    if (!term) {
+        return nullptr;
+    }
+    const auto it = LowerBoundById(collection.terms, *term,
+                                   [](const TermPostings& term_postings) { return term_postings.term; });
+    if (it == collection.terms.end() || it->term != *term) {
+        return nullptr;
+    }
+    return &*it;
+}
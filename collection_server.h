@@ -0,0 +1,178 @@
+/**
+ * @file collection_server.h
+ * @brief Содержит поисковую систему с несколькими независимыми коллекциями документов.
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "search_server.h"
+#include "term_dictionary.h"
+
+/**
+ * @brief Набор коллекций документов с общими словарём и стоп-словами.
+ * @details Каждая коллекция хранит свои документы и идентификаторы документов в компактных
+ *          отсортированных массивах: списки слов коллекции упорядочены по идентификатору слова
+ *          общего словаря, а словопозиции каждого списка - по идентификатору документа. Пустая
+ *          коллекция занимает несколько пустых векторов. Коллекция держит по одной ссылке на
+ *          каждое своё слово, поэтому удаление документов и коллекций освобождает слова, которые
+ *          больше нигде не встречаются. Оценка документов совпадает с SearchServer::FindTopDocuments
+ *          для поисковой системы с теми же документами и стоп-словами.
+ *          Изменение набора коллекций и коллекции не потокобезопасно; поиск - да, в том числе
+ *          одновременно с изменением других коллекций.
+ */
+class CollectionServer {
+public:
+    /**
+     * @brief Конструктор класса CollectionServer.
+     * @tparam StringContainer Тип контейнера стоп-слов.
+     * @param stop_words Стоп-слова всех коллекций.
+     * @throws invalid_argument Если стоп-слово содержит недопустимые символы.
+     */
+    template <typename StringContainer>
+    explicit CollectionServer(const StringContainer& stop_words)
+            : parser_(stop_words) {
+    }
+
+    /**
+     * @brief Конструктор класса CollectionServer.
+     * @param stop_words_text Стоп-слова всех коллекций через пробел.
+     * @throws invalid_argument Если стоп-слово содержит недопустимые символы.
+     */
+    explicit CollectionServer(const std::string& stop_words_text)
+            : parser_(stop_words_text) {
+    }
+
+    /**
+     * @brief Создаёт пустую коллекцию.
+     * @param collection_id Идентификатор коллекции.
+     * @throws invalid_argument Если коллекция уже существует.
+     */
+    void CreateCollection(int collection_id);
+
+    /**
+     * @brief Удаляет коллекцию и освобождает её слова; отсутствующая коллекция игнорируется.
+     * @param collection_id Идентификатор коллекции.
+     */
+    void RemoveCollection(int collection_id);
+
+    /**
+     * @brief Проверяет, существует ли коллекция.
+     * @param collection_id Идентификатор коллекции.
+     * @return true, если коллекция существует.
+     */
+    bool HasCollection(int collection_id) const;
+
+    /**
+     * @brief Возвращает количество коллекций.
+     * @return Количество коллекций.
+     */
+    size_t GetCollectionCount() const;
+
+    /**
+     * @brief Возвращает количество документов коллекции.
+     * @param collection_id Идентификатор коллекции.
+     * @return Количество документов.
+     * @throws out_of_range Если коллекции нет.
+     */
+    size_t GetDocumentCount(int collection_id) const;
+
+    /**
+     * @brief Возвращает количество слов общего словаря.
+     * @return Количество слов, встречающихся хотя бы в одной коллекции.
+     */
+    size_t GetTermCount() const;
+
+    /**
+     * @brief Добавляет документ в коллекцию, создавая её при отсутствии.
+     * @param collection_id Идентификатор коллекции.
+     * @param document_id Идентификатор документа, уникальный в коллекции.
+     * @param document Текст документа.
+     * @param status Статус документа.
+     * @param ratings Рейтинги документа.
+     * @throws invalid_argument В тех же случаях, что SearchServer::AddDocument.
+     */
+    void AddDocument(int collection_id, int document_id, const std::string& document, DocumentStatus status,
+                     const std::vector<int>& ratings);
+
+    /**
+     * @brief Удаляет документ из коллекции и освобождает слова, оставшиеся без документов;
+     *        отсутствующий документ игнорируется.
+     * @param collection_id Идентификатор коллекции.
+     * @param document_id Идентификатор документа.
+     * @throws out_of_range Если коллекции нет.
+     */
+    void RemoveDocument(int collection_id, int document_id);
+
+    /**
+     * @brief Поиск топовых документов коллекции по запросу с указанным статусом.
+     * @param collection_id Идентификатор коллекции.
+     * @param raw_query Необработанный запрос.
+     * @param status Статус документа для поиска (по умолчанию DocumentStatus::ACTUAL).
+     * @return Документы коллекции, найденные по запросу.
+     * @throws out_of_range Если коллекции нет.
+     * @throws invalid_argument Если запрос содержит недопустимые символы.
+     */
+    std::vector<Document> FindTopDocuments(int collection_id, const std::string& raw_query,
+                                           DocumentStatus status = DocumentStatus::ACTUAL) const;
+
+private:
+    /**
+     * @brief Вхождение слова в документ.
+     */
+    struct Posting {
+        int document_id;    ///< Идентификатор документа.
+        double term_freq;   ///< Частота слова в документе.
+    };
+
+    /**
+     * @brief Список документов со словом.
+     */
+    struct TermPostings {
+        TermDictionary::TermId term;    ///< Идентификатор слова; коллекция держит на него ссылку.
+        std::vector<Posting> postings;  ///< Документы по возрастанию идентификатора.
+    };
+
+    /**
+     * @brief Документ коллекции.
+     */
+    struct DocumentEntry {
+        int id;                                                     ///< Идентификатор документа.
+        int rating;                                                 ///< Рейтинг документа.
+        DocumentStatus status;                                      ///< Статус документа.
+        std::vector<std::pair<TermDictionary::TermId, double>> term_freqs; ///< Частоты слов документа по возрастанию идентификатора слова.
+    };
+
+    /**
+     * @brief Коллекция документов.
+     */
+    struct Collection {
+        std::vector<TermPostings> terms;        ///< Списки слов по возрастанию идентификатора слова.
+        std::vector<DocumentEntry> documents;   ///< Документы по возрастанию идентификатора.
+    };
+
+    SearchServer parser_;                       ///< Пустая поисковая система, разбирающая тексты со стоп-словами коллекций.
+    TermDictionary dictionary_;                 ///< Слова всех коллекций.
+    std::map<int, Collection> collections_;     ///< Коллекции.
+
+    /**
+     * @brief Возвращает коллекцию.
+     * @param collection_id Идентификатор коллекции.
+     * @return Коллекция.
+     * @throws out_of_range Если коллекции нет.
+     */
+    const Collection& GetCollection(int collection_id) const;
+
+    /**
+     * @brief Ищет список слова в коллекции.
+     * @param collection Коллекция.
+     * @param word Слово.
+     * @return Список или nullptr, если слова в коллекции нет.
+     */
+    const TermPostings* FindTerm(const Collection& collection, std::string_view word) const;
+};
@@ -0,0 +1,385 @@
+/**
+ * @file cow_shared.h
+ * @brief Содержит разделяемое значение с копированием при записи.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <map>
+#include <stdexcept>
+#include <utility>
+
+/**
+ * @brief Значение, разделяемое копиями владельца до первой записи.
+ * @details Копирование CowShared копирует только указатель. Mutable копирует значение, если им
+ *          владеет ещё кто-то, поэтому изменения одной копии не видны другим. Ссылки, полученные
+ *          через operator* до вызова Mutable, после него могут указывать на чужое значение и
+ *          использоваться не должны.
+ *
+ *          Владельцы считаются явно: копия, отпускающая значение, уменьшает счётчик с release, а
+ *          Mutable читает его с acquire. Поэтому чтения значения в потоке, уничтожившем или
+ *          перезаписавшем свою копию, завершаются до изменения значения на месте другой копией, и
+ *          разные копии можно изменять из разных потоков. Одну и ту же копию CowShared нельзя
+ *          изменять (Mutable, Emplace, присваивание) одновременно с её чтением или копированием
+ *          из другого потока: такие вызовы требуют внешней синхронизации, как у обычного значения.
+ *          Крупные значения стоит делить на части, каждая в своём CowShared: тогда первое
+ *          изменение после копирования владельца копирует только затронутую часть.
+ * @tparam T Тип значения; должен быть копируемым.
+ */
+template <typename T>
+class CowShared {
+public:
+    /**
+     * @brief Создаёт значение по умолчанию.
+     */
+    CowShared()
+            : holder_(new Holder()) {
+    }
+
+    /**
+     * @brief Создаёт пустое значение; см. Emplace.
+     */
+    CowShared(std::nullptr_t) {
+    }
+
+    CowShared(const CowShared& other) noexcept
+            : holder_(other.holder_) {
+        if (holder_) {
+            holder_->owners.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    CowShared(CowShared&& other) noexcept
+            : holder_(std::exchange(other.holder_, nullptr)) {
+    }
+
+    CowShared& operator=(CowShared other) noexcept {
+        std::swap(holder_, other.holder_);
+        return *this;
+    }
+
+    ~CowShared() {
+        Release();
+    }
+
+    /**
+     * @brief Заменяет значение новым, создаваемым из аргументов.
+     * @param args Аргументы конструктора T.
+     */
+    template <typename... Args>
+    void Emplace(Args&&... args) {
+        Holder* holder = new Holder(std::forward<Args>(args)...);
+        Release();
+        holder_ = holder;
+    }
+
+    /**
+     * @brief Проверяет, есть ли значение.
+     */
+    explicit operator bool() const {
+        return holder_ != nullptr;
+    }
+
+    const T& operator*() const {
+        return holder_->value;
+    }
+
+    const T* operator->() const {
+        return &holder_->value;
+    }
+
+    /**
+     * @brief Возвращает значение для изменения, копируя его, если оно разделяется.
+     * @return Значение, принадлежащее только этой копии.
+     */
+    T& Mutable() {
+        if (IsShared()) {
+            Holder* copy = new Holder(holder_->value);
+            Release();
+            holder_ = copy;
+        }
+        return holder_->value;
+    }
+
+    /**
+     * @brief Проверяет, разделяется ли значение с другими копиями.
+     * @return true, если значением владеет ещё кто-то.
+     */
+    bool IsShared() const {
+        return holder_->owners.load(std::memory_order_acquire) > 1;
+    }
+
+private:
+    /**
+     * @brief Значение и количество его владельцев.
+     */
+    struct Holder {
+        template <typename... Args>
+        explicit Holder(Args&&... args)
+                : value(std::forward<Args>(args)...) {
+        }
+
+        std::atomic<size_t> owners{1};  ///< Количество копий CowShared, владеющих значением.
+        T value;                        ///< Значение.
+    };
+
+    Holder* holder_ = nullptr;  ///< Значение; пусто, если не создано.
+
+    /**
+     * @brief Отпускает значение, удаляя его, если это был последний владелец.
+     */
+    void Release() {
+        // release публикует чтения этой копии для Mutable других копий, acquire - для удаления
+        if (holder_ && holder_->owners.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete holder_;
+        }
+        holder_ = nullptr;
+    }
+};
+
+/**
+ * @brief Упорядоченный словарь, разделяемый копиями владельца по сегментам.
+ * @details Записи хранятся в сегментах по MAX_SEGMENT_SIZE записей и меньше, каждый в своём
+ *          CowShared, а каталог сегментов - в ещё одном. Копирование словаря копирует только
+ *          указатель на каталог; первое изменение записи после копирования копирует каталог
+ *          (один указатель на сегмент) и сегмент этой записи, а не весь словарь. Ограничения
+ *          на одновременный доступ те же, что у CowShared.
+ * @tparam Key Тип ключа.
+ * @tparam Value Тип значения; должен быть копируемым и создаваемым по умолчанию.
+ * @tparam Compare Порядок ключей.
+ */
+template <typename Key, typename Value, typename Compare = std::less<>>
+class CowMap {
+public:
+    static constexpr size_t MAX_SEGMENT_SIZE = 128;    ///< Размер, при превышении которого сегмент делится пополам.
+
+    using Segment = std::map<Key, Value, Compare>;                  ///< Сегмент: записи с ключами из одного интервала.
+    using Directory = std::map<Key, CowShared<Segment>, Compare>;   ///< Каталог: сегменты по их первому ключу.
+
+    /**
+     * @brief Итератор по записям в порядке ключей.
+     */
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = typename Segment::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = const value_type&;
+
+        const_iterator() = default;
+
+        reference operator*() const {
+            return *entry_;
+        }
+
+        pointer operator->() const {
+            return &*entry_;
+        }
+
+        const_iterator& operator++() {
+            if (++entry_ == (*segment_->second).end()) {
+                ++segment_;
+                SkipToEntry();
+            }
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const const_iterator& other) const {
+            return segment_ == other.segment_ && (segment_ == segments_end_ || entry_ == other.entry_);
+        }
+
+        bool operator!=(const const_iterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        friend class CowMap;
+
+        const_iterator(typename Directory::const_iterator segment, typename Directory::const_iterator segments_end)
+                : segment_(segment)
+                , segments_end_(segments_end) {
+            SkipToEntry();
+        }
+
+        const_iterator(typename Directory::const_iterator segment, typename Directory::const_iterator segments_end,
+                       typename Segment::const_iterator entry)
+                : segment_(segment)
+                , segments_end_(segments_end)
+                , entry_(entry) {
+        }
+
+        /**
+         * @brief Переходит к первой записи текущего сегмента; сегменты непусты.
+         */
+        void SkipToEntry() {
+            if (segment_ != segments_end_) {
+                entry_ = (*segment_->second).begin();
+            }
+        }
+
+        typename Directory::const_iterator segment_;        ///< Текущий сегмент.
+        typename Directory::const_iterator segments_end_;   ///< Конец каталога.
+        typename Segment::const_iterator entry_;            ///< Текущая запись сегмента.
+    };
+
+    const_iterator begin() const {
+        return const_iterator(directory_->begin(), directory_->end());
+    }
+
+    const_iterator end() const {
+        return const_iterator(directory_->end(), directory_->end());
+    }
+
+    /**
+     * @brief Ищет запись по ключу.
+     * @param key Ключ.
+     * @return Итератор записи или end().
+     */
+    template <typename K>
+    const_iterator find(const K& key) const {
+        const auto segment = FindSegment(key);
+        if (segment == directory_->end()) {
+            return end();
+        }
+        const auto entry = (*segment->second).find(key);
+        if (entry == (*segment->second).end()) {
+            return end();
+        }
+        return const_iterator(segment, directory_->end(), entry);
+    }
+
+    /**
+     * @brief Возвращает значение по ключу.
+     * @param key Ключ.
+     * @return Значение.
+     * @throws out_of_range Если записи нет.
+     */
+    template <typename K>
+    const Value& at(const K& key) const {
+        const auto it = find(key);
+        if (it == end()) {
+            throw std::out_of_range("Key not found in CowMap");
+        }
+        return it->second;
+    }
+
+    template <typename K>
+    size_t count(const K& key) const {
+        return find(key) == end() ? 0 : 1;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    /**
+     * @brief Возвращает значение для изменения, добавляя запись при отсутствии.
+     * @details Копирует каталог и сегмент записи, если они разделяются с другими копиями словаря.
+     * @param key Ключ.
+     * @return Пара из хранимого ключа и значения, принадлежащего только этой копии.
+     */
+    std::pair<const Key&, Value&> Mutable(const Key& key) {
+        Directory& directory = directory_.Mutable();
+        auto segment = directory.upper_bound(key);
+        if (segment == directory.begin()) {
+            // Ключ меньше всех: он становится ключом первого сегмента
+            if (segment == directory.end()) {
+                segment = directory.emplace(key, CowShared<Segment>()).first;
+            } else {
+                CowShared<Segment> first = std::move(segment->second);
+                directory.erase(segment);
+                segment = directory.emplace(key, std::move(first)).first;
+            }
+        } else {
+            --segment;
+        }
+
+        Segment& entries = segment->second.Mutable();
+        auto [entry, inserted] = entries.try_emplace(key);
+        if (!inserted) {
+            return {entry->first, entry->second};
+        }
+        ++size_;
+        if (entries.size() <= MAX_SEGMENT_SIZE) {
+            return {entry->first, entry->second};
+        }
+
+        // Вторая половина переходит в новый сегмент; записи переносятся без копирования
+        auto middle = entries.begin();
+        std::advance(middle, entries.size() / 2);
+        const bool in_upper_half = !entries.key_comp()(entry->first, middle->first);
+        const Key middle_key = middle->first;
+        const Key stored_key = entry->first;
+        Segment upper;
+        while (middle != entries.end()) {
+            upper.insert(upper.end(), entries.extract(middle++));
+        }
+        CowShared<Segment> upper_segment(nullptr);
+        upper_segment.Emplace(std::move(upper));
+        const auto upper_it = directory.emplace(middle_key, std::move(upper_segment)).first;
+        Segment& target = in_upper_half ? upper_it->second.Mutable() : entries;
+        const auto moved = target.find(stored_key);
+        return {moved->first, moved->second};
+    }
+
+    /**
+     * @brief Удаляет запись.
+     * @param key Ключ.
+     * @return true, если запись была.
+     */
+    template <typename K>
+    bool Erase(const K& key) {
+        const auto shared_segment = FindSegment(key);
+        if (shared_segment == directory_->end() || (*shared_segment->second).count(key) == 0) {
+            return false;
+        }
+        // Ключ копируется до Mutable: разделяемый каталог после него может быть удалён другой копией
+        const Key segment_key = shared_segment->first;
+        Directory& directory = directory_.Mutable();
+        auto segment = directory.find(segment_key);
+        Segment& entries = segment->second.Mutable();
+        entries.erase(entries.find(key));
+        --size_;
+        if (entries.empty()) {
+            directory.erase(segment);
+        } else if (entries.key_comp()(segment_key, entries.begin()->first)) {
+            // Каталог ключуется первым ключом сегмента, а не удалённым: ключ может ссылаться на
+            // данные, которые освобождаются вместе с записью
+            auto node = directory.extract(segment);
+            node.key() = entries.begin()->first;
+            directory.insert(std::move(node));
+        }
+        return true;
+    }
+
+private:
+    CowShared<Directory> directory_;    ///< Каталог сегментов; сегменты непусты.
+    size_t size_ = 0;                   ///< Количество записей.
+
+    /**
+     * @brief Находит сегмент, в котором может быть ключ.
+     * @return Сегмент или конец каталога.
+     */
+    template <typename K>
+    typename Directory::const_iterator FindSegment(const K& key) const {
+        auto segment = directory_->upper_bound(key);
+        if (segment == directory_->begin()) {
+            return directory_->end();
+        }
+        return --segment;
+    }
+};
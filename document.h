@@ -1,5 +1,6 @@
 #pragma once
 #include <iostream>
+#include <vector>
 
 using namespace std::string_literals;
 
@@ -31,6 +32,34 @@ struct Document {
     int rating = 0; ///< Рейтинг документа.
 };
 
+/**
+ * @brief Колоночный буфер результатов поиска.
+ * @details Хранит идентификаторы, релевантности и рейтинги в отдельных непрерывных массивах
+ *          одинаковой длины. Буфер можно переиспользовать между запросами, чтобы не выделять память заново.
+ */
+struct DocumentColumns {
+    std::vector<int> ids;            ///< Идентификаторы документов.
+    std::vector<double> relevances;  ///< Релевантности документов.
+    std::vector<int> ratings;        ///< Рейтинги документов.
+
+    /**
+     * @brief Возвращает количество документов в буфере.
+     * @return Количество документов.
+     */
+    size_t size() const {
+        return ids.size();
+    }
+
+    /**
+     * @brief Очищает буфер, сохраняя выделенную память.
+     */
+    void clear() {
+        ids.clear();
+        relevances.clear();
+        ratings.clear();
+    }
+};
+
 /**
  * @brief Перегрузка оператора вывода для структуры Document.
  * @param out Поток вывода.
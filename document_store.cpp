@@ -0,0 +1,343 @@
+#include "document_store.h"
+
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+#include <tuple>
+
+#include "lz_compression.h"
+#include "varint.h"
+
+/**
+ * @brief Сохраняет текст документа.
+ * @param document_id Идентификатор документа.
+ * @param text Текст документа.
+ * @throws invalid_argument Если документ с таким идентификатором уже сохранён.
+ */
+void DocumentStore::AddDocument(int document_id, const std::string& text) {
+    if (locations_.count(document_id)) {
+        throw std::invalid_argument("Document already exists in DocumentStore");
+    }
+
+    // Разбиваем текст по тем же разделителям, что и SplitIntoWords
+    std::string word_offsets;
+    size_t previous_begin = 0;
+    for (size_t pos = 0; pos < text.size();) {
+        if (std::isspace(static_cast<unsigned char>(text[pos]))) {
+            ++pos;
+            continue;
+        }
+        const size_t begin = pos;
+        while (pos < text.size() && !std::isspace(static_cast<unsigned char>(text[pos]))) {
+            ++pos;
+        }
+        AppendVarint(word_offsets, begin - previous_begin);
+        AppendVarint(word_offsets, pos - begin);
+        previous_begin = begin;
+    }
+
+    locations_.emplace(document_id, AppendRecord(text, word_offsets));
+    raw_bytes_ += text.size() + word_offsets.size();
+}
+
+/**
+ * @brief Удаляет документ из хранилища.
+ * @param document_id Идентификатор документа.
+ * @return true, если документ был сохранён.
+ */
+bool DocumentStore::RemoveDocument(int document_id) {
+    const auto it = locations_.find(document_id);
+    if (it == locations_.end()) {
+        return false;
+    }
+    const uint32_t record_size = it->second.size + it->second.offsets_size;
+    if (it->second.block == blocks_.size()) {
+        open_block_live_ -= record_size;
+    } else {
+        blocks_[it->second.block].live_size -= record_size;
+    }
+    raw_bytes_ -= record_size;
+    locations_.erase(it);
+    return true;
+}
+
+/**
+ * @brief Переписывает блоки, в которых удалено больше половины данных.
+ * @return Количество освобождённых блоков.
+ */
+size_t DocumentStore::Compact() {
+    const size_t old_block_count = blocks_.size();
+    std::vector<bool> is_sparse(old_block_count);
+    bool has_sparse_blocks = false;
+    for (size_t block = 0; block < old_block_count; ++block) {
+        is_sparse[block] = blocks_[block].live_size * 2 < blocks_[block].raw_size;
+        has_sparse_blocks = has_sparse_blocks || is_sparse[block];
+    }
+    if (!has_sparse_blocks) {
+        return 0;
+    }
+
+    // Живые документы переносятся в порядке блоков, чтобы каждый блок распаковывался один раз
+    std::vector<std::pair<uint32_t, int>> moved_documents;
+    for (const auto& [document_id, location] : locations_) {
+        if (location.block < old_block_count && is_sparse[location.block]) {
+            moved_documents.emplace_back(location.block, document_id);
+        }
+    }
+    std::sort(moved_documents.begin(), moved_documents.end());
+    std::string data;
+    uint32_t data_block = static_cast<uint32_t>(old_block_count);
+    for (const auto& [block, document_id] : moved_documents) {
+        if (block != data_block) {
+            data = LzDecompress(blocks_[block].data, blocks_[block].raw_size);
+            data_block = block;
+        }
+        DocumentLocation& location = locations_.at(document_id);
+        const std::string_view text = std::string_view(data).substr(location.offset, location.size);
+        const std::string_view word_offsets = std::string_view(data).substr(location.offset + location.size,
+                                                                            location.offsets_size);
+        location = AppendRecord(text, word_offsets);
+    }
+
+    // Перенос мог запечатать новые блоки: они остаются после старых и тоже перенумеровываются
+    std::vector<uint32_t> new_numbers(blocks_.size() + 1);
+    std::vector<Block> kept_blocks;
+    size_t freed_count = 0;
+    for (size_t block = 0; block < blocks_.size(); ++block) {
+        if (block < old_block_count && is_sparse[block]) {
+            ++freed_count;
+            continue;
+        }
+        new_numbers[block] = static_cast<uint32_t>(kept_blocks.size());
+        kept_blocks.push_back(std::move(blocks_[block]));
+    }
+    new_numbers[blocks_.size()] = static_cast<uint32_t>(kept_blocks.size());
+    for (auto& [_, location] : locations_) {
+        location.block = new_numbers[location.block];
+    }
+    blocks_ = std::move(kept_blocks);
+    cache_.Clear();
+    return freed_count;
+}
+
+/**
+ * @brief Проверяет, сохранён ли документ.
+ * @param document_id Идентификатор документа.
+ * @return true, если документ сохранён.
+ */
+bool DocumentStore::HasDocument(int document_id) const {
+    return locations_.count(document_id) > 0;
+}
+
+/**
+ * @brief Возвращает исходный текст документа.
+ * @param document_id Идентификатор документа.
+ * @return Текст документа.
+ * @throws out_of_range Если документ не сохранён.
+ */
+std::string DocumentStore::GetDocumentText(int document_id) const {
+    const DocumentLocation& location = locations_.at(document_id);
+    return ReadBlock(location.block)->substr(location.offset, location.size);
+}
+
+/**
+ * @brief Возвращает статистику хранилища.
+ * @return Статистика хранилища.
+ */
+DocumentStore::Stats DocumentStore::GetStats() const {
+    Stats stats;
+    stats.document_count = locations_.size();
+    stats.block_count = blocks_.size() + (open_block_.empty() ? 0 : 1);
+    stats.raw_bytes = raw_bytes_;
+    stats.stored_bytes = open_block_.capacity() + blocks_.capacity() * sizeof(Block);
+    for (const Block& block : blocks_) {
+        stats.stored_bytes += block.data.capacity();
+    }
+    // Узел std::map хранит ключ, значение и служебные поля красно-чёрного дерева
+    stats.stored_bytes += locations_.size() * (sizeof(std::pair<const int, DocumentLocation>) + 4 * sizeof(void*));
+    std::tie(stats.cache_hits, stats.cache_misses) = cache_.GetCounters();
+    return stats;
+}
+
+/**
+ * @brief Возвращает счётчики кеша блоков, не обходя блоки хранилища.
+ * @return Пара (попадания, промахи).
+ */
+std::pair<uint64_t, uint64_t> DocumentStore::GetCacheCounters() const {
+    return cache_.GetCounters();
+}
+
+/**
+ * @brief Строит фрагмент документа, содержащий наибольшее число слов запроса.
+ * @param document_id Идентификатор документа.
+ * @param words Слова, которые нужно подсветить.
+ * @param window_words Максимальное количество слов во фрагменте.
+ * @return Фрагмент с подсвеченными словами.
+ * @throws out_of_range Если документ не сохранён.
+ */
+Snippet DocumentStore::MakeSnippet(int document_id, const std::set<std::string, std::less<>>& words,
+                                   size_t window_words) const {
+    const DocumentLocation& location = locations_.at(document_id);
+    const std::shared_ptr<const std::string> block = ReadBlock(location.block);
+    const std::string_view text = std::string_view(*block).substr(location.offset, location.size);
+
+    // Восстанавливаем границы слов и отмечаем совпавшие со словами запроса
+    std::vector<std::pair<size_t, size_t>> word_bounds;
+    std::vector<bool> is_matched;
+    std::string_view encoded = std::string_view(*block).substr(location.offset + location.size, location.offsets_size);
+    size_t begin = 0;
+    while (!encoded.empty()) {
+        begin += ReadVarint(encoded);
+        const size_t length = ReadVarint(encoded);
+        word_bounds.emplace_back(begin, length);
+        is_matched.push_back(words.find(text.substr(begin, length)) != words.end());
+    }
+
+    Snippet snippet;
+    snippet.document_id = document_id;
+    if (word_bounds.empty()) {
+        return snippet;
+    }
+
+    // Скользящим окном выбираем фрагмент с наибольшим числом совпавших слов
+    const size_t window = std::max<size_t>(1, std::min(window_words, word_bounds.size()));
+    size_t matched_in_window = 0;
+    for (size_t i = 0; i < window; ++i) {
+        matched_in_window += is_matched[i];
+    }
+    size_t best_first = 0;
+    size_t best_matched = matched_in_window;
+    for (size_t first = 1; first + window <= word_bounds.size(); ++first) {
+        matched_in_window += is_matched[first + window - 1];
+        matched_in_window -= is_matched[first - 1];
+        if (matched_in_window > best_matched) {
+            best_matched = matched_in_window;
+            best_first = first;
+        }
+    }
+
+    const size_t text_begin = word_bounds[best_first].first;
+    const auto& [last_begin, last_length] = word_bounds[best_first + window - 1];
+    snippet.text = std::string(text.substr(text_begin, last_begin + last_length - text_begin));
+    for (size_t i = best_first; i < best_first + window; ++i) {
+        if (is_matched[i]) {
+            snippet.highlights.emplace_back(word_bounds[i].first - text_begin, word_bounds[i].second);
+        }
+    }
+    return snippet;
+}
+
+/**
+ * @brief Дописывает текст документа и смещения его слов в открытый блок.
+ * @param text Текст документа.
+ * @param word_offsets Закодированные смещения слов.
+ * @return Положение документа.
+ */
+DocumentStore::DocumentLocation DocumentStore::AppendRecord(std::string_view text, std::string_view word_offsets) {
+    // Документ целиком помещается в один блок, даже если он больше block_size_
+    const size_t record_size = text.size() + word_offsets.size();
+    if (!open_block_.empty() && open_block_.size() + record_size > block_size_) {
+        SealOpenBlock();
+    }
+
+    const DocumentLocation location{static_cast<uint32_t>(blocks_.size()),
+                                    static_cast<uint32_t>(open_block_.size()),
+                                    static_cast<uint32_t>(text.size()),
+                                    static_cast<uint32_t>(word_offsets.size())};
+    open_block_ += text;
+    open_block_ += word_offsets;
+    open_block_live_ += static_cast<uint32_t>(record_size);
+    if (open_block_.size() >= block_size_) {
+        SealOpenBlock();
+    }
+    return location;
+}
+
+/**
+ * @brief Сжимает открытый блок и начинает новый.
+ */
+void DocumentStore::SealOpenBlock() {
+    std::string data = LzCompress(open_block_);
+    data.shrink_to_fit();
+    blocks_.push_back({std::move(data), static_cast<uint32_t>(open_block_.size()), open_block_live_});
+    open_block_.clear();
+    open_block_live_ = 0;
+}
+
+/**
+ * @brief Возвращает распакованное содержимое блока.
+ * @param block Номер блока.
+ * @return Содержимое блока.
+ */
+std::shared_ptr<const std::string> DocumentStore::ReadBlock(uint32_t block) const {
+    if (block == blocks_.size()) {
+        return std::make_shared<const std::string>(open_block_);
+    }
+    if (auto cached = cache_.Find(block)) {
+        return cached;
+    }
+    const Block& compressed = blocks_.at(block);
+    auto data = std::make_shared<const std::string>(LzDecompress(compressed.data, compressed.raw_size));
+    cache_.Insert(block, data);
+    return data;
+}
+
+/**
+ * @brief Ищет блок в кеше.
+ * @param block Номер блока.
+ * @return Содержимое блока или nullptr, если блока нет в кеше.
+ */
+std::shared_ptr<const std::string> DocumentStore::BlockCache::Find(uint32_t block) {
+    std::lock_guard guard(mutex_);
+    for (Entry& entry : entries_) {
+        if (entry.block == block) {
+            entry.last_used = ++clock_;
+            ++hits_;
+            return entry.data;
+        }
+    }
+    ++misses_;
+    return nullptr;
+}
+
+/**
+ * @brief Помещает блок в кеш, вытесняя давно не использованный.
+ * @param block Номер блока.
+ * @param data Содержимое блока.
+ */
+void DocumentStore::BlockCache::Insert(uint32_t block, std::shared_ptr<const std::string> data) {
+    std::lock_guard guard(mutex_);
+    if (capacity_ == 0) {
+        return;
+    }
+    for (const Entry& entry : entries_) {
+        if (entry.block == block) {
+            return;
+        }
+    }
+    if (entries_.size() < capacity_) {
+        entries_.push_back({block, ++clock_, std::move(data)});
+        return;
+    }
+    auto oldest = std::min_element(entries_.begin(), entries_.end(), [](const Entry& lhs, const Entry& rhs) {
+        return lhs.last_used < rhs.last_used;
+    });
+    *oldest = {block, ++clock_, std::move(data)};
+}
+
+/**
+ * @brief Удаляет все блоки из кеша.
+ */
+void DocumentStore::BlockCache::Clear() {
+    std::lock_guard guard(mutex_);
+    entries_.clear();
+}
+
+/**
+ * @brief Возвращает количество попаданий и промахов.
+ * @return Пара (попадания, промахи).
+ */
+std::pair<uint64_t, uint64_t> DocumentStore::BlockCache::GetCounters() const {
+    std::lock_guard guard(mutex_);
+    return {hits_, misses_};
+}
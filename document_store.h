@@ -0,0 +1,238 @@
+/**
+ * @file document_store.h
+ * @brief Содержит хранилище сжатых исходных текстов документов и построение фрагментов с подсветкой.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+const size_t SNIPPET_WORD_COUNT = 16; ///< Количество слов во фрагменте по умолчанию.
+
+/**
+ * @brief Фрагмент текста документа с подсвеченными словами запроса.
+ */
+struct Snippet {
+    int document_id = 0;                                 ///< Идентификатор документа.
+    std::string text;                                    ///< Текст фрагмента.
+    std::vector<std::pair<size_t, size_t>> highlights;   ///< Позиции и длины подсвеченных слов в тексте фрагмента.
+};
+
+/**
+ * @brief Хранилище исходных текстов документов в сжатых блоках.
+ * @details Тексты дописываются в открытый блок; когда он заполняется, блок сжимается.
+ *          Документ никогда не пересекает границу блока, поэтому для чтения документа достаточно
+ *          распаковать один блок. Вслед за текстом в блок записываются смещения его слов, чтобы строить
+ *          фрагменты без повторного разбиения текста. Последние распакованные блоки хранятся в кеше.
+ */
+class DocumentStore {
+public:
+    static const size_t DEFAULT_BLOCK_SIZE = 16 * 1024; ///< Размер блока по умолчанию.
+    static const size_t DEFAULT_CACHE_BLOCKS = 8;       ///< Размер кеша распакованных блоков по умолчанию.
+
+    /**
+     * @brief Статистика хранилища.
+     */
+    struct Stats {
+        size_t document_count = 0;  ///< Количество документов.
+        size_t block_count = 0;     ///< Количество блоков, включая открытый.
+        size_t raw_bytes = 0;       ///< Суммарный размер несжатых данных.
+        size_t stored_bytes = 0;    ///< Занимаемая память: сжатые блоки, открытый блок и положения документов.
+        uint64_t cache_hits = 0;    ///< Количество чтений блока из кеша.
+        uint64_t cache_misses = 0;  ///< Количество распаковок блока.
+    };
+
+    /**
+     * @brief Конструктор класса DocumentStore.
+     * @param block_size Размер несжатого блока, после достижения которого блок сжимается.
+     * @param cache_blocks Количество распакованных блоков, хранимых в кеше.
+     */
+    explicit DocumentStore(size_t block_size = DEFAULT_BLOCK_SIZE, size_t cache_blocks = DEFAULT_CACHE_BLOCKS)
+            : block_size_(block_size)
+            , cache_(cache_blocks) {
+    }
+
+    /**
+     * @brief Сохраняет текст документа.
+     * @param document_id Идентификатор документа.
+     * @param text Текст документа.
+     * @throws invalid_argument Если документ с таким идентификатором уже сохранён.
+     */
+    void AddDocument(int document_id, const std::string& text);
+
+    /**
+     * @brief Удаляет документ из хранилища.
+     * @details Место в сжатом блоке освобождается только вызовом Compact: блоки неизменяемы.
+     *          raw_bytes в статистике уменьшается, stored_bytes - нет.
+     * @param document_id Идентификатор документа.
+     * @return true, если документ был сохранён.
+     */
+    bool RemoveDocument(int document_id);
+
+    /**
+     * @brief Переписывает блоки, в которых удалено больше половины данных.
+     * @details Живые документы таких блоков дописываются в открытый блок, а сами блоки
+     *          освобождаются; оставшиеся блоки перенумеровываются, кеш блоков сбрасывается.
+     *          Проход по положениям документов выполняется, только если такие блоки есть.
+     * @return Количество освобождённых блоков.
+     */
+    size_t Compact();
+
+    /**
+     * @brief Проверяет, сохранён ли документ.
+     * @param document_id Идентификатор документа.
+     * @return true, если документ сохранён.
+     */
+    bool HasDocument(int document_id) const;
+
+    /**
+     * @brief Возвращает исходный текст документа.
+     * @details Требует распаковки не более одного блока.
+     * @param document_id Идентификатор документа.
+     * @return Текст документа.
+     * @throws out_of_range Если документ не сохранён.
+     */
+    std::string GetDocumentText(int document_id) const;
+
+    /**
+     * @brief Возвращает статистику хранилища.
+     * @return Статистика хранилища.
+     */
+    Stats GetStats() const;
+
+    /**
+     * @brief Возвращает счётчики кеша блоков, не обходя блоки хранилища.
+     * @return Пара (попадания, промахи).
+     */
+    std::pair<uint64_t, uint64_t> GetCacheCounters() const;
+
+    /**
+     * @brief Строит фрагмент документа, содержащий наибольшее число слов запроса.
+     * @param document_id Идентификатор документа.
+     * @details Слова текста сравниваются со словами запроса как string_view, без копирования.
+     * @param words Слова, которые нужно подсветить.
+     * @param window_words Максимальное количество слов во фрагменте.
+     * @return Фрагмент с подсвеченными словами.
+     * @throws out_of_range Если документ не сохранён.
+     */
+    Snippet MakeSnippet(int document_id, const std::set<std::string, std::less<>>& words, size_t window_words) const;
+
+private:
+    /**
+     * @brief Положение документа в хранилище.
+     */
+    struct DocumentLocation {
+        uint32_t block;             ///< Номер блока.
+        uint32_t offset;            ///< Смещение текста в распакованном блоке.
+        uint32_t size;              ///< Длина текста.
+        uint32_t offsets_size;      ///< Длина следующих за текстом смещений слов (дельты начал и длины в varint).
+    };
+
+    /**
+     * @brief Сжатый блок.
+     */
+    struct Block {
+        std::string data;   ///< Сжатые данные.
+        uint32_t raw_size;  ///< Размер распакованных данных.
+        uint32_t live_size; ///< Размер данных документов, ещё не удалённых.
+    };
+
+    /**
+     * @brief Кеш последних распакованных блоков.
+     * @details Защищён мьютексом, так как заполняется из константных методов. При копировании
+     *          хранилища кеш не копируется.
+     */
+    class BlockCache {
+    public:
+        explicit BlockCache(size_t capacity)
+                : capacity_(capacity) {
+        }
+
+        BlockCache(const BlockCache& other)
+                : capacity_(other.capacity_) {
+        }
+
+        BlockCache& operator=(const BlockCache& other) {
+            std::lock_guard guard(mutex_);
+            capacity_ = other.capacity_;
+            entries_.clear();
+            return *this;
+        }
+
+        /**
+         * @brief Ищет блок в кеше.
+         * @param block Номер блока.
+         * @return Содержимое блока или nullptr, если блока нет в кеше.
+         */
+        std::shared_ptr<const std::string> Find(uint32_t block);
+
+        /**
+         * @brief Помещает блок в кеш, вытесняя давно не использованный.
+         * @param block Номер блока.
+         * @param data Содержимое блока.
+         */
+        void Insert(uint32_t block, std::shared_ptr<const std::string> data);
+
+        /**
+         * @brief Удаляет все блоки из кеша; счётчики сохраняются.
+         */
+        void Clear();
+
+        /**
+         * @brief Возвращает количество попаданий и промахов.
+         * @return Пара (попадания, промахи).
+         */
+        std::pair<uint64_t, uint64_t> GetCounters() const;
+
+    private:
+        struct Entry {
+            uint32_t block;                          ///< Номер блока.
+            uint64_t last_used;                      ///< Момент последнего обращения.
+            std::shared_ptr<const std::string> data; ///< Содержимое блока.
+        };
+
+        size_t capacity_;               ///< Максимальное количество блоков.
+        std::vector<Entry> entries_;    ///< Блоки в кеше.
+        uint64_t clock_ = 0;            ///< Счётчик обращений.
+        uint64_t hits_ = 0;             ///< Количество попаданий.
+        uint64_t misses_ = 0;           ///< Количество промахов.
+        mutable std::mutex mutex_;      ///< Мьютекс кеша.
+    };
+
+    size_t block_size_;                             ///< Размер несжатого блока.
+    std::vector<Block> blocks_;                     ///< Сжатые блоки.
+    std::string open_block_;                        ///< Открытый, ещё не сжатый блок.
+    uint32_t open_block_live_ = 0;                  ///< Размер данных документов открытого блока, ещё не удалённых.
+    std::map<int, DocumentLocation> locations_;     ///< Положения документов.
+    size_t raw_bytes_ = 0;                          ///< Суммарный размер несжатых данных.
+    mutable BlockCache cache_;                      ///< Кеш распакованных блоков.
+
+    /**
+     * @brief Дописывает текст документа и смещения его слов в открытый блок.
+     * @param text Текст документа.
+     * @param word_offsets Закодированные смещения слов.
+     * @return Положение документа.
+     */
+    DocumentLocation AppendRecord(std::string_view text, std::string_view word_offsets);
+
+    /**
+     * @brief Сжимает открытый блок и начинает новый.
+     */
+    void SealOpenBlock();
+
+    /**
+     * @brief Возвращает распакованное содержимое блока.
+     * @param block Номер блока.
+     * @return Содержимое блока.
+     */
+    std::shared_ptr<const std::string> ReadBlock(uint32_t block) const;
+};
@@ -0,0 +1,167 @@
+#include "lz_compression.h"
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+const size_t MIN_MATCH = 4;            ///< Минимальная длина совпадения.
+const size_t MAX_OFFSET = 65535;       ///< Максимальное смещение совпадения.
+const int HASH_BITS = 14;              ///< Размер хеш-таблицы в битах.
+
+/**
+ * @brief Считывает 4 байта из указанной позиции.
+ */
+uint32_t Load32(const char* data) {
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief Хеширует 4 байта для поиска предыдущего вхождения.
+ */
+uint32_t Hash32(uint32_t value) {
+    return (value * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/**
+ * @brief Дописывает продолжение длины, не поместившейся в 4 бита токена.
+ */
+void AppendExtendedLength(std::string& out, size_t length) {
+    for (; length >= 255; length -= 255) {
+        out.push_back(static_cast<char>(255));
+    }
+    out.push_back(static_cast<char>(length));
+}
+
+/**
+ * @brief Дописывает последовательность из литералов и, если match_length > 0, совпадения.
+ */
+void AppendSequence(std::string& out, std::string_view literals, size_t offset, size_t match_length) {
+    const size_t match_code = match_length == 0 ? 0 : match_length - MIN_MATCH;
+    const size_t literal_nibble = literals.size() < 15 ? literals.size() : 15;
+    const size_t match_nibble = match_code < 15 ? match_code : 15;
+    out.push_back(static_cast<char>((literal_nibble << 4) | match_nibble));
+    if (literal_nibble == 15) {
+        AppendExtendedLength(out, literals.size() - 15);
+    }
+    out.append(literals);
+    if (match_length == 0) {
+        return;
+    }
+    out.push_back(static_cast<char>(offset & 0xFF));
+    out.push_back(static_cast<char>(offset >> 8));
+    if (match_nibble == 15) {
+        AppendExtendedLength(out, match_code - 15);
+    }
+}
+
+/**
+ * @brief Считывает продолжение длины, если значение из токена равно 15.
+ */
+size_t ReadExtendedLength(std::string_view& in, size_t length) {
+    if (length != 15) {
+        return length;
+    }
+    for (;;) {
+        if (in.empty()) {
+            throw std::invalid_argument("Corrupted LZ block: truncated length");
+        }
+        const auto byte = static_cast<unsigned char>(in.front());
+        in.remove_prefix(1);
+        length += byte;
+        if (byte != 255) {
+            return length;
+        }
+    }
+}
+
+} // namespace
+
+/**
+ * @brief Сжимает блок данных.
+ * @param input Исходные данные.
+ * @return Сжатый блок.
+ */
+std::string LzCompress(std::string_view input) {
+    std::string out;
+    out.reserve(input.size() / 2 + 16);
+
+    std::vector<int64_t> last_position(size_t{1} << HASH_BITS, -1);
+    size_t anchor = 0;
+    size_t pos = 0;
+    while (pos + MIN_MATCH <= input.size()) {
+        const uint32_t sequence = Load32(input.data() + pos);
+        int64_t& slot = last_position[Hash32(sequence)];
+        const int64_t candidate = slot;
+        slot = static_cast<int64_t>(pos);
+
+        if (candidate < 0 || pos - candidate > MAX_OFFSET || Load32(input.data() + candidate) != sequence) {
+            ++pos;
+            continue;
+        }
+
+        size_t match_length = MIN_MATCH;
+        while (pos + match_length < input.size() && input[candidate + match_length] == input[pos + match_length]) {
+            ++match_length;
+        }
+        AppendSequence(out, input.substr(anchor, pos - anchor), pos - candidate, match_length);
+        pos += match_length;
+        anchor = pos;
+    }
+
+    AppendSequence(out, input.substr(anchor), 0, 0);
+    return out;
+}
+
+/**
+ * @brief Распаковывает блок данных, сжатый функцией LzCompress.
+ * @param compressed Сжатый блок.
+ * @param raw_size Размер исходных данных.
+ * @return Распакованные данные.
+ * @throws invalid_argument Если сжатый блок повреждён.
+ */
+std::string LzDecompress(std::string_view compressed, size_t raw_size) {
+    std::string out;
+    out.reserve(raw_size);
+
+    while (!compressed.empty()) {
+        const auto token = static_cast<unsigned char>(compressed.front());
+        compressed.remove_prefix(1);
+
+        const size_t literal_length = ReadExtendedLength(compressed, token >> 4);
+        if (literal_length > compressed.size() || out.size() + literal_length > raw_size) {
+            throw std::invalid_argument("Corrupted LZ block: literals out of range");
+        }
+        out.append(compressed.substr(0, literal_length));
+        compressed.remove_prefix(literal_length);
+
+        if (compressed.empty()) {
+            break;
+        }
+        if (compressed.size() < 2) {
+            throw std::invalid_argument("Corrupted LZ block: truncated offset");
+        }
+        const size_t offset = static_cast<unsigned char>(compressed[0])
+                              | (static_cast<size_t>(static_cast<unsigned char>(compressed[1])) << 8);
+        compressed.remove_prefix(2);
+        const size_t match_length = ReadExtendedLength(compressed, token & 0x0F) + MIN_MATCH;
+        if (offset == 0 || offset > out.size() || out.size() + match_length > raw_size) {
+            throw std::invalid_argument("Corrupted LZ block: match out of range");
+        }
+
+        // Совпадение может перекрываться с записываемыми данными, поэтому копируем побайтово
+        const size_t match_start = out.size() - offset;
+        for (size_t i = 0; i < match_length; ++i) {
+            out.push_back(out[match_start + i]);
+        }
+    }
+
+    if (out.size() != raw_size) {
+        throw std::invalid_argument("Corrupted LZ block: size mismatch");
+    }
+    return out;
+}
@@ -0,0 +1,30 @@
+/**
+ * @file lz_compression.h
+ * @brief Содержит функции сжатия блоков данных алгоритмом семейства LZ77.
+ *
+ * Формат сжатого блока повторяет блочный формат LZ4: последовательность состоит из байта-токена
+ * (старшие 4 бита - длина литералов, младшие 4 бита - длина совпадения минус 4), расширенной
+ * длины литералов, самих литералов, 2-байтового смещения совпадения и расширенной длины совпадения.
+ * Последняя последовательность содержит только литералы.
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Сжимает блок данных.
+ * @param input Исходные данные.
+ * @return Сжатый блок.
+ */
+std::string LzCompress(std::string_view input);
+
+/**
+ * @brief Распаковывает блок данных, сжатый функцией LzCompress.
+ * @param compressed Сжатый блок.
+ * @param raw_size Размер исходных данных.
+ * @return Распакованные данные.
+ * @throws invalid_argument Если сжатый блок повреждён.
+ */
+std::string LzDecompress(std::string_view compressed, size_t raw_size);
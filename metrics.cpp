@@ -0,0 +1,266 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+/**
+ * @brief Атомарно прибавляет значение к числу с плавающей точкой.
+ */
+void AtomicAdd(std::atomic<double>& target, double value) {
+    double current = target.load(std::memory_order_relaxed);
+    while (!target.compare_exchange_weak(current, current + value, std::memory_order_relaxed)) {
+    }
+}
+
+/**
+ * @brief Проверяет имя метрики на соответствие [a-zA-Z_:][a-zA-Z0-9_:]*.
+ */
+bool IsValidMetricName(const std::string& name) {
+    if (name.empty()) {
+        return false;
+    }
+    for (size_t i = 0; i < name.size(); ++i) {
+        const char c = name[i];
+        const bool is_letter = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == ':';
+        if (!is_letter && !(i > 0 && c >= '0' && c <= '9')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Экранирует описание метрики.
+ */
+std::string EscapeHelp(const std::string& help) {
+    std::string result;
+    result.reserve(help.size());
+    for (const char c : help) {
+        if (c == '\\') {
+            result += "\\\\";
+        } else if (c == '\n') {
+            result += "\\n";
+        } else {
+            result.push_back(c);
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Выводит число в формате Prometheus.
+ */
+void WriteValue(std::ostream& out, double value) {
+    if (std::isinf(value)) {
+        out << (value > 0 ? "+Inf" : "-Inf");
+    } else if (std::isnan(value)) {
+        out << "NaN";
+    } else {
+        // Кратчайшая запись, при чтении дающая то же число
+        char buffer[32];
+        const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.write(buffer, result.ptr - buffer);
+    }
+}
+
+} // namespace
+
+/**
+ * @brief Возвращает сегмент счётчиков текущего потока.
+ * @return Номер сегмента.
+ */
+size_t GetMetricShard() {
+    static std::atomic<size_t> next_shard{0};
+    thread_local const size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % METRIC_SHARD_COUNT;
+    return shard;
+}
+
+/**
+ * @brief Возвращает значение счётчика.
+ * @return Сумма значений сегментов.
+ */
+uint64_t Counter::GetValue() const {
+    uint64_t result = 0;
+    for (const Shard& shard : shards_) {
+        result += shard.value.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+/**
+ * @brief Конструктор класса Histogram.
+ * @param bounds Возрастающие верхние границы корзин.
+ * @throws invalid_argument Если границы не возрастают.
+ */
+Histogram::Histogram(std::vector<double> bounds)
+        : bounds_(std::move(bounds)) {
+    if (std::adjacent_find(bounds_.begin(), bounds_.end(), std::greater_equal<double>()) != bounds_.end()) {
+        throw std::invalid_argument("Histogram bounds must be strictly increasing");
+    }
+    for (Shard& shard : shards_) {
+        shard.buckets.reset(new std::atomic<uint64_t>[bounds_.size() + 1]);
+        for (size_t i = 0; i <= bounds_.size(); ++i) {
+            shard.buckets[i].store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * @brief Учитывает значение.
+ * @param value Значение.
+ */
+void Histogram::Observe(double value) {
+    // Корзина - первая граница, не меньшая значения
+    const size_t bucket = std::lower_bound(bounds_.begin(), bounds_.end(), value) - bounds_.begin();
+    Shard& shard = shards_[GetMetricShard()];
+    shard.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    AtomicAdd(shard.sum, value);
+}
+
+/**
+ * @brief Возвращает верхние границы корзин без +Inf.
+ * @return Границы корзин.
+ */
+const std::vector<double>& Histogram::GetBounds() const {
+    return bounds_;
+}
+
+/**
+ * @brief Возвращает количество значений в каждой корзине, последняя - +Inf.
+ * @return Количество значений по корзинам.
+ */
+std::vector<uint64_t> Histogram::GetBucketCounts() const {
+    std::vector<uint64_t> result(bounds_.size() + 1, 0);
+    for (const Shard& shard : shards_) {
+        for (size_t i = 0; i < result.size(); ++i) {
+            result[i] += shard.buckets[i].load(std::memory_order_relaxed);
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Возвращает сумму учтённых значений.
+ * @return Сумма значений.
+ */
+double Histogram::GetSum() const {
+    double result = 0.0;
+    for (const Shard& shard : shards_) {
+        result += shard.sum.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+/**
+ * @brief Возвращает границы корзин для времени выполнения в секундах: от 10 мкс до 10 с.
+ * @return Границы корзин.
+ */
+std::vector<double> GetLatencyBuckets() {
+    return {1e-5, 2.5e-5, 5e-5, 1e-4, 2.5e-4, 5e-4, 1e-3, 2.5e-3, 5e-3,
+            1e-2, 2.5e-2, 5e-2, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0};
+}
+
+/**
+ * @brief Регистрирует счётчик.
+ * @param name Имя метрики.
+ * @param help Описание метрики.
+ * @return Счётчик.
+ * @throws invalid_argument Если имя недопустимо или уже занято.
+ */
+Counter& MetricsRegistry::AddCounter(const std::string& name, const std::string& help) {
+    std::lock_guard guard(mutex_);
+    Entry& entry = AddEntry(name, help);
+    entry.counter = std::make_unique<Counter>();
+    return *entry.counter;
+}
+
+/**
+ * @brief Регистрирует значение.
+ * @param name Имя метрики.
+ * @param help Описание метрики.
+ * @return Значение.
+ * @throws invalid_argument Если имя недопустимо или уже занято.
+ */
+Gauge& MetricsRegistry::AddGauge(const std::string& name, const std::string& help) {
+    std::lock_guard guard(mutex_);
+    Entry& entry = AddEntry(name, help);
+    entry.gauge = std::make_unique<Gauge>();
+    return *entry.gauge;
+}
+
+/**
+ * @brief Регистрирует гистограмму.
+ * @param name Имя метрики.
+ * @param help Описание метрики.
+ * @param bounds Возрастающие верхние границы корзин.
+ * @return Гистограмма.
+ * @throws invalid_argument Если имя недопустимо или уже занято или границы не возрастают.
+ */
+Histogram& MetricsRegistry::AddHistogram(const std::string& name, const std::string& help,
+                                         std::vector<double> bounds) {
+    auto histogram = std::make_unique<Histogram>(std::move(bounds));
+    std::lock_guard guard(mutex_);
+    Entry& entry = AddEntry(name, help);
+    entry.histogram = std::move(histogram);
+    return *entry.histogram;
+}
+
+/**
+ * @brief Выводит все метрики в текстовом формате Prometheus 0.0.4.
+ * @return Текст метрик в порядке регистрации.
+ */
+std::string MetricsRegistry::Render() const {
+    std::ostringstream out;
+    std::lock_guard guard(mutex_);
+    for (const Entry& entry : entries_) {
+        out << "# HELP " << entry.name << ' ' << EscapeHelp(entry.help) << '\n';
+        if (entry.counter) {
+            out << "# TYPE " << entry.name << " counter\n";
+            out << entry.name << ' ' << entry.counter->GetValue() << '\n';
+        } else if (entry.gauge) {
+            out << "# TYPE " << entry.name << " gauge\n";
+            out << entry.name << ' ';
+            WriteValue(out, entry.gauge->GetValue());
+            out << '\n';
+        } else {
+            out << "# TYPE " << entry.name << " histogram\n";
+            const std::vector<double>& bounds = entry.histogram->GetBounds();
+            const std::vector<uint64_t> counts = entry.histogram->GetBucketCounts();
+            uint64_t cumulative = 0;
+            for (size_t i = 0; i < counts.size(); ++i) {
+                cumulative += counts[i];
+                out << entry.name << "_bucket{le=\"";
+                if (i < bounds.size()) {
+                    WriteValue(out, bounds[i]);
+                } else {
+                    out << "+Inf";
+                }
+                out << "\"} " << cumulative << '\n';
+            }
+            out << entry.name << "_sum ";
+            WriteValue(out, entry.histogram->GetSum());
+            out << '\n' << entry.name << "_count " << cumulative << '\n';
+        }
+    }
+    return out.str();
+}
+
+/**
+ * @brief Добавляет метрику, проверив имя.
+ */
+MetricsRegistry::Entry& MetricsRegistry::AddEntry(const std::string& name, const std::string& help) {
+    if (!IsValidMetricName(name)) {
+        throw std::invalid_argument("Invalid metric name " + name);
+    }
+    if (std::any_of(entries_.begin(), entries_.end(), [&name](const Entry& entry) { return entry.name == name; })) {
+        throw std::invalid_argument("Metric " + name + " is already registered");
+    }
+    entries_.push_back({name, help, nullptr, nullptr, nullptr});
+    return entries_.back();
+}
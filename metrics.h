@@ -0,0 +1,198 @@
+/**
+ * @file metrics.h
+ * @brief Содержит реестр метрик с выводом в текстовом формате Prometheus.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+constexpr size_t METRIC_SHARD_COUNT = 16; ///< Количество сегментов счётчиков.
+
+/**
+ * @brief Возвращает сегмент счётчиков текущего потока.
+ * @details Потоки получают сегменты по кругу при первом обращении, поэтому до METRIC_SHARD_COUNT
+ *          потоков не делят кеш-линии счётчиков.
+ * @return Номер сегмента.
+ */
+size_t GetMetricShard();
+
+/**
+ * @brief Монотонно растущий счётчик.
+ * @details Каждый поток увеличивает свой сегмент; значения сегментов складываются при чтении.
+ */
+class Counter {
+public:
+    /**
+     * @brief Увеличивает счётчик.
+     * @param value Приращение.
+     */
+    void Add(uint64_t value = 1) {
+        shards_[GetMetricShard()].value.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Возвращает значение счётчика.
+     * @return Сумма значений сегментов.
+     */
+    uint64_t GetValue() const;
+
+private:
+    /**
+     * @brief Сегмент счётчика, занимающий отдельную кеш-линию.
+     */
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> value{0};  ///< Значение сегмента.
+    };
+
+    std::array<Shard, METRIC_SHARD_COUNT> shards_;  ///< Сегменты.
+};
+
+/**
+ * @brief Значение, которое может как расти, так и уменьшаться.
+ */
+class Gauge {
+public:
+    /**
+     * @brief Задаёт значение.
+     * @param value Значение.
+     */
+    void Set(double value) {
+        value_.store(value, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Возвращает значение.
+     * @return Значение.
+     */
+    double GetValue() const {
+        return value_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<double> value_{0.0};   ///< Значение.
+};
+
+/**
+ * @brief Гистограмма распределения значений с фиксированными границами корзин.
+ * @details Как и Counter, хранит отдельные корзины и сумму для каждого сегмента потоков.
+ */
+class Histogram {
+public:
+    /**
+     * @brief Конструктор класса Histogram.
+     * @param bounds Возрастающие верхние границы корзин; корзина +Inf добавляется автоматически.
+     * @throws invalid_argument Если границы не возрастают.
+     */
+    explicit Histogram(std::vector<double> bounds);
+
+    /**
+     * @brief Учитывает значение.
+     * @param value Значение.
+     */
+    void Observe(double value);
+
+    /**
+     * @brief Возвращает верхние границы корзин без +Inf.
+     * @return Границы корзин.
+     */
+    const std::vector<double>& GetBounds() const;
+
+    /**
+     * @brief Возвращает количество значений в каждой корзине (не накопленное), последняя - +Inf.
+     * @return Количество значений по корзинам.
+     */
+    std::vector<uint64_t> GetBucketCounts() const;
+
+    /**
+     * @brief Возвращает сумму учтённых значений.
+     * @return Сумма значений.
+     */
+    double GetSum() const;
+
+private:
+    /**
+     * @brief Сегмент гистограммы.
+     */
+    struct alignas(64) Shard {
+        std::unique_ptr<std::atomic<uint64_t>[]> buckets;   ///< Количество значений по корзинам.
+        std::atomic<double> sum{0.0};                       ///< Сумма значений.
+    };
+
+    std::vector<double> bounds_;                    ///< Границы корзин.
+    std::array<Shard, METRIC_SHARD_COUNT> shards_;  ///< Сегменты.
+};
+
+/**
+ * @brief Возвращает границы корзин для времени выполнения в секундах: от 10 мкс до 10 с.
+ * @return Границы корзин.
+ */
+std::vector<double> GetLatencyBuckets();
+
+/**
+ * @brief Реестр метрик.
+ * @details Метрики создаются реестром и живут, пока жив реестр; возвращаемые ссылки стабильны.
+ *          Обновление метрик не требует блокировок, регистрация и вывод берут мьютекс реестра.
+ */
+class MetricsRegistry {
+public:
+    /**
+     * @brief Регистрирует счётчик.
+     * @param name Имя метрики, например search_server_documents_added_total.
+     * @param help Описание метрики.
+     * @return Счётчик.
+     * @throws invalid_argument Если имя недопустимо или уже занято.
+     */
+    Counter& AddCounter(const std::string& name, const std::string& help);
+
+    /**
+     * @brief Регистрирует значение.
+     * @param name Имя метрики.
+     * @param help Описание метрики.
+     * @return Значение.
+     * @throws invalid_argument Если имя недопустимо или уже занято.
+     */
+    Gauge& AddGauge(const std::string& name, const std::string& help);
+
+    /**
+     * @brief Регистрирует гистограмму.
+     * @param name Имя метрики.
+     * @param help Описание метрики.
+     * @param bounds Возрастающие верхние границы корзин.
+     * @return Гистограмма.
+     * @throws invalid_argument Если имя недопустимо или уже занято или границы не возрастают.
+     */
+    Histogram& AddHistogram(const std::string& name, const std::string& help, std::vector<double> bounds);
+
+    /**
+     * @brief Выводит все метрики в текстовом формате Prometheus 0.0.4.
+     * @return Текст метрик в порядке регистрации.
+     */
+    std::string Render() const;
+
+private:
+    /**
+     * @brief Зарегистрированная метрика.
+     */
+    struct Entry {
+        std::string name;                       ///< Имя метрики.
+        std::string help;                       ///< Описание метрики.
+        std::unique_ptr<Counter> counter;       ///< Счётчик, если метрика - счётчик.
+        std::unique_ptr<Gauge> gauge;           ///< Значение, если метрика - значение.
+        std::unique_ptr<Histogram> histogram;   ///< Гистограмма, если метрика - гистограмма.
+    };
+
+    mutable std::mutex mutex_;      ///< Мьютекс списка метрик.
+    std::vector<Entry> entries_;    ///< Метрики в порядке регистрации.
+
+    /**
+     * @brief Добавляет метрику, проверив имя.
+     */
+    Entry& AddEntry(const std::string& name, const std::string& help);
+};
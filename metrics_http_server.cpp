@@ -0,0 +1,146 @@
+#include "metrics_http_server.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+
+namespace {
+
+/**
+ * @brief Отправляет буфер целиком.
+ */
+void SendAll(int fd, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        const ssize_t result = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            return;
+        }
+        sent += static_cast<size_t>(result);
+    }
+}
+
+/**
+ * @brief Формирует HTTP-ответ.
+ */
+std::string MakeResponse(const std::string& status, const std::string& content_type, const std::string& body) {
+    return "HTTP/1.1 " + status + "\r\nContent-Type: " + content_type + "\r\nContent-Length: "
+           + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+}
+
+} // namespace
+
+/**
+ * @brief Конструктор класса MetricsHttpServer: начинает принимать соединения.
+ * @param registry Реестр метрик.
+ * @param port Порт; 0 - любой свободный.
+ * @param address IPv4-адрес, на котором принимаются соединения.
+ * @throws invalid_argument Если адрес некорректен.
+ * @throws system_error Если не удалось открыть сокет.
+ */
+MetricsHttpServer::MetricsHttpServer(const MetricsRegistry& registry, uint16_t port, const std::string& address)
+        : registry_(registry) {
+    sockaddr_in socket_address{};
+    socket_address.sin_family = AF_INET;
+    socket_address.sin_port = htons(port);
+    if (inet_pton(AF_INET, address.c_str(), &socket_address.sin_addr) != 1) {
+        throw std::invalid_argument("Invalid metrics server address " + address);
+    }
+
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        throw std::system_error(errno, std::generic_category(), "socket");
+    }
+    const int reuse = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    socklen_t length = sizeof(socket_address);
+    if (bind(listen_fd_, reinterpret_cast<const sockaddr*>(&socket_address), sizeof(socket_address)) < 0
+        || listen(listen_fd_, SOMAXCONN) < 0
+        || getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&socket_address), &length) < 0) {
+        const int error = errno;
+        close(listen_fd_);
+        throw std::system_error(error, std::generic_category(), "metrics server bind");
+    }
+    port_ = ntohs(socket_address.sin_port);
+    thread_ = std::thread(&MetricsHttpServer::Run, this);
+}
+
+/**
+ * @brief Деструктор: останавливает сервер и закрывает сокет.
+ */
+MetricsHttpServer::~MetricsHttpServer() {
+    stopping_.store(true, std::memory_order_relaxed);
+    thread_.join();
+    close(listen_fd_);
+}
+
+/**
+ * @brief Возвращает порт, на котором сервер принимает соединения.
+ * @return Порт.
+ */
+uint16_t MetricsHttpServer::GetPort() const {
+    return port_;
+}
+
+/**
+ * @brief Цикл приёма соединений.
+ */
+void MetricsHttpServer::Run() {
+    while (!stopping_.load(std::memory_order_relaxed)) {
+        pollfd listen_poll{listen_fd_, POLLIN, 0};
+        if (poll(&listen_poll, 1, POLL_INTERVAL_MS) <= 0) {
+            continue;
+        }
+        const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        HandleConnection(fd);
+        close(fd);
+    }
+}
+
+/**
+ * @brief Читает запрос и отправляет ответ.
+ * @param fd Сокет соединения.
+ */
+void MetricsHttpServer::HandleConnection(int fd) const {
+    timeval timeout{RECEIVE_TIMEOUT_MS / 1000, (RECEIVE_TIMEOUT_MS % 1000) * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    // Тело запроса не нужно: достаточно дочитать заголовки
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < MAX_REQUEST_SIZE) {
+        const ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return;
+        }
+        request.append(buffer, static_cast<size_t>(received));
+    }
+
+    const std::string request_line = request.substr(0, request.find("\r\n"));
+    if (request_line.rfind("GET ", 0) != 0) {
+        SendAll(fd, MakeResponse("405 Method Not Allowed", "text/plain", "Only GET is supported\n"));
+        return;
+    }
+    const size_t path_end = request_line.find(' ', 4);
+    const std::string path = request_line.substr(4, path_end == std::string::npos ? std::string::npos : path_end - 4);
+    if (path == "/metrics") {
+        SendAll(fd, MakeResponse("200 OK", "text/plain; version=0.0.4; charset=utf-8", registry_.Render()));
+    } else {
+        SendAll(fd, MakeResponse("404 Not Found", "text/plain", "Not found\n"));
+    }
+}
@@ -0,0 +1,68 @@
+/**
+ * @file metrics_http_server.h
+ * @brief Содержит минимальный HTTP-сервер, отдающий метрики в формате Prometheus.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include "metrics.h"
+
+/**
+ * @brief HTTP-сервер метрик.
+ * @details Обслуживает запросы по одному в фоновом потоке: GET /metrics возвращает
+ *          MetricsRegistry::Render, остальные пути - 404. Соединение закрывается после ответа.
+ */
+class MetricsHttpServer {
+public:
+    /**
+     * @brief Конструктор класса MetricsHttpServer: начинает принимать соединения.
+     * @param registry Реестр метрик; должен жить дольше сервера.
+     * @param port Порт; 0 - любой свободный, см. GetPort.
+     * @param address IPv4-адрес, на котором принимаются соединения.
+     * @throws invalid_argument Если адрес некорректен.
+     * @throws system_error Если не удалось открыть сокет.
+     */
+    explicit MetricsHttpServer(const MetricsRegistry& registry, uint16_t port = 0,
+                               const std::string& address = "127.0.0.1");
+
+    MetricsHttpServer(const MetricsHttpServer&) = delete;
+    MetricsHttpServer& operator=(const MetricsHttpServer&) = delete;
+
+    /**
+     * @brief Деструктор: останавливает сервер и закрывает сокет.
+     */
+    ~MetricsHttpServer();
+
+    /**
+     * @brief Возвращает порт, на котором сервер принимает соединения.
+     * @return Порт.
+     */
+    uint16_t GetPort() const;
+
+private:
+    static constexpr int POLL_INTERVAL_MS = 100;        ///< Период проверки признака остановки.
+    static constexpr int RECEIVE_TIMEOUT_MS = 1000;     ///< Время ожидания запроса от клиента.
+    static constexpr size_t MAX_REQUEST_SIZE = 8192;    ///< Максимальный размер заголовков запроса.
+
+    const MetricsRegistry& registry_;   ///< Реестр метрик.
+    int listen_fd_ = -1;                ///< Слушающий сокет.
+    uint16_t port_ = 0;                 ///< Порт.
+    std::atomic<bool> stopping_{false}; ///< Признак остановки.
+    std::thread thread_;                ///< Поток обслуживания.
+
+    /**
+     * @brief Цикл приёма соединений.
+     */
+    void Run();
+
+    /**
+     * @brief Читает запрос и отправляет ответ.
+     * @param fd Сокет соединения.
+     */
+    void HandleConnection(int fd) const;
+};
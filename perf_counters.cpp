@@ -0,0 +1,168 @@
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+
+/**
+ * @brief Возвращает разность значений счётчиков.
+ * @param other Вычитаемые значения.
+ * @return Разность.
+ */
+PerfSample PerfSample::operator-(const PerfSample& other) const {
+    PerfSample result;
+    for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+        result.values[i] = values[i] - other.values[i];
+    }
+    return result;
+}
+
+/**
+ * @brief Прибавляет значения счётчиков.
+ * @param other Прибавляемые значения.
+ * @return Ссылка на себя.
+ */
+PerfSample& PerfSample::operator+=(const PerfSample& other) {
+    for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+        values[i] += other.values[i];
+    }
+    return *this;
+}
+
+#ifdef __linux__
+namespace {
+
+/**
+ * @brief Открывает счётчик события для текущего потока.
+ * @return Дескриптор счётчика; -1, если событие недоступно.
+ */
+int OpenCounter(PerfEvent event) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    switch (event) {
+        case PerfEvent::CYCLES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case PerfEvent::INSTRUCTIONS:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case PerfEvent::LLC_MISSES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+        case PerfEvent::BRANCH_MISSES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        case PerfEvent::DTLB_MISSES:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                          | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+    }
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+} // namespace
+#endif
+
+/**
+ * @brief Конструктор класса PerfCounters: открывает и запускает доступные счётчики.
+ */
+PerfCounters::PerfCounters() {
+    for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+#ifdef __linux__
+        descriptors_[i] = OpenCounter(static_cast<PerfEvent>(i));
+#else
+        descriptors_[i] = -1;
+#endif
+    }
+}
+
+/**
+ * @brief Деструктор: закрывает счётчики.
+ */
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+    for (const int descriptor : descriptors_) {
+        if (descriptor >= 0) {
+            close(descriptor);
+        }
+    }
+#endif
+}
+
+/**
+ * @brief Проверяет, доступен ли счётчик события.
+ * @param event Событие.
+ * @return true, если счётчик открыт.
+ */
+bool PerfCounters::IsAvailable(PerfEvent event) const {
+    return descriptors_[static_cast<size_t>(event)] >= 0;
+}
+
+/**
+ * @brief Проверяет, доступен ли хотя бы один счётчик.
+ * @return true, если открыт хотя бы один счётчик.
+ */
+bool PerfCounters::IsAnyAvailable() const {
+    for (const int descriptor : descriptors_) {
+        if (descriptor >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Читает текущие значения счётчиков.
+ * @return Значения с момента открытия счётчиков.
+ */
+PerfSample PerfCounters::Read() const {
+    PerfSample sample;
+#ifdef __linux__
+    for (size_t i = 0; i < PERF_EVENT_COUNT; ++i) {
+        if (descriptors_[i] < 0) {
+            continue;
+        }
+        // Значение, время включения и время фактического счёта
+        uint64_t data[3] = {};
+        if (read(descriptors_[i], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data)) || data[2] == 0) {
+            continue;
+        }
+        sample.values[i] = static_cast<double>(data[0]) * static_cast<double>(data[1]) / static_cast<double>(data[2]);
+    }
+#endif
+    return sample;
+}
+
+/**
+ * @brief Возвращает название события.
+ * @param event Событие.
+ * @return Название события.
+ */
+const char* PerfCounters::GetEventName(PerfEvent event) {
+    switch (event) {
+        case PerfEvent::CYCLES:
+            return "cycles";
+        case PerfEvent::INSTRUCTIONS:
+            return "instructions";
+        case PerfEvent::LLC_MISSES:
+            return "llc-misses";
+        case PerfEvent::BRANCH_MISSES:
+            return "branch-misses";
+        case PerfEvent::DTLB_MISSES:
+            return "dtlb-misses";
+    }
+    return "unknown";
+}
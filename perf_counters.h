@@ -0,0 +1,107 @@
+/**
+ * @file perf_counters.h
+ * @brief Содержит чтение аппаратных счётчиков производительности Linux (perf_event_open).
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Аппаратное событие.
+ */
+enum class PerfEvent {
+    CYCLES,         ///< Такты процессора.
+    INSTRUCTIONS,   ///< Выполненные инструкции.
+    LLC_MISSES,     ///< Промахи кеша последнего уровня.
+    BRANCH_MISSES,  ///< Неверно предсказанные переходы.
+    DTLB_MISSES,    ///< Промахи TLB данных при чтении.
+};
+
+constexpr size_t PERF_EVENT_COUNT = 5; ///< Количество событий PerfEvent.
+
+/**
+ * @brief Значения счётчиков.
+ */
+struct PerfSample {
+    std::array<double, PERF_EVENT_COUNT> values = {};   ///< Значения счётчиков, индексируемые PerfEvent.
+
+    /**
+     * @brief Возвращает значение счётчика события.
+     * @param event Событие.
+     * @return Значение счётчика.
+     */
+    double operator[](PerfEvent event) const {
+        return values[static_cast<size_t>(event)];
+    }
+
+    /**
+     * @brief Возвращает разность значений счётчиков.
+     * @param other Вычитаемые значения.
+     * @return Разность.
+     */
+    PerfSample operator-(const PerfSample& other) const;
+
+    /**
+     * @brief Прибавляет значения счётчиков.
+     * @param other Прибавляемые значения.
+     * @return Ссылка на себя.
+     */
+    PerfSample& operator+=(const PerfSample& other);
+};
+
+/**
+ * @brief Счётчики производительности текущего потока.
+ * @details Каждое событие открывается отдельным счётчиком только для пользовательского режима
+ *          (exclude_kernel), что разрешено при kernel.perf_event_paranoid <= 2. События, которые
+ *          ядро или процессор не поддерживают (например, в контейнере или виртуальной машине),
+ *          пропускаются: IsAvailable возвращает false, а их значения остаются нулевыми. Если
+ *          счётчиков больше, чем аппаратных регистров, значения масштабируются по доле времени,
+ *          в течение которой счётчик был активен.
+ */
+class PerfCounters {
+public:
+    /**
+     * @brief Конструктор класса PerfCounters: открывает и запускает доступные счётчики.
+     */
+    PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    /**
+     * @brief Деструктор: закрывает счётчики.
+     */
+    ~PerfCounters();
+
+    /**
+     * @brief Проверяет, доступен ли счётчик события.
+     * @param event Событие.
+     * @return true, если счётчик открыт.
+     */
+    bool IsAvailable(PerfEvent event) const;
+
+    /**
+     * @brief Проверяет, доступен ли хотя бы один счётчик.
+     * @return true, если открыт хотя бы один счётчик.
+     */
+    bool IsAnyAvailable() const;
+
+    /**
+     * @brief Читает текущие значения счётчиков.
+     * @return Значения с момента открытия счётчиков.
+     */
+    PerfSample Read() const;
+
+    /**
+     * @brief Возвращает название события.
+     * @param event Событие.
+     * @return Название события.
+     */
+    static const char* GetEventName(PerfEvent event);
+
+private:
+    std::array<int, PERF_EVENT_COUNT> descriptors_; ///< Дескрипторы счётчиков; -1, если недоступен.
+};
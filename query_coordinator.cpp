@@ -0,0 +1,275 @@
+#include "query_coordinator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+/**
+ * @brief Конструктор класса QueryCoordinator: запускает потоки реплик.
+ * @param replicas Реплики.
+ * @param options Параметры координатора.
+ * @throws invalid_argument Если реплик нет или параметры некорректны.
+ */
+QueryCoordinator::QueryCoordinator(std::vector<QueryEngine> replicas, const CoordinatorOptions& options)
+        : options_(options)
+        , hedge_delay_(std::chrono::duration_cast<std::chrono::nanoseconds>(options.initial_hedge_delay).count()) {
+    if (replicas.empty()) {
+        throw std::invalid_argument("Coordinator requires at least one replica");
+    }
+    if (!(options.hedge_quantile > 0.0 && options.hedge_quantile <= 1.0)
+        || !(options.ewma_alpha > 0.0 && options.ewma_alpha <= 1.0) || options.latency_window == 0) {
+        throw std::invalid_argument("Invalid coordinator options");
+    }
+    latencies_.reserve(options.latency_window);
+    for (QueryEngine& engine : replicas) {
+        auto replica = std::make_unique<Replica>();
+        replica->engine = std::move(engine);
+        replicas_.push_back(std::move(replica));
+    }
+    for (size_t i = 0; i < replicas_.size(); ++i) {
+        replicas_[i]->thread = std::thread(&QueryCoordinator::Run, this, i);
+    }
+}
+
+/**
+ * @brief Деструктор: останавливает потоки реплик после текущих запросов.
+ */
+QueryCoordinator::~QueryCoordinator() {
+    stopping_.store(true, std::memory_order_relaxed);
+    for (const auto& replica : replicas_) {
+        {
+            std::lock_guard guard(replica->mutex);
+        }
+        replica->condition.notify_all();
+        replica->thread.join();
+    }
+}
+
+/**
+ * @brief Поиск топовых документов по запросу с указанным статусом.
+ * @param raw_query Необработанный запрос.
+ * @param status Статус документа для поиска.
+ * @return Первый полученный ответ реплики.
+ * @throws Исключение последней реплики, если все выбранные реплики завершились исключением.
+ * @throws runtime_error Если ответ не получен за время ожидания.
+ */
+std::vector<Document> QueryCoordinator::FindTopDocuments(const std::string& raw_query, DocumentStatus status) const {
+    queries_.fetch_add(1, std::memory_order_relaxed);
+    auto call = std::make_shared<Call>();
+    call->raw_query = raw_query;
+    call->status = status;
+
+    const auto start = std::chrono::steady_clock::now();
+    const size_t primary = ChooseReplica(replicas_.size());
+    Enqueue(primary, call);
+    size_t sent = 1;
+
+    std::unique_lock lock(call->mutex);
+    const auto hedge_at = start + std::chrono::nanoseconds(hedge_delay_.load(std::memory_order_relaxed));
+    call->condition.wait_until(lock, hedge_at, [&call] {
+        return call->answered || call->failures > 0;
+    });
+    if (!call->answered && replicas_.size() > 1) {
+        lock.unlock();
+        Enqueue(ChooseReplica(primary), call);
+        hedged_.fetch_add(1, std::memory_order_relaxed);
+        ++sent;
+        lock.lock();
+    }
+
+    call->condition.wait_until(lock, start + options_.timeout, [&call, sent] {
+        return call->answered || call->failures == sent;
+    });
+    if (call->answered) {
+        if (sent > 1 && call->winner != primary) {
+            hedge_wins_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return std::move(call->result);
+    }
+    // Ответ уже не нужен: ещё не начатые копии запроса будут сняты из очередей
+    call->answered = true;
+    failures_.fetch_add(1, std::memory_order_relaxed);
+    if (call->failures == sent) {
+        std::rethrow_exception(call->error);
+    }
+    throw std::runtime_error("Query timed out in QueryCoordinator");
+}
+
+/**
+ * @brief Возвращает текущую задержку дублирования.
+ * @return Задержка.
+ */
+std::chrono::nanoseconds QueryCoordinator::GetHedgeDelay() const {
+    return std::chrono::nanoseconds(hedge_delay_.load(std::memory_order_relaxed));
+}
+
+/**
+ * @brief Возвращает состояние реплики.
+ * @param replica Номер реплики.
+ * @return Состояние.
+ * @throws out_of_range Если реплики нет.
+ */
+ReplicaStats QueryCoordinator::GetReplicaStats(size_t replica) const {
+    const Replica& data = *replicas_.at(replica);
+    std::lock_guard guard(data.mutex);
+    ReplicaStats stats;
+    stats.latency_ewma = std::chrono::nanoseconds(std::llround(data.latency_ewma));
+    stats.queued = data.tasks.size() + (data.busy ? 1 : 0);
+    stats.completed = data.completed;
+    stats.failed = data.failed;
+    stats.cancelled = data.cancelled;
+    return stats;
+}
+
+/**
+ * @brief Возвращает статистику координатора.
+ * @return Статистика.
+ */
+CoordinatorStats QueryCoordinator::GetStats() const {
+    CoordinatorStats stats;
+    stats.queries = queries_.load(std::memory_order_relaxed);
+    stats.hedged = hedged_.load(std::memory_order_relaxed);
+    stats.hedge_wins = hedge_wins_.load(std::memory_order_relaxed);
+    stats.failures = failures_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+/**
+ * @brief Выбирает реплику с наименьшей ожидаемой задержкой.
+ * @param excluded Реплика, которую нельзя выбрать.
+ */
+size_t QueryCoordinator::ChooseReplica(size_t excluded) const {
+    // Реплика без статистики получает нулевую оценку и поэтому быстро опробуется
+    size_t best = replicas_.size();
+    double best_cost = 0.0;
+    for (size_t i = 0; i < replicas_.size(); ++i) {
+        if (i == excluded) {
+            continue;
+        }
+        Replica& replica = *replicas_[i];
+        std::lock_guard guard(replica.mutex);
+        const double queued = static_cast<double>(replica.tasks.size() + (replica.busy ? 1 : 0));
+        const double cost = replica.latency_ewma * (queued + 1.0);
+        if (best == replicas_.size() || cost < best_cost) {
+            best = i;
+            best_cost = cost;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Ставит запрос в очередь реплики.
+ */
+void QueryCoordinator::Enqueue(size_t replica, const std::shared_ptr<Call>& call) const {
+    Replica& data = *replicas_[replica];
+    {
+        std::lock_guard guard(data.mutex);
+        data.tasks.push_back({call});
+    }
+    data.condition.notify_one();
+}
+
+/**
+ * @brief Цикл потока реплики.
+ */
+void QueryCoordinator::Run(size_t replica_index) {
+    Replica& replica = *replicas_[replica_index];
+    for (;;) {
+        Task task;
+        {
+            std::unique_lock lock(replica.mutex);
+            replica.busy = false;
+            replica.condition.wait(lock, [this, &replica] {
+                return !replica.tasks.empty() || stopping_.load(std::memory_order_relaxed);
+            });
+            if (replica.tasks.empty()) {
+                return;
+            }
+            task = std::move(replica.tasks.front());
+            replica.tasks.pop_front();
+            replica.busy = true;
+        }
+
+        Call& call = *task.call;
+        bool cancelled;
+        {
+            std::lock_guard guard(call.mutex);
+            cancelled = call.answered;
+        }
+        if (cancelled) {
+            std::lock_guard guard(replica.mutex);
+            ++replica.cancelled;
+            continue;
+        }
+
+        // Время ответа измеряется от начала выполнения: ожидание в очереди уже учтено множителем
+        // длины очереди в ChooseReplica, а квантиль должен отражать время обслуживания
+        std::vector<Document> result;
+        std::exception_ptr error;
+        const auto started = std::chrono::steady_clock::now();
+        try {
+            result = replica.engine(call.raw_query, call.status);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        const auto latency = std::chrono::steady_clock::now() - started;
+        if (error) {
+            std::lock_guard guard(replica.mutex);
+            ++replica.failed;
+        } else {
+            RecordLatency(replica, latency);
+        }
+
+        {
+            std::lock_guard guard(call.mutex);
+            if (call.answered) {
+                continue;
+            }
+            if (error) {
+                ++call.failures;
+                call.error = error;
+            } else {
+                call.answered = true;
+                call.winner = replica_index;
+                call.result = std::move(result);
+            }
+        }
+        call.condition.notify_all();
+    }
+}
+
+/**
+ * @brief Учитывает время ответа реплики.
+ */
+void QueryCoordinator::RecordLatency(Replica& replica, std::chrono::nanoseconds latency) {
+    const double nanoseconds = static_cast<double>(latency.count());
+    {
+        std::lock_guard guard(replica.mutex);
+        ++replica.completed;
+        replica.latency_ewma = replica.completed == 1
+                ? nanoseconds
+                : replica.latency_ewma + options_.ewma_alpha * (nanoseconds - replica.latency_ewma);
+    }
+
+    std::lock_guard guard(latency_mutex_);
+    if (latencies_.size() < options_.latency_window) {
+        latencies_.push_back(latency.count());
+    } else {
+        latencies_[latency_next_] = latency.count();
+    }
+    latency_next_ = (latency_next_ + 1) % options_.latency_window;
+    // Квантиль пересчитывается пачками: выбор порядковой статистики линеен по размеру окна
+    if (++latency_updates_ < HEDGE_DELAY_UPDATE_PERIOD) {
+        return;
+    }
+    latency_updates_ = 0;
+    std::vector<int64_t> sorted = latencies_;
+    const size_t rank = std::min(sorted.size() - 1,
+                                 static_cast<size_t>(options_.hedge_quantile * static_cast<double>(sorted.size())));
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    const int64_t min_delay = std::chrono::duration_cast<std::chrono::nanoseconds>(options_.min_hedge_delay).count();
+    hedge_delay_.store(std::max(sorted[rank], min_delay), std::memory_order_relaxed);
+}
@@ -0,0 +1,192 @@
+/**
+ * @file query_coordinator.h
+ * @brief Содержит координатор запросов к репликам поисковой системы с дублированием медленных запросов.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "document.h"
+#include "shadow_executor.h"
+
+/**
+ * @brief Параметры координатора запросов.
+ */
+struct CoordinatorOptions {
+    double hedge_quantile = 0.95;                                   ///< Квантиль времени ответа, после которого запрос дублируется.
+    std::chrono::microseconds min_hedge_delay{200};                 ///< Минимальная задержка дублирования.
+    std::chrono::microseconds initial_hedge_delay{10000};           ///< Задержка дублирования до накопления статистики.
+    size_t latency_window = 1024;                                   ///< Количество последних ответов для оценки квантиля.
+    double ewma_alpha = 0.1;                                        ///< Вес нового ответа в скользящем среднем реплики.
+    std::chrono::milliseconds timeout{5000};                        ///< Максимальное время ожидания ответа.
+};
+
+/**
+ * @brief Состояние реплики.
+ */
+struct ReplicaStats {
+    std::chrono::nanoseconds latency_ewma{0};   ///< Экспоненциальное скользящее среднее времени ответа.
+    size_t queued = 0;                          ///< Запросы в очереди и в работе.
+    uint64_t completed = 0;                     ///< Выполненные запросы.
+    uint64_t failed = 0;                        ///< Запросы, завершившиеся исключением.
+    uint64_t cancelled = 0;                     ///< Запросы, снятые до начала выполнения, так как ответ уже получен.
+};
+
+/**
+ * @brief Статистика координатора.
+ */
+struct CoordinatorStats {
+    uint64_t queries = 0;       ///< Запросы.
+    uint64_t hedged = 0;        ///< Запросы, отправленные второй реплике.
+    uint64_t hedge_wins = 0;    ///< Дублированные запросы, на которые первой ответила вторая реплика.
+    uint64_t failures = 0;      ///< Запросы без ответа: все реплики завершились исключением или истекло время.
+};
+
+/**
+ * @brief Координатор запросов к репликам с дублированием медленных запросов.
+ * @details Запрос отправляется реплике с наименьшей ожидаемой задержкой: скользящее среднее времени
+ *          ответа, умноженное на длину её очереди. Если ответа нет дольше заданного квантиля
+ *          последних времён ответа (или первая реплика завершилась исключением), запрос
+ *          отправляется следующей реплике и возвращается первый ответ. Каждая реплика обслуживается
+ *          своим потоком по одному запросу; запрос проигравшей реплики, не начатый к моменту ответа,
+ *          снимается из очереди, начатый - доводится до конца, но его результат отбрасывается.
+ */
+class QueryCoordinator {
+public:
+    /**
+     * @brief Конструктор класса QueryCoordinator: запускает потоки реплик.
+     * @param replicas Реплики; каждую вызывает только её поток.
+     * @param options Параметры координатора.
+     * @throws invalid_argument Если реплик нет или параметры некорректны.
+     */
+    explicit QueryCoordinator(std::vector<QueryEngine> replicas, const CoordinatorOptions& options = {});
+
+    QueryCoordinator(const QueryCoordinator&) = delete;
+    QueryCoordinator& operator=(const QueryCoordinator&) = delete;
+
+    /**
+     * @brief Деструктор: останавливает потоки реплик после текущих запросов.
+     * @details Выполняемый запрос доводится до конца, поэтому движки должны ограничивать время
+     *          ожидания сами, как это делает ConnectReplica.
+     */
+    ~QueryCoordinator();
+
+    /**
+     * @brief Поиск топовых документов по запросу с указанным статусом.
+     * @param raw_query Необработанный запрос.
+     * @param status Статус документа для поиска (по умолчанию DocumentStatus::ACTUAL).
+     * @return Первый полученный ответ реплики.
+     * @throws Исключение последней реплики, если все выбранные реплики завершились исключением.
+     * @throws runtime_error Если ответ не получен за время ожидания.
+     */
+    std::vector<Document> FindTopDocuments(const std::string& raw_query,
+                                           DocumentStatus status = DocumentStatus::ACTUAL) const;
+
+    /**
+     * @brief Возвращает текущую задержку дублирования.
+     * @return Задержка.
+     */
+    std::chrono::nanoseconds GetHedgeDelay() const;
+
+    /**
+     * @brief Возвращает состояние реплики.
+     * @param replica Номер реплики.
+     * @return Состояние.
+     * @throws out_of_range Если реплики нет.
+     */
+    ReplicaStats GetReplicaStats(size_t replica) const;
+
+    /**
+     * @brief Возвращает статистику координатора.
+     * @return Статистика.
+     */
+    CoordinatorStats GetStats() const;
+
+private:
+    static constexpr size_t HEDGE_DELAY_UPDATE_PERIOD = 64; ///< Количество ответов между пересчётами квантиля.
+
+    /**
+     * @brief Запрос, отправленный одной или двум репликам.
+     */
+    struct Call {
+        std::string raw_query;                      ///< Необработанный запрос.
+        DocumentStatus status;                      ///< Статус документов запроса.
+        std::mutex mutex;                           ///< Мьютекс состояния.
+        std::condition_variable condition;          ///< Уведомление о завершении.
+        bool answered = false;                      ///< Получен ли ответ.
+        size_t winner = 0;                          ///< Реплика, ответившая первой.
+        size_t failures = 0;                        ///< Количество реплик, завершившихся исключением.
+        std::vector<Document> result;               ///< Ответ.
+        std::exception_ptr error;                   ///< Последнее исключение реплики.
+    };
+
+    /**
+     * @brief Запрос в очереди реплики.
+     */
+    struct Task {
+        std::shared_ptr<Call> call;     ///< Запрос.
+    };
+
+    /**
+     * @brief Реплика и её поток.
+     */
+    struct Replica {
+        QueryEngine engine;                     ///< Реплика.
+        mutable std::mutex mutex;               ///< Мьютекс очереди и статистики.
+        std::condition_variable condition;      ///< Уведомление о новом запросе.
+        std::deque<Task> tasks;                 ///< Очередь запросов.
+        bool busy = false;                      ///< Выполняется ли запрос.
+        double latency_ewma = 0.0;              ///< Скользящее среднее времени ответа, нс.
+        uint64_t completed = 0;                 ///< Выполненные запросы.
+        uint64_t failed = 0;                    ///< Завершившиеся исключением.
+        uint64_t cancelled = 0;                 ///< Снятые из очереди.
+        std::thread thread;                     ///< Поток реплики.
+    };
+
+    CoordinatorOptions options_;                            ///< Параметры.
+    std::vector<std::unique_ptr<Replica>> replicas_;        ///< Реплики.
+    std::atomic<bool> stopping_{false};                     ///< Признак остановки.
+
+    mutable std::mutex latency_mutex_;                      ///< Мьютекс окна времён ответа.
+    std::vector<int64_t> latencies_;                        ///< Кольцевой буфер последних времён ответа, нс.
+    size_t latency_next_ = 0;                               ///< Позиция следующей записи в буфере.
+    size_t latency_updates_ = 0;                            ///< Ответы с последнего пересчёта квантиля.
+    std::atomic<int64_t> hedge_delay_;                      ///< Текущая задержка дублирования, нс.
+
+    mutable std::atomic<uint64_t> queries_{0};              ///< Запросы.
+    mutable std::atomic<uint64_t> hedged_{0};               ///< Дублированные запросы.
+    mutable std::atomic<uint64_t> hedge_wins_{0};           ///< Победы второй реплики.
+    mutable std::atomic<uint64_t> failures_{0};             ///< Запросы без ответа.
+
+    /**
+     * @brief Выбирает реплику с наименьшей ожидаемой задержкой.
+     * @param excluded Реплика, которую нельзя выбрать; replicas_.size() - нет такой.
+     */
+    size_t ChooseReplica(size_t excluded) const;
+
+    /**
+     * @brief Ставит запрос в очередь реплики.
+     */
+    void Enqueue(size_t replica, const std::shared_ptr<Call>& call) const;
+
+    /**
+     * @brief Цикл потока реплики.
+     */
+    void Run(size_t replica);
+
+    /**
+     * @brief Учитывает время ответа реплики.
+     */
+    void RecordLatency(Replica& replica, std::chrono::nanoseconds latency);
+};
@@ -0,0 +1,245 @@
+#include "query_log.h"
+
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+#include "lz_compression.h"
+#include "varint.h"
+
+/**
+ * @brief Конструктор класса QueryLogWriter.
+ * @param path Путь к файлу журнала; существующий файл перезаписывается.
+ * @param queue_capacity Вместимость очереди записей; степень двойки.
+ * @throws invalid_argument Если файл не удалось открыть.
+ */
+QueryLogWriter::QueryLogWriter(const std::string& path, size_t queue_capacity)
+        : queue_(queue_capacity)
+        , output_(path, std::ios::binary | std::ios::trunc) {
+    if (!output_) {
+        throw std::invalid_argument("Cannot open query log " + path);
+    }
+    output_.write(MAGIC, sizeof(MAGIC) - 1);
+    block_.reserve(FLUSH_BLOCK_SIZE + 256);
+    flusher_ = std::thread(&QueryLogWriter::Run, this);
+}
+
+/**
+ * @brief Деструктор: записывает оставшиеся в очереди записи и закрывает файл.
+ */
+QueryLogWriter::~QueryLogWriter() {
+    {
+        std::lock_guard guard(wake_mutex_);
+        stopping_.store(true, std::memory_order_release);
+    }
+    wake_.notify_one();
+    flusher_.join();
+}
+
+/**
+ * @brief Ставит запись в очередь на запись.
+ * @param entry Запись журнала.
+ * @return true, если запись принята; false, если очередь заполнена и запись отброшена.
+ */
+bool QueryLogWriter::Append(QueryLogEntry entry) {
+    if (!queue_.TryPush(entry)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    // Последовательная согласованность pushed_ и sleeping_: либо поток увидит запись
+    // перед сном, либо мы увидим, что он спит
+    pushed_.fetch_add(1, std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_seq_cst)) {
+        std::lock_guard guard(wake_mutex_);
+        wake_.notify_one();
+    }
+    return true;
+}
+
+/**
+ * @brief Возвращает количество отброшенных записей.
+ * @return Количество записей, не поместившихся в очередь.
+ */
+uint64_t QueryLogWriter::GetDroppedCount() const {
+    return dropped_.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Возвращает количество блоков, не записанных в файл из-за ошибки.
+ * @return Количество потерянных блоков.
+ */
+uint64_t QueryLogWriter::GetLostBlockCount() const {
+    return lost_blocks_.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Возвращает текст первой ошибки фонового потока.
+ * @return Текст ошибки; пустая строка, если ошибок не было.
+ */
+std::string QueryLogWriter::GetError() const {
+    std::lock_guard guard(error_mutex_);
+    return error_;
+}
+
+/**
+ * @brief Цикл фонового потока.
+ */
+void QueryLogWriter::Run() {
+    auto last_flush = std::chrono::steady_clock::now();
+    uint64_t popped = 0;
+    QueryLogEntry entry;
+    for (;;) {
+        // Признак читаем до опустошения очереди: после него новых записей уже не будет
+        const bool stopping = stopping_.load(std::memory_order_acquire);
+        while (queue_.TryPop(entry)) {
+            ++popped;
+            // Исключение в фоновом потоке завершило бы процесс; запись тогда считается отброшенной
+            try {
+                Encode(entry);
+            } catch (const std::exception& e) {
+                RecordError(e.what());
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (block_.size() >= FLUSH_BLOCK_SIZE) {
+                FlushBlock();
+                last_flush = std::chrono::steady_clock::now();
+            }
+        }
+        if (stopping) {
+            break;
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if (!block_.empty() && now - last_flush >= FLUSH_INTERVAL) {
+            FlushBlock();
+            last_flush = now;
+        }
+
+        // Спим до новой записи, до срока сброса неполного блока или до остановки
+        std::unique_lock lock(wake_mutex_);
+        sleeping_.store(true, std::memory_order_seq_cst);
+        const auto has_work = [this, popped] {
+            return pushed_.load(std::memory_order_seq_cst) != popped || stopping_.load(std::memory_order_acquire);
+        };
+        if (block_.empty()) {
+            wake_.wait(lock, has_work);
+        } else {
+            wake_.wait_until(lock, last_flush + FLUSH_INTERVAL, has_work);
+        }
+        sleeping_.store(false, std::memory_order_relaxed);
+    }
+    FlushBlock();
+}
+
+/**
+ * @brief Кодирует запись в текущий блок.
+ */
+void QueryLogWriter::Encode(const QueryLogEntry& entry) {
+    AppendVarint(block_, ZigzagEncode(entry.timestamp - last_timestamp_));
+    last_timestamp_ = entry.timestamp;
+    AppendVarint(block_, entry.raw_query.size());
+    block_ += entry.raw_query;
+    block_.push_back(static_cast<char>(entry.tag));
+    AppendVarint(block_, entry.result_count);
+    AppendVarint(block_, entry.latency);
+}
+
+/**
+ * @brief Сжимает текущий блок, пишет его в файл и сбрасывает файл.
+ */
+void QueryLogWriter::FlushBlock() {
+    if (block_.empty()) {
+        return;
+    }
+    bool written = false;
+    if (output_) {
+        try {
+            const std::string compressed = LzCompress(block_);
+            std::string header;
+            AppendVarint(header, block_.size());
+            AppendVarint(header, compressed.size());
+            output_.write(header.data(), header.size());
+            output_.write(compressed.data(), compressed.size());
+            // Блок, оставшийся в буфере ofstream, потерялся бы при падении процесса
+            output_.flush();
+            written = static_cast<bool>(output_);
+            if (!written) {
+                RecordError("Cannot write query log block");
+            }
+        } catch (const std::exception& e) {
+            RecordError(e.what());
+        }
+    }
+    if (!written) {
+        lost_blocks_.fetch_add(1, std::memory_order_relaxed);
+    }
+    // Каждый блок декодируется независимо
+    block_.clear();
+    last_timestamp_ = 0;
+}
+
+/**
+ * @brief Запоминает ошибку фонового потока, если она первая.
+ * @param message Текст ошибки.
+ */
+void QueryLogWriter::RecordError(const std::string& message) {
+    std::lock_guard guard(error_mutex_);
+    if (error_.empty()) {
+        error_ = message;
+    }
+}
+
+/**
+ * @brief Читает журнал запросов.
+ * @param path Путь к файлу журнала.
+ * @return Записи журнала в порядке записи.
+ * @throws invalid_argument Если файл не удалось открыть или он повреждён.
+ */
+std::vector<QueryLogEntry> ReadQueryLog(const std::string& path) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        throw std::invalid_argument("Cannot open query log " + path);
+    }
+    const std::string content{std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()};
+    std::string_view data = content;
+    const std::string_view magic(QueryLogWriter::MAGIC, sizeof(QueryLogWriter::MAGIC) - 1);
+    if (data.substr(0, magic.size()) != magic) {
+        throw std::invalid_argument("Not a query log: " + path);
+    }
+    data.remove_prefix(magic.size());
+
+    std::vector<QueryLogEntry> entries;
+    while (!data.empty()) {
+        const uint64_t raw_size = ReadVarint(data);
+        const uint64_t compressed_size = ReadVarint(data);
+        if (compressed_size > data.size()) {
+            throw std::invalid_argument("Truncated query log block");
+        }
+        const std::string block = LzDecompress(data.substr(0, compressed_size), raw_size);
+        data.remove_prefix(compressed_size);
+
+        std::string_view records = block;
+        int64_t timestamp = 0;
+        while (!records.empty()) {
+            QueryLogEntry entry;
+            timestamp += ZigzagDecode(ReadVarint(records));
+            entry.timestamp = timestamp;
+            const uint64_t query_size = ReadVarint(records);
+            if (query_size + 1 > records.size()) {
+                throw std::invalid_argument("Truncated query log record");
+            }
+            entry.raw_query = std::string(records.substr(0, query_size));
+            records.remove_prefix(query_size);
+            const auto tag = static_cast<uint8_t>(records.front());
+            if (tag > static_cast<uint8_t>(QueryLogTag::PREDICATE)) {
+                throw std::invalid_argument("Invalid query log tag");
+            }
+            entry.tag = static_cast<QueryLogTag>(tag);
+            records.remove_prefix(1);
+            entry.result_count = static_cast<uint32_t>(ReadVarint(records));
+            entry.latency = static_cast<uint32_t>(ReadVarint(records));
+            entries.push_back(std::move(entry));
+        }
+    }
+    return entries;
+}
@@ -0,0 +1,152 @@
+/**
+ * @file query_log.h
+ * @brief Содержит запись и чтение сжатого двоичного журнала запросов.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.h"
+
+/**
+ * @brief Вид фильтра, с которым выполнялся запрос.
+ * @details Значения от ACTUAL до REMOVED совпадают с DocumentStatus.
+ */
+enum class QueryLogTag : uint8_t {
+    ACTUAL,         ///< Поиск по статусу ACTUAL.
+    IRRELEVANT,     ///< Поиск по статусу IRRELEVANT.
+    BANNED,         ///< Поиск по статусу BANNED.
+    REMOVED,        ///< Поиск по статусу REMOVED.
+    PREDICATE       ///< Поиск с пользовательским предикатом.
+};
+
+/**
+ * @brief Запись журнала запросов.
+ */
+struct QueryLogEntry {
+    int64_t timestamp = 0;                      ///< Время запроса в микросекундах от эпохи system_clock.
+    std::string raw_query;                      ///< Необработанный запрос.
+    QueryLogTag tag = QueryLogTag::ACTUAL;      ///< Вид фильтра.
+    uint32_t result_count = 0;                  ///< Количество найденных документов.
+    uint32_t latency = 0;                       ///< Время выполнения запроса в микросекундах.
+};
+
+/**
+ * @brief Пишет журнал запросов в файл в фоновом потоке.
+ * @details Append только перемещает запись в неблокирующую очередь; при её переполнении запись
+ *          отбрасывается и учитывается в GetDroppedCount, поэтому поиск никогда не ждёт диска.
+ *          Ошибки фонового потока не завершают процесс: они доступны через GetError и GetLostBlockCount.
+ *          Фоновый поток кодирует записи в varint (время - разностью с предыдущей записью), собирает
+ *          блоки по FLUSH_BLOCK_SIZE байт и сжимает их LzCompress. Неполный блок записывается не позже
+ *          чем через FLUSH_INTERVAL, и файл сбрасывается после каждого блока. Пустая очередь
+ *          не будит поток: он ждёт условной переменной, которую Append сигналит, только если поток спит.
+ *
+ *          Формат файла: заголовок MAGIC, затем блоки вида
+ *          varint(размер исходного блока) varint(размер сжатого блока) сжатые данные.
+ *          Запись внутри блока: varint(разность времени, zigzag) varint(длина запроса) запрос
+ *          байт(вид фильтра) varint(количество результатов) varint(время выполнения).
+ */
+class QueryLogWriter {
+public:
+    static constexpr char MAGIC[] = "QLOG1\n";                          ///< Заголовок файла журнала.
+    static constexpr size_t DEFAULT_QUEUE_CAPACITY = 1 << 16;           ///< Вместимость очереди по умолчанию.
+    static constexpr size_t FLUSH_BLOCK_SIZE = 64 * 1024;               ///< Размер блока до сжатия.
+    static constexpr std::chrono::milliseconds FLUSH_INTERVAL{100};     ///< Период сброса неполного блока.
+
+    /**
+     * @brief Конструктор класса QueryLogWriter.
+     * @param path Путь к файлу журнала; существующий файл перезаписывается.
+     * @param queue_capacity Вместимость очереди записей; степень двойки.
+     * @throws invalid_argument Если файл не удалось открыть.
+     */
+    explicit QueryLogWriter(const std::string& path, size_t queue_capacity = DEFAULT_QUEUE_CAPACITY);
+
+    QueryLogWriter(const QueryLogWriter&) = delete;
+    QueryLogWriter& operator=(const QueryLogWriter&) = delete;
+
+    /**
+     * @brief Деструктор: записывает оставшиеся в очереди записи и закрывает файл.
+     */
+    ~QueryLogWriter();
+
+    /**
+     * @brief Ставит запись в очередь на запись.
+     * @param entry Запись журнала.
+     * @return true, если запись принята; false, если очередь заполнена и запись отброшена.
+     */
+    bool Append(QueryLogEntry entry);
+
+    /**
+     * @brief Возвращает количество отброшенных записей.
+     * @return Количество записей, не поместившихся в очередь.
+     */
+    uint64_t GetDroppedCount() const;
+
+    /**
+     * @brief Возвращает количество блоков, не записанных в файл из-за ошибки.
+     * @return Количество потерянных блоков.
+     */
+    uint64_t GetLostBlockCount() const;
+
+    /**
+     * @brief Возвращает текст первой ошибки фонового потока.
+     * @return Текст ошибки; пустая строка, если ошибок не было.
+     */
+    std::string GetError() const;
+
+private:
+    BoundedQueue<QueryLogEntry> queue_;     ///< Очередь записей.
+    std::ofstream output_;                  ///< Файл журнала.
+    std::atomic<bool> stopping_{false};     ///< Признак завершения работы.
+    std::atomic<uint64_t> dropped_{0};      ///< Количество отброшенных записей.
+    std::atomic<uint64_t> lost_blocks_{0};  ///< Количество блоков, не записанных из-за ошибки.
+    mutable std::mutex error_mutex_;        ///< Мьютекс текста ошибки.
+    std::string error_;                     ///< Текст первой ошибки фонового потока.
+    std::atomic<uint64_t> pushed_{0};       ///< Количество принятых записей.
+    std::atomic<bool> sleeping_{false};     ///< Признак того, что фоновый поток ждёт записей.
+    std::mutex wake_mutex_;                 ///< Мьютекс ожидания фонового потока.
+    std::condition_variable wake_;          ///< Условная переменная ожидания фонового потока.
+    std::string block_;                     ///< Кодируемый блок.
+    int64_t last_timestamp_ = 0;            ///< Время предыдущей записи блока.
+    std::thread flusher_;                   ///< Фоновый поток записи.
+
+    /**
+     * @brief Цикл фонового потока.
+     */
+    void Run();
+
+    /**
+     * @brief Кодирует запись в текущий блок.
+     */
+    void Encode(const QueryLogEntry& entry);
+
+    /**
+     * @brief Сжимает текущий блок, пишет его в файл и сбрасывает файл.
+     * @details После первой ошибки записи файл может оканчиваться обрывком блока, поэтому
+     *          следующие блоки не пишутся, а учитываются в GetLostBlockCount.
+     */
+    void FlushBlock();
+
+    /**
+     * @brief Запоминает ошибку фонового потока, если она первая.
+     * @param message Текст ошибки.
+     */
+    void RecordError(const std::string& message);
+};
+
+/**
+ * @brief Читает журнал запросов.
+ * @param path Путь к файлу журнала.
+ * @return Записи журнала в порядке записи.
+ * @throws invalid_argument Если файл не удалось открыть или он повреждён.
+ */
+std::vector<QueryLogEntry> ReadQueryLog(const std::string& path);
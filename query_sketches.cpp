@@ -0,0 +1,198 @@
+#include "query_sketches.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+/**
+ * @brief Вычисляет 64-битный хеш строки (FNV-1a с финальным перемешиванием splitmix64).
+ * @param text Строка.
+ * @return Хеш строки.
+ */
+uint64_t HashQuery(std::string_view text) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const char c : text) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ull;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebull;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+/**
+ * @brief Конструктор класса CountMinSketch.
+ * @param width Количество счётчиков в строке.
+ * @param depth Количество строк.
+ */
+CountMinSketch::CountMinSketch(size_t width, size_t depth)
+        : width_(std::max<size_t>(width, 1))
+        , depth_(std::max<size_t>(depth, 1))
+        , counters_(width_ * depth_, 0) {
+}
+
+/**
+ * @brief Учитывает появление элемента.
+ * @param hash Хеш элемента.
+ */
+void CountMinSketch::Add(uint64_t hash) {
+    for (size_t row = 0; row < depth_; ++row) {
+        ++counters_[row * width_ + GetColumn(hash, row)];
+    }
+}
+
+/**
+ * @brief Оценивает частоту элемента.
+ * @param hash Хеш элемента.
+ * @return Оценка сверху количества появлений.
+ */
+uint64_t CountMinSketch::Estimate(uint64_t hash) const {
+    uint64_t estimate = UINT64_MAX;
+    for (size_t row = 0; row < depth_; ++row) {
+        estimate = std::min(estimate, counters_[row * width_ + GetColumn(hash, row)]);
+    }
+    return estimate;
+}
+
+/**
+ * @brief Возвращает номер счётчика элемента в строке.
+ * @details Хеши строк получаются двойным хешированием: h1 + row * h2.
+ */
+size_t CountMinSketch::GetColumn(uint64_t hash, size_t row) const {
+    const uint64_t low = static_cast<uint32_t>(hash);
+    const uint64_t high = (hash >> 32) | 1;
+    return static_cast<size_t>((low + row * high) % width_);
+}
+
+/**
+ * @brief Конструктор класса SpaceSaving.
+ * @param capacity Количество счётчиков.
+ */
+SpaceSaving::SpaceSaving(size_t capacity)
+        : capacity_(std::max<size_t>(capacity, 1))
+        , counters_(capacity_) {
+    positions_.reserve(capacity_);
+    block_starts_.emplace(0, 0);
+}
+
+/**
+ * @brief Учитывает появление элемента.
+ * @param item Элемент.
+ */
+void SpaceSaving::Add(const std::string& item) {
+    const auto it = positions_.find(item);
+    if (it != positions_.end()) {
+        Increment(it->second);
+        return;
+    }
+
+    // Вытесняем элемент с наименьшим счётчиком; он последний, а свободные ячейки имеют счётчик 0
+    const size_t position = counters_.size() - 1;
+    QueryCount& min_counter = counters_[position];
+    if (min_counter.count > 0) {
+        positions_.erase(min_counter.query);
+    }
+    min_counter.query = item;
+    min_counter.error = min_counter.count;
+    positions_.emplace(item, position);
+    Increment(position);
+}
+
+/**
+ * @brief Увеличивает счётчик, сохраняя упорядоченность счётчиков.
+ * @details Счётчик меняется местами с первым счётчиком того же значения, после чего его
+ *          увеличение не нарушает порядок: он становится последним в блоке следующего значения.
+ * @param position Позиция счётчика.
+ */
+void SpaceSaving::Increment(size_t position) {
+    const uint64_t count = counters_[position].count;
+    const size_t first = block_starts_.at(count);
+    if (first != position) {
+        std::swap(counters_[first], counters_[position]);
+        positions_[counters_[position].query] = position;
+        positions_[counters_[first].query] = first;
+    }
+    if (first + 1 < counters_.size() && counters_[first + 1].count == count) {
+        block_starts_[count] = first + 1;
+    } else {
+        block_starts_.erase(count);
+    }
+    ++counters_[first].count;
+    // Если блок следующего значения уже есть, он начинается раньше
+    block_starts_.emplace(count + 1, first);
+}
+
+/**
+ * @brief Возвращает самые частые элементы.
+ * @param count Количество элементов.
+ * @return Элементы по убыванию оценки частоты.
+ */
+std::vector<QueryCount> SpaceSaving::GetTop(size_t count) const {
+    std::vector<QueryCount> top;
+    for (const QueryCount& counter : counters_) {
+        if (counter.count > 0) {
+            top.push_back(counter);
+        }
+    }
+    const size_t result_count = std::min(count, top.size());
+    std::partial_sort(top.begin(), top.begin() + result_count, top.end(),
+                      [](const QueryCount& lhs, const QueryCount& rhs) {
+                          return lhs.count > rhs.count || (lhs.count == rhs.count && lhs.query < rhs.query);
+                      });
+    top.resize(result_count);
+    return top;
+}
+
+/**
+ * @brief Конструктор класса HyperLogLog.
+ * @param precision Количество бит хеша, выбирающих регистр (от 4 до 16).
+ * @throws invalid_argument Если precision вне диапазона.
+ */
+HyperLogLog::HyperLogLog(int precision)
+        : precision_(precision) {
+    if (precision < 4 || precision > 16) {
+        throw std::invalid_argument("HyperLogLog precision must be in [4, 16]");
+    }
+    registers_.assign(size_t{1} << precision, 0);
+}
+
+/**
+ * @brief Учитывает элемент.
+ * @param hash Хеш элемента.
+ */
+void HyperLogLog::Add(uint64_t hash) {
+    const size_t index = static_cast<size_t>(hash >> (64 - precision_));
+    // Ранг - позиция первой единицы в оставшихся битах; граничный бит ограничивает ранг
+    uint64_t rest = (hash << precision_) | (uint64_t{1} << (precision_ - 1));
+    uint8_t rank = 1;
+    while ((rest & (uint64_t{1} << 63)) == 0) {
+        rest <<= 1;
+        ++rank;
+    }
+    registers_[index] = std::max(registers_[index], rank);
+}
+
+/**
+ * @brief Оценивает количество различных элементов.
+ * @return Оценка количества.
+ */
+double HyperLogLog::Estimate() const {
+    const double register_count = static_cast<double>(registers_.size());
+    double inverse_sum = 0.0;
+    size_t zero_registers = 0;
+    for (const uint8_t value : registers_) {
+        inverse_sum += std::ldexp(1.0, -value);
+        zero_registers += value == 0;
+    }
+    const double alpha = 0.7213 / (1.0 + 1.079 / register_count);
+    const double estimate = alpha * register_count * register_count / inverse_sum;
+
+    // Для малых количеств точнее линейный подсчёт по пустым регистрам
+    if (estimate <= 2.5 * register_count && zero_registers > 0) {
+        return register_count * std::log(register_count / zero_registers);
+    }
+    return estimate;
+}
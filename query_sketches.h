@@ -0,0 +1,138 @@
+/**
+ * @file query_sketches.h
+ * @brief Содержит вероятностные структуры для статистики потока запросов в ограниченной памяти.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Вычисляет 64-битный хеш строки (FNV-1a с финальным перемешиванием splitmix64).
+ * @param text Строка.
+ * @return Хеш строки.
+ */
+uint64_t HashQuery(std::string_view text);
+
+/**
+ * @brief Запрос и оценка количества его появлений.
+ */
+struct QueryCount {
+    std::string query;      ///< Текст запроса.
+    uint64_t count = 0;     ///< Оценка сверху количества появлений.
+    uint64_t error = 0;     ///< Максимальная ошибка оценки: истинное количество не меньше count - error.
+};
+
+/**
+ * @brief Эскиз Count-Min для оценки частоты произвольного элемента.
+ * @details Оценка никогда не меньше истинной частоты и превышает её не более чем на
+ *          e / width * (общее количество) с вероятностью 1 - exp(-depth).
+ */
+class CountMinSketch {
+public:
+    /**
+     * @brief Конструктор класса CountMinSketch.
+     * @param width Количество счётчиков в строке.
+     * @param depth Количество строк.
+     */
+    CountMinSketch(size_t width, size_t depth);
+
+    /**
+     * @brief Учитывает появление элемента.
+     * @param hash Хеш элемента.
+     */
+    void Add(uint64_t hash);
+
+    /**
+     * @brief Оценивает частоту элемента.
+     * @param hash Хеш элемента.
+     * @return Оценка сверху количества появлений.
+     */
+    uint64_t Estimate(uint64_t hash) const;
+
+private:
+    size_t width_;                  ///< Количество счётчиков в строке.
+    size_t depth_;                  ///< Количество строк.
+    std::vector<uint64_t> counters_; ///< Счётчики построчно.
+
+    /**
+     * @brief Возвращает номер счётчика элемента в строке.
+     */
+    size_t GetColumn(uint64_t hash, size_t row) const;
+};
+
+/**
+ * @brief Алгоритм Space-Saving для поиска самых частых элементов.
+ * @details Хранит не более capacity счётчиков. Новый элемент при заполненной таблице вытесняет
+ *          элемент с наименьшим счётчиком и наследует его значение как ошибку. Любой элемент
+ *          с частотой больше N / capacity гарантированно присутствует в таблице. Счётчики хранятся
+ *          по убыванию значения вместе с началом блока каждого значения, поэтому учёт
+ *          элемента и вытеснение стоят O(1).
+ */
+class SpaceSaving {
+public:
+    /**
+     * @brief Конструктор класса SpaceSaving.
+     * @param capacity Количество счётчиков.
+     */
+    explicit SpaceSaving(size_t capacity);
+
+    /**
+     * @brief Учитывает появление элемента.
+     * @param item Элемент.
+     */
+    void Add(const std::string& item);
+
+    /**
+     * @brief Возвращает самые частые элементы.
+     * @param count Количество элементов.
+     * @return Элементы по убыванию оценки частоты.
+     */
+    std::vector<QueryCount> GetTop(size_t count) const;
+
+private:
+    size_t capacity_;                                       ///< Количество счётчиков.
+    std::vector<QueryCount> counters_;                      ///< Счётчики по убыванию; свободные имеют значение 0.
+    std::unordered_map<std::string, size_t> positions_;     ///< Позиции счётчиков элементов.
+    std::unordered_map<uint64_t, size_t> block_starts_;     ///< Позиция первого счётчика каждого значения.
+
+    /**
+     * @brief Увеличивает счётчик, сохраняя упорядоченность счётчиков.
+     * @param position Позиция счётчика.
+     */
+    void Increment(size_t position);
+};
+
+/**
+ * @brief Оценка количества различных элементов алгоритмом HyperLogLog.
+ * @details Использует 2^precision однобайтовых регистров; относительная ошибка около 1.04 / sqrt(2^precision).
+ */
+class HyperLogLog {
+public:
+    /**
+     * @brief Конструктор класса HyperLogLog.
+     * @param precision Количество бит хеша, выбирающих регистр (от 4 до 16).
+     * @throws invalid_argument Если precision вне диапазона.
+     */
+    explicit HyperLogLog(int precision);
+
+    /**
+     * @brief Учитывает элемент.
+     * @param hash Хеш элемента.
+     */
+    void Add(uint64_t hash);
+
+    /**
+     * @brief Оценивает количество различных элементов.
+     * @return Оценка количества.
+     */
+    double Estimate() const;
+
+private:
+    int precision_;                   ///< Количество бит хеша, выбирающих регистр.
+    std::vector<uint8_t> registers_;  ///< Регистры.
+};
@@ -0,0 +1,72 @@
+#include "ranking.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "tracing.h"
+
+/**
+ * @brief Строит ключ ранжирования, сохраняющий порядок.
+ * @param relevance Релевантность документа.
+ * @param rating Рейтинг документа.
+ * @return Ключ; больший ключ соответствует лучшему документу.
+ */
+uint64_t MakeRankKey(double relevance, int rating) {
+    const float quantized = static_cast<float>(relevance);
+    uint32_t bits;
+    std::memcpy(&bits, &quantized, sizeof(bits));
+    // Для отрицательных чисел инвертируем все биты, для положительных - только знаковый;
+    // NaN получает наименьший ключ, иначе он оказался бы выше +inf
+    bits = std::isnan(quantized) ? 0 : (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+    const uint32_t biased_rating = static_cast<uint32_t>(rating) ^ 0x80000000u;
+    return (static_cast<uint64_t>(bits) << 32) | biased_rating;
+}
+
+/**
+ * @brief Оставляет в массиве count лучших кандидатов, упорядоченных от лучшего к худшему.
+ * @param candidates Кандидаты.
+ * @param count Количество кандидатов, которое нужно оставить.
+ */
+void SelectTopCandidates(std::vector<RankedCandidate>& candidates, size_t count) {
+    count = std::min(count, candidates.size());
+    SEARCH_TRACE(topk__select, candidates.size(), count);
+
+    if (candidates.size() < RADIX_SELECT_THRESHOLD) {
+        std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(), IsRankedBefore);
+        candidates.resize(count);
+        return;
+    }
+
+    // [begin, first) - отобранные кандидаты, [first, last) - кандидаты с ещё не определённой судьбой
+    auto first = candidates.begin();
+    auto last = candidates.end();
+    size_t need = count;
+    for (int shift = 56; shift >= 0 && need > 0 && need < static_cast<size_t>(last - first); shift -= 8) {
+        size_t histogram[256] = {};
+        for (auto it = first; it != last; ++it) {
+            ++histogram[(it->key >> shift) & 0xFF];
+        }
+
+        // Ищем байт, на котором проходит граница отбора
+        int border = 255;
+        for (; histogram[border] < need; --border) {
+            need -= histogram[border];
+        }
+
+        const uint64_t border_byte = static_cast<uint64_t>(border);
+        first = std::partition(first, last, [shift, border_byte](const RankedCandidate& candidate) {
+            return ((candidate.key >> shift) & 0xFF) > border_byte;
+        });
+        last = std::partition(first, last, [shift, border_byte](const RankedCandidate& candidate) {
+            return ((candidate.key >> shift) & 0xFF) == border_byte;
+        });
+    }
+
+    // Оставшиеся кандидаты либо отобраны целиком, либо имеют равные ключи и различаются индексом
+    if (need < static_cast<size_t>(last - first)) {
+        std::nth_element(first, first + need, last, IsRankedBefore);
+    }
+    candidates.resize(first - candidates.begin() + need);
+    std::sort(candidates.begin(), candidates.end(), IsRankedBefore);
+}
@@ -0,0 +1,69 @@
+/**
+ * @file ranking.h
+ * @brief Содержит целочисленные ключи ранжирования и выбор лучших документов по ним.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Количество кандидатов, начиная с которого используется поразрядный выбор.
+ */
+const size_t RADIX_SELECT_THRESHOLD = 4096;
+
+/**
+ * @brief Вычисляет вклад слова в релевантность документа.
+ * @details Общая для всех способов поиска, чтобы один и тот же документ получал одинаковую оценку.
+ * @param term_freq Частота слова в документе.
+ * @param inverse_document_freq Обратная частота документа для слова.
+ * @return Вклад слова (TF-IDF).
+ */
+inline double ComputeTermRelevance(double term_freq, double inverse_document_freq) {
+    return term_freq * inverse_document_freq;
+}
+
+/**
+ * @brief Кандидат в результаты поиска с целочисленным ключом ранжирования.
+ * @details Кандидаты упорядочиваются по убыванию ключа, а при равных ключах - по возрастанию индекса.
+ *          Если кандидаты пронумерованы в порядке возрастания идентификаторов документов, это даёт
+ *          порядок "релевантность, затем рейтинг, затем идентификатор".
+ */
+struct RankedCandidate {
+    uint64_t key;    ///< Ключ ранжирования, см. MakeRankKey.
+    uint32_t index;  ///< Индекс кандидата во входном массиве.
+};
+
+/**
+ * @brief Строит ключ ранжирования, сохраняющий порядок.
+ * @details Старшие 32 бита - релевантность, округлённая до float и преобразованная так, чтобы
+ *          беззнаковое сравнение совпадало со сравнением чисел; младшие 32 бита - рейтинг со
+ *          смещением 2^31. Релевантности, неразличимые в точности float, считаются равными;
+ *          NaN ранжируется ниже любой другой релевантности, включая -inf.
+ * @param relevance Релевантность документа.
+ * @param rating Рейтинг документа.
+ * @return Ключ; больший ключ соответствует лучшему документу.
+ */
+uint64_t MakeRankKey(double relevance, int rating);
+
+/**
+ * @brief Проверяет, стоит ли кандидат lhs выше кандидата rhs.
+ * @param lhs Первый кандидат.
+ * @param rhs Второй кандидат.
+ * @return true, если lhs лучше rhs.
+ */
+inline bool IsRankedBefore(const RankedCandidate& lhs, const RankedCandidate& rhs) {
+    return lhs.key > rhs.key || (lhs.key == rhs.key && lhs.index < rhs.index);
+}
+
+/**
+ * @brief Оставляет в массиве count лучших кандидатов, упорядоченных от лучшего к худшему.
+ * @details Небольшие массивы обрабатываются частичной сортировкой. Для больших массивов порог
+ *          отбора находится поразрядно по байтам ключа, начиная со старшего, после чего полностью
+ *          сортируются только отобранные кандидаты.
+ * @param candidates Кандидаты.
+ * @param count Количество кандидатов, которое нужно оставить.
+ */
+void SelectTopCandidates(std::vector<RankedCandidate>& candidates, size_t count);
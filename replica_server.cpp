@@ -0,0 +1,337 @@
+#include "replica_server.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include "varint.h"
+
+namespace {
+
+/**
+ * @brief Заполняет адрес Unix-сокета.
+ * @throws invalid_argument Если путь слишком длинный.
+ */
+sockaddr_un MakeAddress(const std::string& socket_path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("Replica socket path is too long: " + socket_path);
+    }
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+    return address;
+}
+
+/**
+ * @brief Отправляет буфер целиком.
+ * @return false, если отправка не удалась.
+ */
+bool SendBuffer(int fd, std::string_view data) {
+    while (!data.empty()) {
+        const ssize_t result = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            return false;
+        }
+        data.remove_prefix(static_cast<size_t>(result));
+    }
+    return true;
+}
+
+/**
+ * @brief Принимает кадр: varint(длина) и данные.
+ * @return false, если соединение закрыто, данные повреждены или кадр длиннее ReplicaServer::MAX_FRAME_SIZE.
+ */
+bool ReceiveFrame(int fd, std::string& frame) {
+    uint64_t size = 0;
+    for (int shift = 0;; shift += 7) {
+        unsigned char byte;
+        const ssize_t result = recv(fd, &byte, 1, 0);
+        if (result < 0 && errno == EINTR) {
+            shift -= 7;
+            continue;
+        }
+        if (result <= 0 || shift >= 64) {
+            return false;
+        }
+        size |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            break;
+        }
+    }
+    // Длина пришла от собеседника: без ограничения повреждённый кадр завершил бы процесс bad_alloc
+    if (size > ReplicaServer::MAX_FRAME_SIZE) {
+        return false;
+    }
+    frame.resize(size);
+    size_t received = 0;
+    while (received < size) {
+        const ssize_t result = recv(fd, frame.data() + received, size - received, 0);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            return false;
+        }
+        received += static_cast<size_t>(result);
+    }
+    return true;
+}
+
+/**
+ * @brief Дописывает к буферу кадр с заданными данными.
+ */
+void AppendFrame(std::string& out, const std::string& payload) {
+    AppendVarint(out, payload.size());
+    out += payload;
+}
+
+/**
+ * @brief Кодирует успешный ответ.
+ */
+std::string EncodeDocuments(const std::vector<Document>& documents) {
+    std::string payload(1, '\0');
+    AppendVarint(payload, documents.size());
+    for (const Document& document : documents) {
+        AppendVarint(payload, ZigzagEncode(document.id));
+        AppendVarint(payload, ZigzagEncode(document.rating));
+        char relevance[sizeof(double)];
+        std::memcpy(relevance, &document.relevance, sizeof(double));
+        payload.append(relevance, sizeof(double));
+    }
+    return payload;
+}
+
+/**
+ * @brief Декодирует ответ реплики.
+ * @throws invalid_argument Если реплика вернула ошибку или ответ повреждён.
+ */
+std::vector<Document> DecodeDocuments(std::string_view payload) {
+    if (payload.empty()) {
+        throw std::invalid_argument("Empty replica response");
+    }
+    if (payload.front() != '\0') {
+        throw std::invalid_argument(std::string(payload.substr(1)));
+    }
+    payload.remove_prefix(1);
+    const uint64_t count = ReadVarint(payload);
+    if (count > payload.size()) {
+        throw std::invalid_argument("Malformed replica response");
+    }
+    std::vector<Document> documents;
+    documents.reserve(count);
+    for (uint64_t i = 0; i < count; ++i) {
+        Document document;
+        document.id = static_cast<int>(ZigzagDecode(ReadVarint(payload)));
+        document.rating = static_cast<int>(ZigzagDecode(ReadVarint(payload)));
+        if (payload.size() < sizeof(double)) {
+            throw std::invalid_argument("Malformed replica response");
+        }
+        std::memcpy(&document.relevance, payload.data(), sizeof(double));
+        payload.remove_prefix(sizeof(double));
+        documents.push_back(document);
+    }
+    return documents;
+}
+
+/**
+ * @brief Открывает соединение с репликой с ограниченным временем ожидания.
+ * @return Сокет.
+ * @throws system_error Если подключиться не удалось.
+ */
+int OpenReplicaSocket(const sockaddr_un& address, std::chrono::milliseconds timeout) {
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "socket");
+    }
+    timeval wait{};
+    wait.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+    wait.tv_usec = static_cast<suseconds_t>(timeout.count() % 1000 * 1000);
+    // SO_SNDTIMEO ограничивает и connect к переполненному сокету
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &wait, sizeof(wait)) < 0
+        || setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &wait, sizeof(wait)) < 0
+        || connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+        const int error = errno == EAGAIN ? ETIMEDOUT : errno;
+        close(fd);
+        throw std::system_error(error, std::generic_category(), std::string("connect ") + address.sun_path);
+    }
+    return fd;
+}
+
+/**
+ * @brief Соединение клиента с репликой.
+ */
+struct ReplicaConnection {
+    sockaddr_un address{};              ///< Адрес реплики.
+    std::chrono::milliseconds timeout;  ///< Наибольшее время одного ожидания сокета.
+    int fd = -1;                        ///< Сокет; -1 после ошибки соединения.
+    std::mutex mutex;                   ///< Мьютекс: запросы соединения выполняются по одному.
+
+    ~ReplicaConnection() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+};
+
+} // namespace
+
+/**
+ * @brief Конструктор класса ReplicaServer: начинает принимать соединения.
+ * @param engine Движок, выполняющий запросы.
+ * @param socket_path Путь Unix-сокета.
+ * @throws invalid_argument Если путь слишком длинный.
+ * @throws system_error Если не удалось открыть сокет.
+ */
+ReplicaServer::ReplicaServer(QueryEngine engine, const std::string& socket_path)
+        : engine_(std::move(engine))
+        , socket_path_(socket_path) {
+    const sockaddr_un address = MakeAddress(socket_path_);
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        throw std::system_error(errno, std::generic_category(), "socket");
+    }
+    unlink(socket_path_.c_str());
+    if (bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0
+        || listen(listen_fd_, SOMAXCONN) < 0) {
+        const int error = errno;
+        close(listen_fd_);
+        throw std::system_error(error, std::generic_category(), "replica server bind");
+    }
+    thread_ = std::thread(&ReplicaServer::Run, this);
+}
+
+/**
+ * @brief Деструктор: закрывает соединения и удаляет файл сокета.
+ */
+ReplicaServer::~ReplicaServer() {
+    stopping_.store(true, std::memory_order_relaxed);
+    thread_.join();
+    for (Connection& connection : connections_) {
+        connection.thread.join();
+    }
+    close(listen_fd_);
+    unlink(socket_path_.c_str());
+}
+
+/**
+ * @brief Цикл приёма соединений.
+ */
+void ReplicaServer::Run() {
+    while (!stopping_.load(std::memory_order_relaxed)) {
+        ReapConnections();
+        pollfd listen_poll{listen_fd_, POLLIN, 0};
+        if (poll(&listen_poll, 1, POLL_INTERVAL_MS) <= 0) {
+            continue;
+        }
+        const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        std::lock_guard guard(connections_mutex_);
+        Connection& connection = connections_.emplace_back();
+        connection.thread = std::thread([this, fd, &connection] {
+            HandleConnection(fd);
+            close(fd);
+            connection.done.store(true, std::memory_order_release);
+        });
+    }
+}
+
+/**
+ * @brief Присоединяет потоки завершившихся соединений и удаляет их из списка.
+ */
+void ReplicaServer::ReapConnections() {
+    std::lock_guard guard(connections_mutex_);
+    for (auto it = connections_.begin(); it != connections_.end();) {
+        if (it->done.load(std::memory_order_acquire)) {
+            it->thread.join();
+            it = connections_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+/**
+ * @brief Обслуживает соединение до его закрытия.
+ * @param fd Сокет соединения.
+ */
+void ReplicaServer::HandleConnection(int fd) const {
+    std::string request;
+    std::string response;
+    while (!stopping_.load(std::memory_order_relaxed)) {
+        pollfd request_poll{fd, POLLIN, 0};
+        const int ready = poll(&request_poll, 1, POLL_INTERVAL_MS);
+        if (ready == 0 || (ready < 0 && errno == EINTR)) {
+            continue;
+        }
+        if (ready < 0 || !ReceiveFrame(fd, request) || request.empty()
+            || static_cast<unsigned char>(request.front()) > static_cast<unsigned char>(DocumentStatus::REMOVED)) {
+            return;
+        }
+
+        std::string payload;
+        try {
+            const auto status = static_cast<DocumentStatus>(request.front());
+            payload = EncodeDocuments(engine_(request.substr(1), status));
+        } catch (const std::exception& e) {
+            payload = std::string(1, '\1') + e.what();
+        }
+        response.clear();
+        AppendFrame(response, payload);
+        if (!SendBuffer(fd, response)) {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Подключается к серверу реплики.
+ * @param socket_path Путь Unix-сокета.
+ * @param timeout Наибольшее время одного ожидания сокета.
+ * @return Движок для QueryCoordinator или ShadowExecutor.
+ * @throws invalid_argument Если путь слишком длинный или timeout не положителен.
+ * @throws system_error Если подключиться не удалось.
+ */
+QueryEngine ConnectReplica(const std::string& socket_path, std::chrono::milliseconds timeout) {
+    if (timeout.count() <= 0) {
+        throw std::invalid_argument("Replica timeout must be positive");
+    }
+    auto connection = std::make_shared<ReplicaConnection>();
+    connection->address = MakeAddress(socket_path);
+    connection->timeout = timeout;
+    connection->fd = OpenReplicaSocket(connection->address, timeout);
+
+    return [connection](const std::string& raw_query, DocumentStatus status) {
+        std::string payload(1, static_cast<char>(status));
+        payload += raw_query;
+        std::string request;
+        AppendFrame(request, payload);
+
+        std::lock_guard guard(connection->mutex);
+        if (connection->fd < 0) {
+            connection->fd = OpenReplicaSocket(connection->address, connection->timeout);
+        }
+        std::string response;
+        errno = 0;
+        if (!SendBuffer(connection->fd, request) || !ReceiveFrame(connection->fd, response)) {
+            const int error = errno == EAGAIN || errno == EWOULDBLOCK ? ETIMEDOUT : (errno != 0 ? errno : ECONNRESET);
+            // Опоздавший ответ сдвинул бы кадры следующего запроса, поэтому соединение не переиспользуется
+            close(connection->fd);
+            connection->fd = -1;
+            throw std::system_error(error, std::generic_category(), "replica connection");
+        }
+        return DecodeDocuments(response);
+    };
+}
@@ -0,0 +1,98 @@
+/**
+ * @file replica_server.h
+ * @brief Содержит обслуживание поисковых запросов через Unix-сокет для реплик в отдельных процессах.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "shadow_executor.h"
+
+/**
+ * @brief Сервер запросов реплики на Unix-сокете.
+ * @details Каждое соединение обслуживается своим потоком; запросы соединения выполняются по одному.
+ *          Потоки закрытых соединений присоединяются циклом приёма, поэтому переподключения клиентов
+ *          не накапливают потоки.
+ *          Запрос: varint(длина) байт(статус) текст запроса. Ответ: varint(длина) байт(0 - успех,
+ *          1 - ошибка), затем varint(количество) и документы (zigzag varint идентификатор,
+ *          zigzag varint рейтинг, 8 байт релевантности) или текст ошибки.
+ */
+class ReplicaServer {
+public:
+    static constexpr size_t MAX_FRAME_SIZE = 64 << 20;  ///< Наибольшая длина кадра; соединение с более длинным кадром закрывается.
+
+    /**
+     * @brief Конструктор класса ReplicaServer: начинает принимать соединения.
+     * @param engine Движок, выполняющий запросы; вызывается из нескольких потоков.
+     * @param socket_path Путь Unix-сокета; существующий файл заменяется.
+     * @throws invalid_argument Если путь слишком длинный.
+     * @throws system_error Если не удалось открыть сокет.
+     */
+    ReplicaServer(QueryEngine engine, const std::string& socket_path);
+
+    ReplicaServer(const ReplicaServer&) = delete;
+    ReplicaServer& operator=(const ReplicaServer&) = delete;
+
+    /**
+     * @brief Деструктор: закрывает соединения и удаляет файл сокета.
+     */
+    ~ReplicaServer();
+
+private:
+    static constexpr int POLL_INTERVAL_MS = 100;    ///< Период проверки признака остановки.
+
+    /**
+     * @brief Поток, обслуживающий одно соединение.
+     */
+    struct Connection {
+        std::thread thread;             ///< Поток соединения.
+        std::atomic<bool> done{false};  ///< Признак завершения потока; такой поток присоединяется циклом приёма.
+    };
+
+    QueryEngine engine_;                    ///< Движок.
+    std::string socket_path_;               ///< Путь сокета.
+    int listen_fd_ = -1;                    ///< Слушающий сокет.
+    std::atomic<bool> stopping_{false};     ///< Признак остановки.
+    std::mutex connections_mutex_;          ///< Мьютекс списка соединений.
+    std::list<Connection> connections_;     ///< Потоки соединений.
+    std::thread thread_;                    ///< Поток приёма соединений.
+
+    /**
+     * @brief Цикл приёма соединений.
+     */
+    void Run();
+
+    /**
+     * @brief Присоединяет потоки завершившихся соединений и удаляет их из списка.
+     */
+    void ReapConnections();
+
+    /**
+     * @brief Обслуживает соединение до его закрытия.
+     * @param fd Сокет соединения.
+     */
+    void HandleConnection(int fd) const;
+};
+
+/**
+ * @brief Подключается к серверу реплики.
+ * @details Возвращённый движок держит одно соединение и выполняет запросы по одному; ошибка
+ *          реплики передаётся как invalid_argument, ошибка соединения - как system_error.
+ *          Каждое ожидание отправки или приёма ограничено timeout (ETIMEDOUT). После ошибки
+ *          соединения сокет закрывается, и следующий запрос подключается заново.
+ * @param socket_path Путь Unix-сокета.
+ * @param timeout Наибольшее время одного ожидания сокета.
+ * @return Движок для QueryCoordinator или ShadowExecutor.
+ * @throws invalid_argument Если путь слишком длинный или timeout не положителен.
+ * @throws system_error Если подключиться не удалось.
+ */
+QueryEngine ConnectReplica(const std::string& socket_path,
+                           std::chrono::milliseconds timeout = std::chrono::milliseconds(5000));
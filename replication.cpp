@@ -0,0 +1,579 @@
+#include "replication.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <utility>
+
+#include "varint.h"
+
+namespace {
+
+/**
+ * @brief Записывает данные в канал, не допуская SIGPIPE при закрытом читающем конце.
+ * @details SIGPIPE блокируется на время записи; если запись его вызвала, ожидающий сигнал
+ *          забирается, чтобы он не пришёл после восстановления маски.
+ * @return Результат write; errno сохраняется.
+ */
+ssize_t WriteWithoutSigpipe(int fd, std::string_view data) {
+    sigset_t sigpipe_set;
+    sigemptyset(&sigpipe_set);
+    sigaddset(&sigpipe_set, SIGPIPE);
+    sigset_t old_mask;
+    pthread_sigmask(SIG_BLOCK, &sigpipe_set, &old_mask);
+
+    // Ожидавший до записи SIGPIPE принадлежит не нам и остаётся нетронутым
+    sigset_t pending;
+    sigpending(&pending);
+    const bool was_pending = sigismember(&pending, SIGPIPE);
+
+    const ssize_t result = write(fd, data.data(), data.size());
+    const int write_errno = errno;
+    if (result < 0 && write_errno == EPIPE && !was_pending) {
+        const timespec no_wait{0, 0};
+        while (sigtimedwait(&sigpipe_set, nullptr, &no_wait) < 0 && errno == EINTR) {
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+    errno = write_errno;
+    return result;
+}
+
+/**
+ * @brief Записывает в неблокирующий сокет или канал столько данных, сколько он примет.
+ * @param is_socket true, если дескриптор - сокет; сбрасывается, если send сообщил, что это не сокет.
+ * @param data Данные; сдвигается за записанную часть.
+ * @return false, если запись не удалась.
+ */
+bool WriteAvailable(int fd, bool& is_socket, std::string_view& data) {
+    while (!data.empty()) {
+        // MSG_NOSIGNAL защищает от SIGPIPE при закрытом сокете; канал пишется с заблокированным SIGPIPE
+        const ssize_t result = is_socket ? send(fd, data.data(), data.size(), MSG_NOSIGNAL)
+                                         : WriteWithoutSigpipe(fd, data);
+        if (result < 0 && errno == ENOTSOCK && is_socket) {
+            is_socket = false;
+            continue;
+        }
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return true;
+        }
+        if (result <= 0) {
+            return false;
+        }
+        data.remove_prefix(static_cast<size_t>(result));
+    }
+    return true;
+}
+
+/**
+ * @brief Считывает идентификатор документа.
+ */
+int ReadDocumentId(std::string_view& in) {
+    return static_cast<int>(ZigzagDecode(ReadVarint(in)));
+}
+
+/**
+ * @brief Считывает байт статуса документа.
+ * @throws invalid_argument Если статус некорректен.
+ */
+DocumentStatus ReadStatus(std::string_view& in) {
+    if (in.empty() || static_cast<unsigned char>(in.front()) > static_cast<unsigned char>(DocumentStatus::REMOVED)) {
+        throw std::invalid_argument("Malformed WAL record status");
+    }
+    const auto status = static_cast<DocumentStatus>(in.front());
+    in.remove_prefix(1);
+    return status;
+}
+
+} // namespace
+
+/**
+ * @brief Дописывает запись в буфер.
+ * @param out Буфер.
+ * @param record Запись.
+ */
+void AppendWalRecord(std::string& out, const WalRecord& record) {
+    std::string payload;
+    AppendVarint(payload, record.sequence);
+    payload.push_back(static_cast<char>(record.op));
+    switch (record.op) {
+        case WalOp::ADD:
+            AppendVarint(payload, ZigzagEncode(record.document_id));
+            payload.push_back(static_cast<char>(record.status));
+            AppendVarint(payload, record.ratings.size());
+            for (const int rating : record.ratings) {
+                AppendVarint(payload, ZigzagEncode(rating));
+            }
+            AppendVarint(payload, record.text.size());
+            payload += record.text;
+            break;
+        case WalOp::REMOVE:
+            AppendVarint(payload, ZigzagEncode(record.document_id));
+            break;
+        case WalOp::SET_STATUS:
+            AppendVarint(payload, ZigzagEncode(record.document_id));
+            payload.push_back(static_cast<char>(record.status));
+            break;
+        case WalOp::HEARTBEAT:
+        case WalOp::SNAPSHOT_END:
+            break;
+    }
+    AppendVarint(out, payload.size());
+    out += payload;
+}
+
+/**
+ * @brief Считывает запись из начала буфера, если она пришла целиком, и сдвигает буфер за неё.
+ * @param in Буфер.
+ * @param record Считанная запись.
+ * @return true, если запись считана; false, если запись в буфере неполная.
+ * @throws invalid_argument Если запись повреждена.
+ */
+bool ReadWalRecord(std::string_view& in, WalRecord& record) {
+    // Длина записи сама может прийти не целиком
+    const auto length_end = std::find_if(in.begin(), in.end(), [](char c) {
+        return (static_cast<unsigned char>(c) & 0x80) == 0;
+    });
+    if (length_end == in.end()) {
+        return false;
+    }
+    std::string_view rest = in;
+    const uint64_t size = ReadVarint(rest);
+    if (rest.size() < size) {
+        return false;
+    }
+    std::string_view payload = rest.substr(0, size);
+
+    record = WalRecord{};
+    record.sequence = ReadVarint(payload);
+    if (payload.empty()) {
+        throw std::invalid_argument("Malformed WAL record");
+    }
+    record.op = static_cast<WalOp>(payload.front());
+    payload.remove_prefix(1);
+    switch (record.op) {
+        case WalOp::ADD: {
+            record.document_id = ReadDocumentId(payload);
+            record.status = ReadStatus(payload);
+            const uint64_t rating_count = ReadVarint(payload);
+            if (rating_count > payload.size()) {
+                throw std::invalid_argument("Malformed WAL record ratings");
+            }
+            record.ratings.reserve(rating_count);
+            for (uint64_t i = 0; i < rating_count; ++i) {
+                record.ratings.push_back(static_cast<int>(ZigzagDecode(ReadVarint(payload))));
+            }
+            const uint64_t text_size = ReadVarint(payload);
+            if (text_size != payload.size()) {
+                throw std::invalid_argument("Malformed WAL record text");
+            }
+            record.text = std::string(payload);
+            payload = {};
+            break;
+        }
+        case WalOp::REMOVE:
+            record.document_id = ReadDocumentId(payload);
+            break;
+        case WalOp::SET_STATUS:
+            record.document_id = ReadDocumentId(payload);
+            record.status = ReadStatus(payload);
+            break;
+        case WalOp::HEARTBEAT:
+        case WalOp::SNAPSHOT_END:
+            break;
+        default:
+            throw std::invalid_argument("Unknown WAL record type");
+    }
+    if (!payload.empty()) {
+        throw std::invalid_argument("Malformed WAL record");
+    }
+    in = rest.substr(size);
+    return true;
+}
+
+/**
+ * @brief Применяет запись к поисковой системе.
+ * @param search_server Поисковая система.
+ * @param record Запись.
+ */
+void ApplyWalRecord(SearchServer& search_server, const WalRecord& record) {
+    switch (record.op) {
+        case WalOp::ADD:
+            search_server.AddDocument(record.document_id, record.text, record.status, record.ratings);
+            break;
+        case WalOp::REMOVE:
+            search_server.RemoveDocument(record.document_id);
+            break;
+        case WalOp::SET_STATUS:
+            search_server.SetDocumentStatus(record.document_id, record.status);
+            break;
+        case WalOp::HEARTBEAT:
+        case WalOp::SNAPSHOT_END:
+            break;
+    }
+}
+
+/**
+ * @brief Конструктор класса ReplicationLeader.
+ * @param search_server Поисковая система ведущего.
+ * @param max_follower_buffer Наибольший объём неотправленных ведомому данных сверх начального снимка, байт.
+ * @throws logic_error Если в поисковой системе уже есть документы.
+ */
+ReplicationLeader::ReplicationLeader(SearchServer& search_server, size_t max_follower_buffer)
+        : search_server_(search_server)
+        , max_follower_buffer_(max_follower_buffer) {
+    if (search_server_.GetDocumentCount() != 0) {
+        throw std::logic_error("Replication leader requires an empty search server");
+    }
+    Checkpoint();
+}
+
+/**
+ * @brief Деструктор: закрывает дескрипторы ведомых.
+ */
+ReplicationLeader::~ReplicationLeader() {
+    for (const Follower& follower : followers_) {
+        close(follower.fd);
+    }
+}
+
+/**
+ * @brief Добавляет документ и рассылает изменение.
+ */
+void ReplicationLeader::AddDocument(int document_id, const std::string& document, DocumentStatus status,
+                                    const std::vector<int>& ratings) {
+    search_server_.AddDocument(document_id, document, status, ratings);
+    live_documents_.emplace(document_id, LiveDocument{document, status, ratings});
+
+    WalRecord record;
+    record.op = WalOp::ADD;
+    record.document_id = document_id;
+    record.status = status;
+    record.ratings = ratings;
+    record.text = document;
+    Publish(std::move(record));
+}
+
+/**
+ * @brief Удаляет документ и рассылает изменение.
+ * @param document_id Идентификатор документа.
+ */
+void ReplicationLeader::RemoveDocument(int document_id) {
+    if (live_documents_.erase(document_id) == 0) {
+        return;
+    }
+    search_server_.RemoveDocument(document_id);
+
+    WalRecord record;
+    record.op = WalOp::REMOVE;
+    record.document_id = document_id;
+    Publish(std::move(record));
+}
+
+/**
+ * @brief Изменяет статус документа и рассылает изменение.
+ * @param document_id Идентификатор документа.
+ * @param status Новый статус.
+ * @throws out_of_range Если документ не найден.
+ */
+void ReplicationLeader::SetDocumentStatus(int document_id, DocumentStatus status) {
+    search_server_.SetDocumentStatus(document_id, status);
+    live_documents_.at(document_id).status = status;
+
+    WalRecord record;
+    record.op = WalOp::SET_STATUS;
+    record.document_id = document_id;
+    record.status = status;
+    Publish(std::move(record));
+}
+
+/**
+ * @brief Рассылает номер последнего изменения.
+ */
+void ReplicationLeader::Heartbeat() {
+    WalRecord record;
+    record.sequence = sequence_;
+    std::string frame;
+    AppendWalRecord(frame, record);
+    Broadcast(frame);
+}
+
+/**
+ * @brief Подключает ведомого: отправляет номер последнего изменения, снимок и журнал после него.
+ * @param fd Дескриптор для записи.
+ * @return true, если ведомый подключён.
+ */
+bool ReplicationLeader::AddFollower(int fd) {
+    const int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        close(fd);
+        return false;
+    }
+    // Номер ведущего идёт первым, чтобы ведомый видел отставание, пока загружает снимок
+    WalRecord heartbeat;
+    heartbeat.sequence = sequence_;
+    std::string initial;
+    AppendWalRecord(initial, heartbeat);
+    initial += snapshot_;
+    initial += log_tail_;
+
+    Follower follower{fd, true, {}, initial.size() + max_follower_buffer_};
+    std::string_view unsent = initial;
+    if (!WriteAvailable(fd, follower.is_socket, unsent)) {
+        close(fd);
+        return false;
+    }
+    follower.pending = unsent;
+    followers_.push_back(std::move(follower));
+    return true;
+}
+
+/**
+ * @brief Перестраивает снимок по текущему состоянию и очищает журнал после него.
+ */
+void ReplicationLeader::Checkpoint() {
+    // Записи снимка не несут номера: применённым номер становится только на SNAPSHOT_END,
+    // иначе ведомый сообщал бы нулевое отставание, загрузив лишь часть снимка
+    std::string snapshot;
+    WalRecord record;
+    record.op = WalOp::ADD;
+    for (const auto& [document_id, document] : live_documents_) {
+        record.document_id = document_id;
+        record.status = document.status;
+        record.ratings = document.ratings;
+        record.text = document.text;
+        AppendWalRecord(snapshot, record);
+    }
+    WalRecord end;
+    end.sequence = sequence_;
+    end.op = WalOp::SNAPSHOT_END;
+    AppendWalRecord(snapshot, end);
+    snapshot_ = std::move(snapshot);
+    log_tail_.clear();
+}
+
+/**
+ * @brief Возвращает номер последнего изменения.
+ * @return Номер изменения.
+ */
+uint64_t ReplicationLeader::GetSequence() const {
+    return sequence_;
+}
+
+/**
+ * @brief Возвращает количество подключённых ведомых.
+ * @return Количество ведомых.
+ */
+size_t ReplicationLeader::GetFollowerCount() const {
+    return followers_.size();
+}
+
+/**
+ * @brief Кодирует запись, добавляет её в журнал и рассылает ведомым.
+ */
+void ReplicationLeader::Publish(WalRecord record) {
+    record.sequence = ++sequence_;
+    std::string frame;
+    AppendWalRecord(frame, record);
+    log_tail_ += frame;
+    Broadcast(frame);
+    // Новый ведомый получает снимок и журнал, поэтому журнал не должен расти быстрее снимка
+    if (log_tail_.size() > std::max(snapshot_.size(), MIN_CHECKPOINT_LOG_SIZE)) {
+        Checkpoint();
+    }
+}
+
+/**
+ * @brief Отправляет данные всем ведомым без блокировки, отключая тех, кому запись не удалась
+ *        или чей буфер переполнен.
+ */
+void ReplicationLeader::Broadcast(const std::string& data) {
+    followers_.erase(std::remove_if(followers_.begin(), followers_.end(), [&data](Follower& follower) {
+        std::string_view unsent = follower.pending;
+        bool written = WriteAvailable(follower.fd, follower.is_socket, unsent);
+        if (written && unsent.empty()) {
+            std::string_view unsent_data = data;
+            written = WriteAvailable(follower.fd, follower.is_socket, unsent_data);
+            follower.pending = unsent_data;
+        } else {
+            follower.pending.erase(0, follower.pending.size() - unsent.size());
+            follower.pending += data;
+        }
+        // Ведомый, который перестал читать, не должен ни задерживать ведущий, ни копить память без предела
+        if (written && follower.pending.size() <= follower.max_pending) {
+            return false;
+        }
+        close(follower.fd);
+        return true;
+    }), followers_.end());
+}
+
+/**
+ * @brief Конструктор класса ReplicationFollower: начинает применять журнал.
+ * @param search_server Пустая поисковая система с настройками ведущего.
+ * @param fd Дескриптор для чтения.
+ * @param max_batch Максимальное количество записей, применяемых под одной блокировкой.
+ */
+ReplicationFollower::ReplicationFollower(SearchServer&& search_server, int fd, size_t max_batch)
+        : search_server_(std::move(search_server))
+        , fd_(fd)
+        , max_batch_(std::max<size_t>(max_batch, 1))
+        , last_contact_(std::chrono::steady_clock::now().time_since_epoch().count()) {
+    reader_ = std::thread(&ReplicationFollower::Run, this);
+}
+
+/**
+ * @brief Деструктор: останавливает поток и закрывает дескриптор.
+ */
+ReplicationFollower::~ReplicationFollower() {
+    stopping_.store(true, std::memory_order_relaxed);
+    reader_.join();
+    close(fd_);
+}
+
+/**
+ * @brief Возвращает номер последнего применённого изменения.
+ * @return Номер изменения.
+ */
+uint64_t ReplicationFollower::GetAppliedSequence() const {
+    return applied_sequence_.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Возвращает количество известных, но ещё не применённых изменений.
+ * @return Количество изменений.
+ */
+uint64_t ReplicationFollower::GetLag() const {
+    const uint64_t applied = applied_sequence_.load(std::memory_order_acquire);
+    const uint64_t leader = leader_sequence_.load(std::memory_order_acquire);
+    return leader > applied ? leader - applied : 0;
+}
+
+/**
+ * @brief Возвращает время с последней полученной от ведущего записи.
+ * @return Время.
+ */
+std::chrono::steady_clock::duration ReplicationFollower::GetTimeSinceLeaderContact() const {
+    const std::chrono::steady_clock::time_point last_contact(
+            std::chrono::steady_clock::duration(last_contact_.load(std::memory_order_relaxed)));
+    return std::chrono::steady_clock::now() - last_contact;
+}
+
+/**
+ * @brief Проверяет, открыто ли соединение с ведущим.
+ * @return false, если соединение закрыто или данные повреждены.
+ */
+bool ReplicationFollower::IsConnected() const {
+    return connected_.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Ждёт применения изменения с заданным номером.
+ * @param sequence Номер изменения.
+ * @param timeout Максимальное время ожидания.
+ * @return true, если изменение применено.
+ */
+bool ReplicationFollower::WaitForSequence(uint64_t sequence, std::chrono::milliseconds timeout) const {
+    std::unique_lock lock(applied_mutex_);
+    applied_condition_.wait_for(lock, timeout, [this, sequence] {
+        return GetAppliedSequence() >= sequence || !IsConnected();
+    });
+    return GetAppliedSequence() >= sequence;
+}
+
+/**
+ * @brief Цикл чтения и применения журнала.
+ */
+void ReplicationFollower::Run() {
+    std::string buffer;
+    std::vector<char> chunk(1 << 16);
+    std::vector<WalRecord> batch;
+    while (!stopping_.load(std::memory_order_relaxed)) {
+        pollfd read_poll{fd_, POLLIN, 0};
+        const int ready = poll(&read_poll, 1, POLL_INTERVAL_MS);
+        if (ready == 0 || (ready < 0 && errno == EINTR)) {
+            continue;
+        }
+        const ssize_t received = ready < 0 ? -1 : read(fd_, chunk.data(), chunk.size());
+        if (received < 0 && (errno == EINTR || errno == EAGAIN)) {
+            continue;
+        }
+        if (received <= 0) {
+            break;
+        }
+        buffer.append(chunk.data(), static_cast<size_t>(received));
+        last_contact_.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+
+        std::string_view unread = buffer;
+        try {
+            WalRecord record;
+            while (ReadWalRecord(unread, record)) {
+                if (record.op == WalOp::HEARTBEAT) {
+                    if (record.sequence > leader_sequence_.load(std::memory_order_relaxed)) {
+                        leader_sequence_.store(record.sequence, std::memory_order_release);
+                    }
+                    continue;
+                }
+                batch.push_back(std::move(record));
+                if (batch.size() == max_batch_) {
+                    ApplyBatch(batch);
+                    batch.clear();
+                }
+            }
+            ApplyBatch(batch);
+            batch.clear();
+        } catch (const std::exception&) {
+            // Повреждённый журнал или расхождение с ведущим: дальше применять нельзя
+            break;
+        }
+        buffer.erase(0, buffer.size() - unread.size());
+    }
+
+    {
+        std::lock_guard guard(applied_mutex_);
+        connected_.store(false, std::memory_order_release);
+    }
+    applied_condition_.notify_all();
+}
+
+/**
+ * @brief Применяет пачку записей.
+ */
+void ReplicationFollower::ApplyBatch(const std::vector<WalRecord>& batch) {
+    if (batch.empty()) {
+        return;
+    }
+    {
+        std::unique_lock lock(server_mutex_);
+        for (const WalRecord& record : batch) {
+            ApplyWalRecord(search_server_, record);
+        }
+    }
+
+    // Записи снимка идут с номером 0: номер публикуется последней записью с номером
+    const auto numbered = std::find_if(batch.rbegin(), batch.rend(), [](const WalRecord& record) {
+        return record.sequence != 0;
+    });
+    if (numbered == batch.rend()) {
+        return;
+    }
+    const uint64_t sequence = numbered->sequence;
+    if (sequence > leader_sequence_.load(std::memory_order_relaxed)) {
+        leader_sequence_.store(sequence, std::memory_order_release);
+    }
+    {
+        std::lock_guard guard(applied_mutex_);
+        applied_sequence_.store(sequence, std::memory_order_release);
+    }
+    applied_condition_.notify_all();
+}
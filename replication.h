@@ -0,0 +1,294 @@
+/**
+ * @file replication.h
+ * @brief Содержит репликацию поисковой системы передачей журнала изменений (WAL) между процессами.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "search_server.h"
+
+/**
+ * @brief Вид записи журнала изменений.
+ */
+enum class WalOp : uint8_t {
+    ADD = 1,        ///< Добавление документа.
+    REMOVE = 2,     ///< Удаление документа.
+    SET_STATUS = 3, ///< Изменение статуса документа.
+    HEARTBEAT = 4,  ///< Сообщение о текущем номере записи ведущего без изменений.
+    SNAPSHOT_END = 5, ///< Конец снимка; номер записи - последнее изменение, вошедшее в снимок.
+};
+
+/**
+ * @brief Запись журнала изменений.
+ */
+struct WalRecord {
+    uint64_t sequence = 0;                          ///< Номер записи; у изменений возрастает с 1, у записей снимка равен 0.
+    WalOp op = WalOp::HEARTBEAT;                    ///< Вид записи.
+    int document_id = 0;                            ///< Идентификатор документа.
+    DocumentStatus status = DocumentStatus::ACTUAL; ///< Статус документа (ADD, SET_STATUS).
+    std::vector<int> ratings;                       ///< Рейтинги документа (ADD).
+    std::string text;                               ///< Текст документа (ADD).
+};
+
+/**
+ * @brief Дописывает запись в буфер.
+ * @details Формат: varint(длина) varint(номер) байт(вид) поля вида - varint(идентификатор),
+ *          байт(статус), varint(количество рейтингов), рейтинги в zigzag varint, varint(длина текста), текст.
+ * @param out Буфер.
+ * @param record Запись.
+ */
+void AppendWalRecord(std::string& out, const WalRecord& record);
+
+/**
+ * @brief Считывает запись из начала буфера, если она пришла целиком, и сдвигает буфер за неё.
+ * @param in Буфер.
+ * @param record Считанная запись.
+ * @return true, если запись считана; false, если запись в буфере неполная.
+ * @throws invalid_argument Если запись повреждена.
+ */
+bool ReadWalRecord(std::string_view& in, WalRecord& record);
+
+/**
+ * @brief Применяет запись к поисковой системе.
+ * @param search_server Поисковая система.
+ * @param record Запись.
+ */
+void ApplyWalRecord(SearchServer& search_server, const WalRecord& record);
+
+/**
+ * @brief Ведущий узел репликации: изменяет поисковую систему и рассылает журнал ведомым.
+ * @details Все изменения поисковой системы должны идти через ведущий узел. Ведомые подключаются
+ *          дескриптором потокового сокета или канала (socketpair, pipe, Unix-сокет) и получают
+ *          снимок, журнал после снимка и затем каждое новое изменение. Снимок - сжатый журнал:
+ *          по одной записи ADD с номером 0 на живой документ с текущим статусом и запись SNAPSHOT_END
+ *          с номером последнего вошедшего изменения; он перестраивается, когда журнал после снимка
+ *          становится длиннее снимка. Запись ведомому неблокирующая: то, что не удалось записать сразу,
+ *          копится в буфере ведомого и дописывается при следующих изменениях и Heartbeat. Ведомый,
+ *          чей буфер превысил ограничение (сверх начального снимка), или запись которому не удалась,
+ *          отключается. Запись в канал с завершившимся читателем не вызывает SIGPIPE: сигнал
+ *          блокируется на время записи. Методы не потокобезопасны, как и методы SearchServer.
+ */
+class ReplicationLeader {
+public:
+    static constexpr size_t MIN_CHECKPOINT_LOG_SIZE = 1 << 20;      ///< Длина журнала, до которой снимок не перестраивается.
+    static constexpr size_t DEFAULT_MAX_FOLLOWER_BUFFER = 16 << 20; ///< Ограничение буфера ведомого по умолчанию, байт.
+
+    /**
+     * @brief Конструктор класса ReplicationLeader.
+     * @param search_server Поисковая система ведущего; должна быть пустой и жить дольше ведущего.
+     * @param max_follower_buffer Наибольший объём неотправленных ведомому данных сверх начального снимка, байт.
+     * @throws logic_error Если в поисковой системе уже есть документы.
+     */
+    explicit ReplicationLeader(SearchServer& search_server, size_t max_follower_buffer = DEFAULT_MAX_FOLLOWER_BUFFER);
+
+    ReplicationLeader(const ReplicationLeader&) = delete;
+    ReplicationLeader& operator=(const ReplicationLeader&) = delete;
+
+    /**
+     * @brief Деструктор: закрывает дескрипторы ведомых.
+     */
+    ~ReplicationLeader();
+
+    /**
+     * @brief Добавляет документ и рассылает изменение.
+     * @throws invalid_argument В тех же случаях, что SearchServer::AddDocument; изменение тогда не рассылается.
+     */
+    void AddDocument(int document_id, const std::string& document, DocumentStatus status,
+                     const std::vector<int>& ratings);
+
+    /**
+     * @brief Удаляет документ и рассылает изменение; отсутствующий документ игнорируется.
+     * @param document_id Идентификатор документа.
+     */
+    void RemoveDocument(int document_id);
+
+    /**
+     * @brief Изменяет статус документа и рассылает изменение.
+     * @param document_id Идентификатор документа.
+     * @param status Новый статус.
+     * @throws out_of_range Если документ не найден.
+     */
+    void SetDocumentStatus(int document_id, DocumentStatus status);
+
+    /**
+     * @brief Рассылает номер последнего изменения, чтобы ведомые могли оценить своё отставание.
+     * @details Заодно дописывает ведомым накопленные в буферах данные, поэтому вызывается периодически.
+     */
+    void Heartbeat();
+
+    /**
+     * @brief Подключает ведомого: отправляет номер последнего изменения, снимок и журнал после него.
+     * @details Дескриптор переводится в неблокирующий режим; неотправленная часть остаётся в буфере ведомого.
+     * @param fd Дескриптор для записи; ведущий становится его владельцем.
+     * @return true, если ведомый подключён; false, если запись не удалась и дескриптор закрыт.
+     */
+    bool AddFollower(int fd);
+
+    /**
+     * @brief Перестраивает снимок по текущему состоянию и очищает журнал после него.
+     */
+    void Checkpoint();
+
+    /**
+     * @brief Возвращает номер последнего изменения.
+     * @return Номер изменения; 0, если изменений не было.
+     */
+    uint64_t GetSequence() const;
+
+    /**
+     * @brief Возвращает количество подключённых ведомых.
+     * @return Количество ведомых.
+     */
+    size_t GetFollowerCount() const;
+
+private:
+    /**
+     * @brief Живой документ для построения снимка.
+     */
+    struct LiveDocument {
+        std::string text;           ///< Текст.
+        DocumentStatus status;      ///< Статус.
+        std::vector<int> ratings;   ///< Рейтинги.
+    };
+
+    /**
+     * @brief Подключённый ведомый.
+     */
+    struct Follower {
+        int fd;                 ///< Дескриптор для записи.
+        bool is_socket;         ///< false, если дескриптор оказался каналом; запоминается после первой записи.
+        std::string pending;    ///< Данные, которые ещё не удалось записать.
+        size_t max_pending;     ///< Ограничение буфера: начальные данные плюс max_follower_buffer_.
+    };
+
+    SearchServer& search_server_;                   ///< Поисковая система ведущего.
+    size_t max_follower_buffer_;                    ///< Ограничение буфера ведомого сверх начального снимка.
+    uint64_t sequence_ = 0;                         ///< Номер последнего изменения.
+    std::map<int, LiveDocument> live_documents_;    ///< Живые документы.
+    std::string snapshot_;                          ///< Снимок: записи ADD живых документов.
+    std::string log_tail_;                          ///< Записи после снимка.
+    std::vector<Follower> followers_;               ///< Ведомые.
+
+    /**
+     * @brief Кодирует запись, добавляет её в журнал и рассылает ведомым.
+     */
+    void Publish(WalRecord record);
+
+    /**
+     * @brief Отправляет данные всем ведомым без блокировки, отключая тех, кому запись не удалась
+     *        или чей буфер переполнен.
+     */
+    void Broadcast(const std::string& data);
+};
+
+/**
+ * @brief Ведомый узел репликации: применяет журнал ведущего и обслуживает чтение.
+ * @details Фоновый поток читает дескриптор и применяет пришедшие записи пачками до max_batch под
+ *          эксклюзивной блокировкой; чтение через Read идёт под разделяемой блокировкой. Отставание
+ *          ограничено временем одной пачки и периодом опроса: GetLag и GetTimeSinceLeaderContact
+ *          позволяют отказаться от чтения при слишком старых данных.
+ */
+class ReplicationFollower {
+public:
+    static constexpr size_t DEFAULT_MAX_BATCH = 1024;   ///< Максимальное количество записей в пачке по умолчанию.
+    static constexpr int POLL_INTERVAL_MS = 10;         ///< Период проверки признака остановки.
+
+    /**
+     * @brief Конструктор класса ReplicationFollower: начинает применять журнал.
+     * @param search_server Пустая поисковая система с теми же стоп-словами и настройками, что у ведущего;
+     *                      перемещается, так как копия поисковой системы ссылалась бы на слова исходной.
+     * @param fd Дескриптор для чтения; ведомый становится его владельцем.
+     * @param max_batch Максимальное количество записей, применяемых под одной блокировкой.
+     */
+    ReplicationFollower(SearchServer&& search_server, int fd, size_t max_batch = DEFAULT_MAX_BATCH);
+
+    ReplicationFollower(const ReplicationFollower&) = delete;
+    ReplicationFollower& operator=(const ReplicationFollower&) = delete;
+
+    /**
+     * @brief Деструктор: останавливает поток и закрывает дескриптор.
+     */
+    ~ReplicationFollower();
+
+    /**
+     * @brief Выполняет функцию над поисковой системой под разделяемой блокировкой.
+     * @tparam Function Тип функции, принимающей const SearchServer&.
+     * @param function Функция.
+     * @return Результат функции.
+     */
+    template <typename Function>
+    auto Read(Function function) const {
+        std::shared_lock lock(server_mutex_);
+        return function(static_cast<const SearchServer&>(search_server_));
+    }
+
+    /**
+     * @brief Возвращает номер последнего применённого изменения.
+     * @details Записи снимка номера не несут: номер снимка публикуется только после применения
+     *          его последней записи, поэтому при загрузке снимка отставание не обнуляется раньше времени.
+     * @return Номер изменения.
+     */
+    uint64_t GetAppliedSequence() const;
+
+    /**
+     * @brief Возвращает количество известных, но ещё не применённых изменений.
+     * @return Разность последнего известного номера ведущего и применённого номера.
+     */
+    uint64_t GetLag() const;
+
+    /**
+     * @brief Возвращает время с последней полученной от ведущего записи.
+     * @return Время.
+     */
+    std::chrono::steady_clock::duration GetTimeSinceLeaderContact() const;
+
+    /**
+     * @brief Проверяет, открыто ли соединение с ведущим.
+     * @return false, если ведущий закрыл соединение или прислал повреждённые данные.
+     */
+    bool IsConnected() const;
+
+    /**
+     * @brief Ждёт применения изменения с заданным номером.
+     * @param sequence Номер изменения.
+     * @param timeout Максимальное время ожидания.
+     * @return true, если изменение применено.
+     */
+    bool WaitForSequence(uint64_t sequence, std::chrono::milliseconds timeout) const;
+
+private:
+    SearchServer search_server_;                                ///< Поисковая система ведомого.
+    mutable std::shared_mutex server_mutex_;                    ///< Блокировка поисковой системы.
+    int fd_;                                                    ///< Дескриптор журнала.
+    size_t max_batch_;                                          ///< Максимальное количество записей в пачке.
+    std::atomic<uint64_t> applied_sequence_{0};                 ///< Номер последнего применённого изменения.
+    std::atomic<uint64_t> leader_sequence_{0};                  ///< Последний известный номер ведущего.
+    std::atomic<int64_t> last_contact_;                         ///< Время последней записи от ведущего, нс steady_clock.
+    std::atomic<bool> connected_{true};                         ///< Открыто ли соединение.
+    std::atomic<bool> stopping_{false};                         ///< Признак остановки.
+    mutable std::mutex applied_mutex_;                          ///< Мьютекс ожидания применения.
+    mutable std::condition_variable applied_condition_;         ///< Уведомление о применении.
+    std::thread reader_;                                        ///< Поток чтения журнала.
+
+    /**
+     * @brief Цикл чтения и применения журнала.
+     */
+    void Run();
+
+    /**
+     * @brief Применяет пачку записей.
+     */
+    void ApplyBatch(const std::vector<WalRecord>& batch);
+};
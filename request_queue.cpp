@@ -1,5 +1,7 @@
 #include "request_queue.h"
 
+#include "tracing.h"
+
 /**
  * @brief Добавляет запрос на поиск документов с указанным запросом и статусом.
  * @param raw_query Необработанный запрос.
@@ -7,8 +9,9 @@
  * @return Вектор документов, найденных по запросу.
  */
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus status) {
+    const auto start = std::chrono::steady_clock::now();
     const auto result = search_server_.FindTopDocuments(raw_query, status);
-    AddRequest(result.size());
+    AddRequest(raw_query, static_cast<QueryLogTag>(status), result.size(), start);
     return result;
 }
 
@@ -18,8 +21,9 @@ std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query,
  * @return Вектор документов, найденных по запросу.
  */
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query) {
+    const auto start = std::chrono::steady_clock::now();
     const auto result = search_server_.FindTopDocuments(raw_query);
-    AddRequest(result.size());
+    AddRequest(raw_query, QueryLogTag::ACTUAL, result.size(), start);
     return result;
 }
 
@@ -31,11 +35,116 @@ int RequestQueue::GetNoResultRequests() const {
     return no_results_requests_;
 }
 
+/**
+ * @brief Возвращает самые частые запросы за всё время работы очереди.
+ * @param count Количество запросов.
+ * @return Запросы по убыванию оценки частоты.
+ */
+std::vector<QueryCount> RequestQueue::GetTopQueries(size_t count) const {
+    return top_queries_.GetTop(count);
+}
+
+/**
+ * @brief Возвращает самые частые запросы без результатов за всё время работы очереди.
+ * @param count Количество запросов.
+ * @return Запросы по убыванию оценки частоты.
+ */
+std::vector<QueryCount> RequestQueue::GetTopNoResultQueries(size_t count) const {
+    return top_no_result_queries_.GetTop(count);
+}
+
+/**
+ * @brief Оценивает количество появлений запроса за всё время работы очереди.
+ * @param raw_query Необработанный запрос.
+ * @return Оценка сверху количества появлений.
+ */
+uint64_t RequestQueue::EstimateQueryCount(const std::string& raw_query) const {
+    return query_counts_.Estimate(HashQuery(raw_query));
+}
+
+/**
+ * @brief Оценивает количество различных запросов за всё время работы очереди.
+ * @return Оценка количества различных запросов.
+ */
+double RequestQueue::EstimateDistinctQueryCount() const {
+    return distinct_queries_.Estimate();
+}
+
+/**
+ * @brief Включает запись журнала запросов.
+ * @param path Путь к файлу журнала.
+ * @throws invalid_argument Если файл не удалось открыть.
+ */
+void RequestQueue::EnableQueryLog(const std::string& path) {
+    query_log_.reset();
+    query_log_ = std::make_unique<QueryLogWriter>(path);
+}
+
+/**
+ * @brief Выключает запись журнала запросов, дописывая в файл оставшиеся записи.
+ */
+void RequestQueue::DisableQueryLog() {
+    query_log_.reset();
+}
+
+/**
+ * @brief Возвращает количество записей журнала, отброшенных из-за переполнения очереди.
+ * @return Количество отброшенных записей; 0, если журнал выключен.
+ */
+uint64_t RequestQueue::GetDroppedQueryLogEntries() const {
+    return query_log_ ? query_log_->GetDroppedCount() : 0;
+}
+
+/**
+ * @brief Возвращает первую ошибку записи журнала запросов.
+ * @return Текст ошибки; пустая строка, если ошибок не было или журнал выключен.
+ */
+std::string RequestQueue::GetQueryLogError() const {
+    return query_log_ ? query_log_->GetError() : std::string();
+}
+
+/**
+ * @brief Регистрирует метрики очереди запросов и начинает их обновлять.
+ * @param registry Реестр метрик.
+ * @throws invalid_argument Если метрики с такими именами уже зарегистрированы.
+ */
+void RequestQueue::EnableMetrics(MetricsRegistry& registry) {
+    QueueMetrics metrics;
+    metrics.requests = &registry.AddCounter("request_queue_requests_total", "Requests processed");
+    metrics.no_result_requests = &registry.AddCounter("request_queue_no_result_requests_total",
+                                                      "Requests that found no documents");
+    metrics.request_seconds = &registry.AddHistogram("request_queue_request_duration_seconds",
+                                                     "Request execution time", GetLatencyBuckets());
+    metrics.window_requests = &registry.AddGauge("request_queue_window_requests",
+                                                 "Requests in the last-day window");
+    metrics.window_no_result_requests = &registry.AddGauge("request_queue_window_no_result_requests",
+                                                           "Requests without results in the last-day window");
+    metrics_ = metrics;
+}
+
 /**
  * @brief Добавляет новый запрос в очередь и обновляет статистику.
+ * @param raw_query Необработанный запрос.
+ * @param tag Вид фильтра запроса.
  * @param results_num Количество результатов поиска для текущего запроса.
+ * @param start Время начала выполнения запроса.
  */
-void RequestQueue::AddRequest(int results_num) {
+void RequestQueue::AddRequest(const std::string& raw_query, QueryLogTag tag, int results_num,
+                              std::chrono::steady_clock::time_point start) {
+    using namespace std::chrono;
+    const auto elapsed = steady_clock::now() - start;
+    SEARCH_TRACE(request__add, raw_query.c_str(), results_num, static_cast<int>(tag));
+    if (query_log_) {
+        const auto latency = duration_cast<microseconds>(elapsed).count();
+        QueryLogEntry entry;
+        entry.timestamp = duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+        entry.raw_query = raw_query;
+        entry.tag = tag;
+        entry.result_count = static_cast<uint32_t>(results_num);
+        entry.latency = static_cast<uint32_t>(latency);
+        query_log_->Append(std::move(entry));
+    }
+
     // Новый запрос - новая секунда
     ++current_time_;
 
@@ -52,4 +161,23 @@ void RequestQueue::AddRequest(int results_num) {
     if (0 == results_num) {
         ++no_results_requests_;
     }
+
+    // Обновляем эскизы потока запросов
+    const uint64_t query_hash = HashQuery(raw_query);
+    query_counts_.Add(query_hash);
+    distinct_queries_.Add(query_hash);
+    top_queries_.Add(raw_query);
+    if (0 == results_num) {
+        top_no_result_queries_.Add(raw_query);
+    }
+
+    if (metrics_) {
+        metrics_->requests->Add();
+        if (0 == results_num) {
+            metrics_->no_result_requests->Add();
+        }
+        metrics_->request_seconds->Observe(duration<double>(elapsed).count());
+        metrics_->window_requests->Set(requests_.size());
+        metrics_->window_no_result_requests->Set(no_results_requests_);
+    }
 }
@@ -1,6 +1,12 @@
 #pragma once
+#include <chrono>
 #include <deque>
 #include <cstdint>
+#include <memory>
+#include <optional>
+#include "metrics.h"
+#include "query_log.h"
+#include "query_sketches.h"
 #include "search_server.h"
 
 /**
@@ -15,7 +21,11 @@ public:
     explicit RequestQueue(const SearchServer& search_server)
             : search_server_(search_server)
             , no_results_requests_(0)
-            , current_time_(0) {
+            , current_time_(0)
+            , top_queries_(top_queries_capacity_)
+            , top_no_result_queries_(top_queries_capacity_)
+            , query_counts_(query_counts_width_, query_counts_depth_)
+            , distinct_queries_(distinct_queries_precision_) {
     }
 
     /**
@@ -49,6 +59,73 @@ public:
      */
     int GetNoResultRequests() const;
 
+    /**
+     * @brief Возвращает самые частые запросы за всё время работы очереди.
+     * @details Оценка алгоритмом Space-Saving в ограниченной памяти: гарантированно содержит запросы,
+     *          составляющие больше 1 / top_queries_capacity_ всех запросов.
+     * @param count Количество запросов.
+     * @return Запросы по убыванию оценки частоты.
+     */
+    std::vector<QueryCount> GetTopQueries(size_t count) const;
+
+    /**
+     * @brief Возвращает самые частые запросы без результатов за всё время работы очереди.
+     * @param count Количество запросов.
+     * @return Запросы по убыванию оценки частоты.
+     */
+    std::vector<QueryCount> GetTopNoResultQueries(size_t count) const;
+
+    /**
+     * @brief Оценивает количество появлений запроса за всё время работы очереди (эскиз Count-Min).
+     * @param raw_query Необработанный запрос.
+     * @return Оценка сверху количества появлений.
+     */
+    uint64_t EstimateQueryCount(const std::string& raw_query) const;
+
+    /**
+     * @brief Оценивает количество различных запросов за всё время работы очереди (HyperLogLog).
+     * @return Оценка количества различных запросов.
+     */
+    double EstimateDistinctQueryCount() const;
+
+    /**
+     * @brief Включает запись журнала запросов.
+     * @details Каждый запрос записывается со временем, текстом, видом фильтра, количеством результатов
+     *          и временем выполнения. Запись идёт в фоновом потоке через неблокирующую очередь;
+     *          при её переполнении записи отбрасываются. Повторный вызов закрывает прежний журнал.
+     * @param path Путь к файлу журнала; прочитать его можно функцией ReadQueryLog.
+     * @throws invalid_argument Если файл не удалось открыть.
+     */
+    void EnableQueryLog(const std::string& path);
+
+    /**
+     * @brief Выключает запись журнала запросов, дописывая в файл оставшиеся записи.
+     */
+    void DisableQueryLog();
+
+    /**
+     * @brief Возвращает количество записей журнала, отброшенных из-за переполнения очереди.
+     * @return Количество отброшенных записей; 0, если журнал выключен.
+     */
+    uint64_t GetDroppedQueryLogEntries() const;
+
+    /**
+     * @brief Возвращает первую ошибку записи журнала запросов.
+     * @return Текст ошибки; пустая строка, если ошибок не было или журнал выключен.
+     */
+    std::string GetQueryLogError() const;
+
+    /**
+     * @brief Регистрирует метрики очереди запросов и начинает их обновлять.
+     * @details Метрики: request_queue_requests_total, request_queue_no_result_requests_total,
+     *          request_queue_request_duration_seconds (гистограмма времени выполнения),
+     *          request_queue_window_requests и request_queue_window_no_result_requests (запросы
+     *          в окне последних суток).
+     * @param registry Реестр метрик; должен жить дольше очереди.
+     * @throws invalid_argument Если метрики с такими именами уже зарегистрированы.
+     */
+    void EnableMetrics(MetricsRegistry& registry);
+
 private:
     /**
      * @brief Структура для хранения результата запроса и временной метки.
@@ -63,17 +140,44 @@ private:
     int no_results_requests_; ///< Количество запросов без результатов.
     uint64_t current_time_; ///< Текущее время.
     const static int min_in_day_ = 1440; ///< Минут в сутках.
+    const static size_t top_queries_capacity_ = 64; ///< Количество счётчиков частых запросов.
+    const static size_t query_counts_width_ = 2048; ///< Ширина эскиза Count-Min.
+    const static size_t query_counts_depth_ = 4; ///< Глубина эскиза Count-Min.
+    const static int distinct_queries_precision_ = 12; ///< Точность HyperLogLog (4096 регистров).
+    SpaceSaving top_queries_; ///< Частые запросы.
+    SpaceSaving top_no_result_queries_; ///< Частые запросы без результатов.
+    CountMinSketch query_counts_; ///< Частоты запросов.
+    HyperLogLog distinct_queries_; ///< Различные запросы.
+    std::unique_ptr<QueryLogWriter> query_log_; ///< Журнал запросов; пуст, если запись выключена.
+
+    /**
+     * @brief Метрики очереди запросов в реестре.
+     */
+    struct QueueMetrics {
+        Counter* requests;                  ///< Количество запросов.
+        Counter* no_result_requests;        ///< Количество запросов без результатов.
+        Histogram* request_seconds;         ///< Время выполнения запросов.
+        Gauge* window_requests;             ///< Запросы в окне.
+        Gauge* window_no_result_requests;   ///< Запросы без результатов в окне.
+    };
+
+    std::optional<QueueMetrics> metrics_; ///< Метрики; пусто, если не включены.
 
     /**
      * @brief Добавляет новый запрос в очередь и обновляет статистику.
+     * @param raw_query Необработанный запрос.
+     * @param tag Вид фильтра запроса.
      * @param results_num Количество результатов поиска для текущего запроса.
+     * @param start Время начала выполнения запроса.
      */
-    void AddRequest(int results_num);
+    void AddRequest(const std::string& raw_query, QueryLogTag tag, int results_num,
+                    std::chrono::steady_clock::time_point start);
 };
 
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
+    const auto start = std::chrono::steady_clock::now();
     const auto result = search_server_.FindTopDocuments(raw_query, document_predicate);
-    AddRequest(result.size());
+    AddRequest(raw_query, QueryLogTag::PREDICATE, result.size(), start);
     return result;
 }
@@ -0,0 +1,54 @@
+/**
+ * @file reranking.h
+ * @brief Содержит структуры двухэтапного поиска с переранжированием.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "document.h"
+
+/**
+ * @brief Параметры двухэтапного поиска.
+ */
+struct RerankOptions {
+    size_t candidate_count = 1000;                      ///< Количество кандидатов первого этапа.
+    size_t result_count = MAX_RESULT_DOCUMENT_COUNT;    ///< Количество документов в результате.
+    std::chrono::microseconds latency_budget = std::chrono::microseconds::max(); ///< Допустимое время выполнения запроса.
+    size_t batch_size = 64;                             ///< Количество кандидатов, после переранжирования которых проверяется бюджет времени.
+};
+
+/**
+ * @brief Признаки одного кандидата, передаваемые функции переранжирования.
+ */
+struct RerankFeatures {
+    int document_id = 0;                ///< Идентификатор документа.
+    double relevance = 0.0;             ///< Релевантность TF-IDF первого этапа.
+    int rating = 0;                     ///< Рейтинг документа.
+    double proximity = 0.0;             ///< Близость слов запроса: число совпавших слов, делённое на длину минимального окна с ними; 0, если последовательности слов не хранятся.
+    const double* term_freqs = nullptr; ///< Частоты плюс-слов запроса в документе.
+    size_t term_count = 0;              ///< Количество плюс-слов запроса.
+};
+
+/**
+ * @brief Колоночный набор признаков кандидатов.
+ */
+struct FeatureBatch {
+    std::vector<std::string> terms;     ///< Плюс-слова запроса в порядке столбцов term_freqs.
+    DocumentColumns candidates;         ///< Кандидаты первого этапа от лучшего к худшему.
+    std::vector<double> proximities;    ///< Близость слов запроса для каждого кандидата.
+    std::vector<double> term_freqs;     ///< Частоты слов запроса, построчно: [кандидат][слово].
+
+    /**
+     * @brief Возвращает признаки i-го кандидата.
+     * @param i Номер кандидата.
+     * @return Признаки кандидата.
+     */
+    RerankFeatures Row(size_t i) const {
+        return {candidates.ids[i], candidates.relevances[i], candidates.ratings[i], proximities[i],
+                term_freqs.data() + i * terms.size(), terms.size()};
+    }
+};
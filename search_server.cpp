@@ -14,16 +14,202 @@ void SearchServer::AddDocument(int document_id, const std::string& document, Doc
     if ((document_id < 0) || documents_.count(document_id)) {
         throw std::invalid_argument("Document id less than zero or already exists");
     }
+    SEARCH_TRACE(add__document__start, document_id, document.size());
 
     const std::vector<std::string> words = SplitIntoWordsNoStop(document);
     const double inv_word_count = 1.0 / words.size();
 
+    if (document_store_) {
+        document_store_.Mutable().AddDocument(document_id, document);
+    }
+
+    // Копия поисковой системы после Clone копирует только затронутые сегменты и списки слов этого
+    // документа, а не весь индекс
+    std::map<std::string_view, double>& word_freqs = document_to_word_freqs_.Mutable(document_id).second.Mutable();
+    std::vector<std::string_view> document_words;
+    if (document_words_) {
+        document_words.reserve(words.size());
+    }
     for (const std::string& word : words) {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
+        auto [term, postings] = word_to_document_freqs_.Mutable(dictionary_->Intern(word));
+        postings.Mutable(document_id).second += inv_word_count;
+        word_freqs[term] += inv_word_count;
+        if (document_words_) {
+            document_words.push_back(term);
+        }
+    }
+
+    // Документ попадает в списки уже выбранных пар; индекс пар строится только по последовательностям слов
+    if (!shingle_to_documents_->empty()) {
+        auto& shingle_to_documents = shingle_to_documents_.Mutable();
+        for (size_t i = 1; i < document_words.size(); ++i) {
+            const auto it = shingle_to_documents.find({document_words[i - 1], document_words[i]});
+            if (it == shingle_to_documents.end()) {
+                continue;
+            }
+            std::vector<int>& shingle_documents = it->second;
+            const auto position = std::lower_bound(shingle_documents.begin(), shingle_documents.end(), document_id);
+            if (position == shingle_documents.end() || *position != document_id) {
+                shingle_documents.insert(position, document_id);
+            }
+        }
+    }
+
+    if (document_words_) {
+        document_words_.Mutable().emplace(document_id, std::move(document_words));
+    }
+
+    const int rating = ComputeAverageRating(ratings);
+    documents_.Mutable(document_id).second = DocumentData{rating, status};
+    document_columns_.Mutable(document_id).second = document_ids->size();
+    document_ids.Mutable().push_back(document_id);
+    document_ratings_.Mutable().push_back(rating);
+    document_statuses_.Mutable().push_back(status);
+    if (static_rank_index_) {
+        static_rank_index_.Mutable().Add(document_id, rating, word_freqs);
+    }
+    posting_count_ += word_freqs.size();
+    if (metrics_) {
+        metrics_->documents_added->Add();
+        UpdateIndexMetrics();
+    }
+    SEARCH_TRACE(add__document__done, document_id, words.size());
+
+    PurgeExpiredDocumentsOnWrite();
+}
+
+/**
+ * @brief Добавляет в поисковую систему документ с ограниченным сроком жизни.
+ * @param document_id Уникальный идентификатор документа.
+ * @param document Текст документа.
+ * @param status Статус документа.
+ * @param ratings Вектор рейтингов документа.
+ * @param expires_at Момент, с которого документ не попадает в результаты поиска.
+ * @throws invalid_argument Если document_id меньше нуля или уже существует,
+ *                           или если document содержит недопустимые символы.
+ */
+void SearchServer::AddDocument(int document_id, const std::string& document, DocumentStatus status,
+                               const std::vector<int>& ratings, std::chrono::system_clock::time_point expires_at) {
+    AddDocument(document_id, document, status, ratings);
+    documents_.Mutable(document_id).second.expires_at = expires_at;
+    expiry_queue_.Mutable().emplace(expires_at, document_id);
+}
+
+/**
+ * @brief Удаляет документ из поисковой системы.
+ * @param document_id Идентификатор документа.
+ */
+void SearchServer::RemoveDocument(int document_id) {
+    if (documents_.count(document_id) == 0) {
+        return;
+    }
+    EraseDocument(document_id);
+    EraseDocumentColumns({document_id});
+    UpdateIndexMetrics();
+}
+
+/**
+ * @brief Ставит в очередь удаления документы, срок жизни которых истёк.
+ * @param now Текущий момент.
+ * @return Количество документов, поставленных в очередь.
+ */
+size_t SearchServer::ExpireDocuments(std::chrono::system_clock::time_point now) {
+    if (expiry_queue_->empty() || expiry_queue_->begin()->first > now) {
+        return 0;
+    }
+    auto& expiry_queue = expiry_queue_.Mutable();
+    auto& expired_documents = expired_documents_.Mutable();
+    size_t count = 0;
+    while (!expiry_queue.empty() && expiry_queue.begin()->first <= now) {
+        expired_documents.insert(expiry_queue.begin()->second);
+        expiry_queue.erase(expiry_queue.begin());
+        ++count;
+    }
+    return count;
+}
+
+/**
+ * @brief Удаляет из индексов пачку документов с истёкшим сроком жизни из очереди удаления.
+ * @param max_count Максимальное количество удаляемых документов.
+ * @return Количество удалённых документов.
+ */
+size_t SearchServer::PurgeExpiredDocuments(size_t max_count) {
+    if (expired_documents_->empty() || max_count == 0) {
+        return 0;
+    }
+    auto& expired_documents = expired_documents_.Mutable();
+    std::set<int> batch;
+    while (!expired_documents.empty() && batch.size() < max_count) {
+        batch.insert(expired_documents.extract(expired_documents.begin()));
+    }
+    // Колонки документов сжимаются один раз на пачку, а не сдвигаются на каждый документ
+    for (const int document_id : batch) {
+        EraseDocument(document_id);
+    }
+    EraseDocumentColumns(batch);
+
+    if (document_store_) {
+        document_store_.Mutable().Compact();
+    }
+    // Проход по словарю окупается, когда с прошлой очистки словарь вырос вдвое; разделяемый копиями
+    // словарь не очищается, так как его слова могут быть в индексах копий
+    if (dictionary_->GetSize() > 2 * swept_dictionary_size_) {
+        dictionary_->RemoveUnused([this](std::string_view word) {
+            return word_to_document_freqs_.count(word) > 0
+                   || (static_rank_index_ && static_rank_index_->HasWord(word));
+        });
+        swept_dictionary_size_ = dictionary_->GetSize();
     }
+    UpdateIndexMetrics();
+    return batch.size();
+}
+
+/**
+ * @brief Ставит в очередь удаления истёкшие документы и удаляет пачку, если очередь достигла
+ *        EXPIRED_PURGE_BATCH_SIZE.
+ */
+void SearchServer::PurgeExpiredDocumentsOnWrite() {
+    if (expiry_queue_->empty() && expired_documents_->empty()) {
+        return;
+    }
+    ExpireDocuments();
+    if (expired_documents_->size() >= EXPIRED_PURGE_BATCH_SIZE) {
+        PurgeExpiredDocuments(EXPIRED_PURGE_BATCH_SIZE);
+    }
+}
+
+/**
+ * @brief Возвращает количество документов в очереди удаления.
+ * @return Количество документов.
+ */
+size_t SearchServer::GetExpiredDocumentCount() const {
+    return expired_documents_->size();
+}
 
-    documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status});
-    document_ids.push_back(document_id);
+/**
+ * @brief Изменяет статус документа.
+ * @param document_id Идентификатор документа.
+ * @param status Новый статус.
+ * @throws out_of_range Если документ не найден.
+ */
+void SearchServer::SetDocumentStatus(int document_id, DocumentStatus status) {
+    if (documents_.count(document_id) == 0) {
+        throw std::out_of_range("Document not found in SetDocumentStatus function");
+    }
+    documents_.Mutable(document_id).second.status = status;
+    document_statuses_.Mutable()[document_columns_.at(document_id)] = status;
+}
+
+/**
+ * @brief Создаёт копию поисковой системы для экспериментов.
+ * @return Копия, разделяющая с исходной системой неизменённые компоненты.
+ */
+SearchServer SearchServer::Clone() const {
+    SearchServer clone(*this);
+    clone.slow_query_log_.reset();
+    clone.metrics_.reset();
+    clone.shadow_executor_.reset();
+    return clone;
 }
 
 /**
@@ -38,11 +224,111 @@ std::vector<Document> SearchServer::FindTopDocuments(const std::string& raw_quer
         throw std::invalid_argument("Invalid word in FindTopDocuments function");
     }
 
-    auto predicate = [status](int document_id, DocumentStatus doc_status, int rating) {
-        return doc_status == status;
-    };
+    const auto predicate = MakeStatusPredicate(status);
+
+    if (!shadow_executor_) {
+        return FindTopDocuments(raw_query, predicate);
+    }
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<Document> result = FindTopDocuments(raw_query, predicate);
+    shadow_executor_->Submit(raw_query, status, result, std::chrono::steady_clock::now() - start);
+    return result;
+}
 
-    return FindTopDocuments(raw_query, predicate);
+/**
+ * @brief Объясняет релевантность документа для запроса с указанным статусом.
+ * @param raw_query Необработанный запрос.
+ * @param document_id Идентификатор документа.
+ * @param status Статус документа для поиска.
+ * @return Вклад каждого плюс-слова, исключившие документ минус-слова и итоговая релевантность.
+ * @throws invalid_argument Если запрос содержит недопустимые символы.
+ * @throws out_of_range Если документ не найден.
+ */
+SearchServer::ScoreExplanation SearchServer::ExplainScore(const std::string& raw_query, int document_id,
+                                                          DocumentStatus status) const {
+    return ExplainScore(raw_query, document_id, MakeStatusPredicate(status));
+}
+
+/**
+ * @brief Находит большое количество лучших документов для последующего переранжирования.
+ * @param raw_query Необработанный запрос.
+ * @param count Количество документов, которое нужно найти.
+ * @param result Буфер, в который записываются документы от лучшего к худшему.
+ * @param status Статус документа для поиска.
+ * @throws invalid_argument Если запрос содержит недопустимые символы.
+ */
+void SearchServer::FindTopCandidates(const std::string& raw_query, size_t count, DocumentColumns& result,
+                                     DocumentStatus status) const {
+    FindTopCandidates(raw_query, count, result, MakeStatusPredicate(status));
+}
+
+/**
+ * @brief Параллельно заполняет частоты слов и близость слов запроса для части кандидатов.
+ * @param batch Набор с заполненными словами запроса и кандидатами и размеченными столбцами признаков.
+ * @param first Номер первого кандидата.
+ * @param last Номер за последним кандидатом.
+ */
+void SearchServer::ExtractRerankFeatures(FeatureBatch& batch, size_t first, size_t last) const {
+    const size_t term_count = batch.terms.size();
+
+    // Ключи словаря уникальны, поэтому слова документа ищутся среди них по адресу
+    std::vector<const char*> term_keys(term_count, nullptr);
+    std::unordered_map<const char*, int> key_to_term;
+    for (size_t term = 0; term < term_count; ++term) {
+        const auto it = word_to_document_freqs_.find(batch.terms[term]);
+        if (it != word_to_document_freqs_.end()) {
+            term_keys[term] = it->first.data();
+            key_to_term.emplace(term_keys[term], static_cast<int>(term));
+        }
+    }
+
+    std::vector<size_t> rows(last - first);
+    std::iota(rows.begin(), rows.end(), first);
+    std::for_each(std::execution::par, rows.begin(), rows.end(), [&](size_t row) {
+        const int document_id = batch.candidates.ids[row];
+        const auto& word_freqs = *document_to_word_freqs_.at(document_id);
+        double* term_freqs = batch.term_freqs.data() + row * term_count;
+        size_t matched_terms = 0;
+        for (size_t term = 0; term < term_count; ++term) {
+            if (term_keys[term] == nullptr) {
+                continue;
+            }
+            const auto it = word_freqs.find(batch.terms[term]);
+            if (it != word_freqs.end()) {
+                term_freqs[term] = it->second;
+                ++matched_terms;
+            }
+        }
+        if (matched_terms == 0 || !document_words_) {
+            return;
+        }
+
+        // Минимальное окно, содержащее все совпавшие слова запроса
+        const std::vector<std::string_view>& words = document_words_->at(document_id);
+        std::vector<int> word_terms(words.size(), -1);
+        for (size_t pos = 0; pos < words.size(); ++pos) {
+            const auto it = key_to_term.find(words[pos].data());
+            if (it != key_to_term.end()) {
+                word_terms[pos] = it->second;
+            }
+        }
+        std::vector<size_t> in_window(term_count, 0);
+        size_t covered = 0;
+        size_t best_window = words.size();
+        for (size_t left = 0, right = 0; right < words.size(); ++right) {
+            if (word_terms[right] >= 0 && in_window[word_terms[right]]++ == 0) {
+                ++covered;
+            }
+            while (covered == matched_terms) {
+                best_window = std::min(best_window, right - left + 1);
+                if (word_terms[left] >= 0 && --in_window[word_terms[left]] == 0) {
+                    --covered;
+                }
+                ++left;
+            }
+        }
+        batch.proximities[row] = static_cast<double>(matched_terms) / best_window;
+    });
 }
 
 /**
@@ -91,13 +377,731 @@ std::tuple<std::vector<std::string>, DocumentStatus> SearchServer::MatchDocument
     return std::make_tuple(matched_words, documents_.at(document_id).status);
 }
 
+/**
+ * @brief Сопоставляет один запрос с набором документов.
+ * @param raw_query Необработанный запрос.
+ * @param document_ids Идентификаторы документов.
+ * @return Плюс-слова запроса и маски совпадений для каждого документа.
+ * @throws invalid_argument Если запрос содержит недопустимые символы.
+ * @throws out_of_range Если какой-либо документ не найден.
+ */
+SearchServer::QueryMatches SearchServer::MatchDocuments(const std::string& raw_query,
+                                                        const std::vector<int>& document_ids) const {
+    if (!IsValidWord(raw_query)) {
+        throw std::invalid_argument("Invalid word in MatchDocuments function");
+    }
+
+    const Query query = ParseQuery(raw_query);
+
+    // Разрешаем слова запроса в ключи индекса один раз; пустой ключ означает отсутствующее слово
+    QueryMatches result;
+    std::vector<std::string_view> plus_terms;
+    for (const std::string& word : query.plus_words) {
+        const auto it = word_to_document_freqs_.find(word);
+        plus_terms.push_back(it == word_to_document_freqs_.end() ? std::string_view() : std::string_view(it->first));
+        result.words.push_back(word);
+    }
+    std::vector<std::string_view> minus_terms;
+    for (const std::string& word : query.minus_words) {
+        const auto it = word_to_document_freqs_.find(word);
+        if (it != word_to_document_freqs_.end()) {
+            minus_terms.push_back(it->first);
+        }
+    }
+
+    // Исключение из параллельного участка приводит к std::terminate, поэтому отсутствие документа
+    // только отмечается и сообщается после обработки
+    std::atomic_bool has_missing_document = false;
+    result.documents.resize(document_ids.size());
+    std::transform(std::execution::par, document_ids.begin(), document_ids.end(), result.documents.begin(),
+                   [&](int document_id) {
+                       DocumentMatch match{std::vector<bool>(plus_terms.size()), DocumentStatus::ACTUAL};
+                       const auto document_it = documents_.find(document_id);
+                       if (document_it == documents_.end()) {
+                           has_missing_document = true;
+                           return match;
+                       }
+                       match.status = document_it->second.status;
+
+                       const auto& word_freqs = *document_to_word_freqs_.at(document_id);
+                       for (const std::string_view term : minus_terms) {
+                           if (word_freqs.count(term)) {
+                               return match;
+                           }
+                       }
+                       for (size_t i = 0; i < plus_terms.size(); ++i) {
+                           match.matched_words[i] = !plus_terms[i].empty() && word_freqs.count(plus_terms[i]) > 0;
+                       }
+                       return match;
+                   });
+
+    if (has_missing_document) {
+        throw std::out_of_range("Document not found in MatchDocuments function");
+    }
+    return result;
+}
+
+/**
+ * @brief Включает хранение сжатых исходных текстов документов.
+ * @param block_size Размер несжатого блока хранилища.
+ * @param cache_blocks Количество распакованных блоков, хранимых в кеше.
+ * @throws logic_error Если в поисковую систему уже добавлены документы.
+ */
+void SearchServer::EnableDocumentStore(size_t block_size, size_t cache_blocks) {
+    if (!documents_.empty()) {
+        throw std::logic_error("Document store must be enabled before adding documents");
+    }
+    document_store_.Emplace(block_size, cache_blocks);
+}
+
+/**
+ * @brief Включает хранение последовательностей слов документов.
+ * @throws logic_error Если в поисковую систему уже добавлены документы.
+ */
+void SearchServer::EnableWordPositions() {
+    if (!documents_.empty()) {
+        throw std::logic_error("Word positions must be enabled before adding documents");
+    }
+    document_words_.Emplace();
+}
+
+/**
+ * @brief Строит фрагменты найденных документов с подсветкой плюс-слов запроса.
+ * @param raw_query Необработанный запрос.
+ * @param documents Документы, для которых нужно построить фрагменты.
+ * @param window_words Максимальное количество слов во фрагменте.
+ * @return Фрагменты в порядке переданных документов.
+ * @throws invalid_argument Если запрос содержит недопустимые символы.
+ * @throws logic_error Если хранилище текстов не включено.
+ */
+std::vector<Snippet> SearchServer::GetSnippets(const std::string& raw_query, const std::vector<Document>& documents,
+                                               size_t window_words) const {
+    if (!document_store_) {
+        throw std::logic_error("Document store is not enabled");
+    }
+    if (!IsValidWord(raw_query)) {
+        throw std::invalid_argument("Invalid word in GetSnippets function");
+    }
+
+    const Query query = ParseQuery(raw_query);
+    const std::set<std::string, std::less<>> words(query.plus_words.begin(), query.plus_words.end());
+    std::vector<Snippet> snippets;
+    snippets.reserve(documents.size());
+    for (const Document& document : documents) {
+        snippets.push_back(document_store_->MakeSnippet(document.id, words, window_words));
+    }
+    UpdateStoreCacheMetrics();
+    return snippets;
+}
+
+/**
+ * @brief Возвращает исходный текст документа из хранилища текстов.
+ * @param document_id Идентификатор документа.
+ * @return Текст документа.
+ * @throws logic_error Если хранилище текстов не включено.
+ * @throws out_of_range Если документ не найден.
+ */
+std::string SearchServer::GetDocumentText(int document_id) const {
+    if (!document_store_) {
+        throw std::logic_error("Document store is not enabled");
+    }
+    std::string text = document_store_->GetDocumentText(document_id);
+    UpdateStoreCacheMetrics();
+    return text;
+}
+
+/**
+ * @brief Возвращает статистику хранилища текстов.
+ * @return Статистика хранилища.
+ * @throws logic_error Если хранилище текстов не включено.
+ */
+DocumentStore::Stats SearchServer::GetDocumentStoreStats() const {
+    if (!document_store_) {
+        throw std::logic_error("Document store is not enabled");
+    }
+    return document_store_->GetStats();
+}
+
 /**
  * @brief Возвращает идентификатор документа по его индексу.
  * @param index Индекс документа.
  * @return Идентификатор документа.
  */
 int SearchServer::GetDocumentId(const int index) const {
-    return document_ids.at(index);
+    return document_ids->at(index);
+}
+
+/**
+ * @brief Возвращает итератор на первый идентификатор документа.
+ * @return Итератор начала последовательности идентификаторов.
+ */
+std::vector<int>::const_iterator SearchServer::begin() const {
+    return document_ids->begin();
+}
+
+/**
+ * @brief Возвращает итератор за последним идентификатором документа.
+ * @return Итератор конца последовательности идентификаторов.
+ */
+std::vector<int>::const_iterator SearchServer::end() const {
+    return document_ids->end();
+}
+
+/**
+ * @brief Возвращает колонку рейтингов документов.
+ * @return Диапазон рейтингов документов.
+ */
+IteratorRange<std::vector<int>::const_iterator> SearchServer::GetDocumentRatings() const {
+    return {document_ratings_->begin(), document_ratings_->end()};
+}
+
+/**
+ * @brief Возвращает колонку статусов документов.
+ * @return Диапазон статусов документов.
+ */
+IteratorRange<std::vector<DocumentStatus>::const_iterator> SearchServer::GetDocumentStatuses() const {
+    return {document_statuses_->begin(), document_statuses_->end()};
+}
+
+/**
+ * @brief Находит документы, содержащие фразу, с указанным статусом.
+ * @param raw_phrase Фраза.
+ * @param status Статус документа для поиска.
+ * @return Лучшие документы, отсортированные по релевантности слов фразы.
+ * @throws invalid_argument Если фраза содержит недопустимые символы или минус-слова.
+ * @throws logic_error Если хранение последовательностей слов не включено.
+ */
+std::vector<Document> SearchServer::FindTopDocumentsByPhrase(const std::string& raw_phrase, DocumentStatus status) const {
+    return FindTopDocumentsByPhrase(raw_phrase, MakeStatusPredicate(status));
+}
+
+/**
+ * @brief Находит документы, похожие на заданный, с указанным статусом.
+ * @param document_id Идентификатор исходного документа.
+ * @param count Количество документов.
+ * @param status Статус документа для поиска.
+ * @return Похожие документы; поле relevance содержит сходство.
+ * @throws out_of_range Если документ не найден.
+ */
+std::vector<Document> SearchServer::FindSimilarDocuments(int document_id, size_t count, DocumentStatus status) const {
+    return FindSimilarDocuments(document_id, count, MakeStatusPredicate(status));
+}
+
+/**
+ * @brief Строит индекс частых пар соседних слов.
+ * @param memory_budget Допустимый объём памяти индекса пар в байтах.
+ * @param min_pair_document_count Минимальное количество документов с парой.
+ * @return Количество пар в индексе.
+ * @throws logic_error Если хранение последовательностей слов не включено.
+ */
+size_t SearchServer::BuildShingleIndex(size_t memory_budget, size_t min_pair_document_count) {
+    if (!document_words_) {
+        throw std::logic_error("Word positions are not enabled");
+    }
+    using Shingle = std::pair<std::string_view, std::string_view>;
+
+    // Считаем, в скольких документах встречается каждая пара соседних слов
+    std::map<Shingle, std::vector<int>> pair_documents;
+    for (const auto& [document_id, words] : *document_words_) {
+        for (size_t i = 1; i < words.size(); ++i) {
+            std::vector<int>& documents = pair_documents[{words[i - 1], words[i]}];
+            if (documents.empty() || documents.back() != document_id) {
+                documents.push_back(document_id);
+            }
+        }
+    }
+
+    // Выигрыш пары - на сколько её список короче списка более редкого из двух слов
+    std::vector<std::pair<size_t, const Shingle*>> candidates;
+    for (const auto& [shingle, documents] : pair_documents) {
+        if (documents.size() < min_pair_document_count) {
+            continue;
+        }
+        const size_t rarest_word_freq = std::min(word_to_document_freqs_.at(shingle.first).size(),
+                                                 word_to_document_freqs_.at(shingle.second).size());
+        if (rarest_word_freq > documents.size()) {
+            candidates.emplace_back(rarest_word_freq - documents.size(), &shingle);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first > rhs.first;
+    });
+
+    // Узел std::map хранит ключ, значение и служебные поля красно-чёрного дерева
+    const size_t shingle_overhead = sizeof(std::pair<const Shingle, std::vector<int>>) + 4 * sizeof(void*);
+    std::map<Shingle, std::vector<int>> shingle_to_documents;
+    size_t used_memory = 0;
+    for (const auto& [gain, shingle] : candidates) {
+        std::vector<int>& documents = pair_documents.at(*shingle);
+        const size_t shingle_memory = shingle_overhead + documents.size() * sizeof(int);
+        if (used_memory + shingle_memory > memory_budget) {
+            continue;
+        }
+        used_memory += shingle_memory;
+        documents.shrink_to_fit();
+        shingle_to_documents.emplace(*shingle, std::move(documents));
+    }
+    shingle_to_documents_.Emplace(std::move(shingle_to_documents));
+    return shingle_to_documents_->size();
+}
+
+/**
+ * @brief Включает хранение векторных представлений документов.
+ * @param dimension Размерность векторов.
+ * @param quantize Хранить ли векторы квантованными в int8.
+ * @throws invalid_argument Если размерность равна нулю.
+ */
+void SearchServer::EnableVectorIndex(size_t dimension, bool quantize) {
+    vector_index_.Emplace(dimension, quantize);
+}
+
+/**
+ * @brief Задаёт векторное представление документа.
+ * @param document_id Идентификатор документа.
+ * @param embedding Вектор документа.
+ * @throws logic_error Если векторный индекс не включён.
+ * @throws out_of_range Если документ не найден.
+ * @throws invalid_argument Если размерность вектора не совпадает с размерностью индекса.
+ */
+void SearchServer::SetDocumentEmbedding(int document_id, const std::vector<float>& embedding) {
+    if (!vector_index_) {
+        throw std::logic_error("Vector index is not enabled");
+    }
+    if (documents_.count(document_id) == 0) {
+        throw std::out_of_range("Document not found in SetDocumentEmbedding function");
+    }
+    vector_index_.Mutable().Add(document_id, embedding);
+}
+
+/**
+ * @brief Строит приближённый векторный индекс (IVF) по заданным векторам.
+ * @param list_count Количество списков; 0 - корень из количества векторов.
+ * @throws logic_error Если векторный индекс не включён.
+ */
+void SearchServer::BuildVectorIndex(size_t list_count) {
+    if (!vector_index_) {
+        throw std::logic_error("Vector index is not enabled");
+    }
+    vector_index_.Mutable().Build(list_count);
+}
+
+/**
+ * @brief Гибридный поиск по запросу и вектору запроса с указанным статусом.
+ * @param raw_query Необработанный запрос.
+ * @param query_embedding Вектор запроса.
+ * @param options Параметры поиска.
+ * @param status Статус документа для поиска.
+ * @return Лучшие документы; поле relevance содержит оценку слияния.
+ * @throws invalid_argument Если запрос содержит недопустимые символы или размерность вектора неверна.
+ * @throws logic_error Если векторный индекс не включён.
+ */
+std::vector<Document> SearchServer::FindTopDocumentsHybrid(const std::string& raw_query,
+                                                           const std::vector<float>& query_embedding,
+                                                           const HybridOptions& options, DocumentStatus status) const {
+    return FindTopDocumentsHybrid(raw_query, query_embedding, options, MakeStatusPredicate(status));
+}
+
+/**
+ * @brief Строит индекс, упорядоченный по взвешенному рейтингу документов.
+ * @param rating_weight Вес рейтинга в оценке документа.
+ */
+void SearchServer::BuildStaticRankIndex(double rating_weight) {
+    BuildStaticRankIndex([rating_weight](int, int rating) {
+        return rating_weight * rating;
+    });
+}
+
+/**
+ * @brief Строит индекс, упорядоченный по заданной статической оценке документов.
+ * @param static_score Функция статической оценки документа по идентификатору и рейтингу.
+ */
+void SearchServer::BuildStaticRankIndex(StaticRankIndex::StaticScore static_score) {
+    std::map<int, int> document_ratings;
+    for (const auto& [document_id, document_info] : documents_) {
+        document_ratings.emplace_hint(document_ratings.end(), document_id, document_info.rating);
+    }
+    static_rank_index_.Emplace(std::move(static_score), document_ratings, word_to_document_freqs_);
+}
+
+/**
+ * @brief Поиск по сумме релевантности и статической оценки с указанным статусом.
+ * @param raw_query Необработанный запрос.
+ * @param status Статус документа для поиска.
+ * @return Лучшие документы; поле relevance содержит сумму релевантности и статической оценки.
+ * @throws invalid_argument Если запрос содержит недопустимые символы.
+ * @throws logic_error Если индекс по статической оценке не построен.
+ */
+std::vector<Document> SearchServer::FindTopDocumentsByStaticRank(const std::string& raw_query,
+                                                                 DocumentStatus status) const {
+    return FindTopDocumentsByStaticRank(raw_query, MakeStatusPredicate(status));
+}
+
+/**
+ * @brief Задаёт стоп-слова, применяемые при разборе запроса.
+ * @param stop_words_text Текст со стоп-словами.
+ * @throws invalid_argument Если какое-либо стоп-слово содержит недопустимые символы.
+ */
+void SearchServer::SetQueryStopWords(const std::string& stop_words_text) {
+    SetQueryStopWords(SplitIntoWords(stop_words_text));
+}
+
+/**
+ * @brief Задаёт долю документов, начиная с которой плюс-слово запроса считается стоп-словом.
+ * @param max_document_share Доля документов от 0 до 1.
+ * @throws invalid_argument Если доля вне диапазона [0, 1].
+ */
+void SearchServer::SetStopWordDocumentShare(double max_document_share) {
+    if (!(max_document_share >= 0.0 && max_document_share <= 1.0)) {
+        throw std::invalid_argument("Document share must be in [0, 1]");
+    }
+    auto query_stop_words = std::make_shared<QueryStopWords>(*std::atomic_load(&query_stop_words_));
+    query_stop_words->max_document_share = max_document_share;
+    std::atomic_store(&query_stop_words_, std::shared_ptr<const QueryStopWords>(std::move(query_stop_words)));
+}
+
+/**
+ * @brief Включает журнал медленных запросов FindTopDocuments.
+ * @param threshold Время запроса, начиная с которого он считается медленным.
+ * @param capacity Вместимость буфера записей; степень двойки.
+ * @throws invalid_argument Если вместимость не является степенью двойки.
+ */
+void SearchServer::EnableSlowQueryLog(std::chrono::microseconds threshold, size_t capacity) {
+    slow_query_log_ = std::make_shared<SlowQueryLog>(threshold, capacity);
+}
+
+/**
+ * @brief Выключает журнал медленных запросов; накопленные записи теряются.
+ */
+void SearchServer::DisableSlowQueryLog() {
+    slow_query_log_.reset();
+}
+
+/**
+ * @brief Забирает накопленные записи о медленных запросах.
+ * @return Записи в порядке сохранения; пустой вектор, если журнал выключен.
+ */
+std::vector<SlowQueryRecord> SearchServer::DrainSlowQueries() const {
+    return slow_query_log_ ? slow_query_log_->Drain() : std::vector<SlowQueryRecord>{};
+}
+
+/**
+ * @brief Возвращает количество записей о медленных запросах, не поместившихся в буфер.
+ * @return Количество отброшенных записей; 0, если журнал выключен.
+ */
+uint64_t SearchServer::GetDroppedSlowQueryCount() const {
+    return slow_query_log_ ? slow_query_log_->GetDroppedCount() : 0;
+}
+
+/**
+ * @brief Задаёт наблюдателя этапов для запросов, выполняемых в текущем потоке.
+ * @param observer Наблюдатель; nullptr отключает наблюдение.
+ */
+void SearchServer::SetQueryPhaseObserver(QueryPhaseObserver* observer) {
+    query_phase_observer_ = observer;
+}
+
+/**
+ * @brief Регистрирует метрики поисковой системы и начинает их обновлять.
+ * @param registry Реестр метрик.
+ * @throws invalid_argument Если метрики с такими именами уже зарегистрированы.
+ */
+void SearchServer::EnableMetrics(MetricsRegistry& registry) {
+    auto metrics = std::make_shared<ServerMetrics>();
+    metrics->documents_added = &registry.AddCounter("search_server_documents_added_total", "Documents added to the index");
+    metrics->documents = &registry.AddGauge("search_server_documents", "Documents in the index");
+    metrics->terms = &registry.AddGauge("search_server_terms", "Distinct words in the index");
+    metrics->postings = &registry.AddGauge("search_server_postings", "Postings in the inverted index");
+    metrics->store_cache_hits = &registry.AddCounter("search_server_document_store_cache_hits_total",
+                                                     "Document store block cache hits");
+    metrics->store_cache_misses = &registry.AddCounter("search_server_document_store_cache_misses_total",
+                                                       "Document store block cache misses");
+    metrics_ = std::move(metrics);
+    UpdateIndexMetrics();
+    UpdateStoreCacheMetrics();
+}
+
+/**
+ * @brief Включает теневое выполнение запросов альтернативным движком.
+ * @param shadow_executor Исполнитель теневых запросов; nullptr выключает теневое выполнение.
+ */
+void SearchServer::EnableShadowExecution(std::shared_ptr<ShadowExecutor> shadow_executor) {
+    shadow_executor_ = std::move(shadow_executor);
+}
+
+/**
+ * @brief Обновляет метрики размера индекса.
+ */
+void SearchServer::UpdateIndexMetrics() const {
+    if (!metrics_) {
+        return;
+    }
+    metrics_->documents->Set(documents_.size());
+    metrics_->terms->Set(word_to_document_freqs_.size());
+    metrics_->postings->Set(posting_count_);
+}
+
+/**
+ * @brief Обновляет метрики кеша хранилища текстов.
+ */
+void SearchServer::UpdateStoreCacheMetrics() const {
+    if (!metrics_ || !document_store_) {
+        return;
+    }
+    // Хранилище отдаёт накопленные итоги, а в счётчик добавляется прирост с прошлой выгрузки.
+    // Читатели выгружают итоги параллельно и в любом порядке, поэтому выгруженное значение только растёт
+    const auto export_total = [](Counter& counter, std::atomic<uint64_t>& exported, uint64_t total) {
+        uint64_t previous = exported.load(std::memory_order_relaxed);
+        while (total > previous && !exported.compare_exchange_weak(previous, total, std::memory_order_relaxed)) {
+        }
+        if (total > previous) {
+            counter.Add(total - previous);
+        }
+    };
+    const auto [hits, misses] = document_store_->GetCacheCounters();
+    export_total(*metrics_->store_cache_hits, metrics_->exported_store_cache_hits, hits);
+    export_total(*metrics_->store_cache_misses, metrics_->exported_store_cache_misses, misses);
+}
+
+/**
+ * @brief Считает словопозиции, просматриваемые запросом.
+ * @param query Разобранный запрос.
+ * @return Сумма длин списков словопозиций плюс- и минус-слов.
+ */
+size_t SearchServer::CountQueryPostings(const Query& query) const {
+    size_t postings = 0;
+    for (const auto* words : {&query.plus_words, &query.minus_words}) {
+        for (const std::string& word : *words) {
+            const auto it = word_to_document_freqs_.find(word);
+            if (it != word_to_document_freqs_.end()) {
+                postings += it->second.size();
+            }
+        }
+    }
+    return postings;
+}
+
+/**
+ * @brief Сохраняет запрос в журнал медленных запросов, если он выполнялся дольше порога.
+ * @param raw_query Необработанный запрос.
+ * @param query Разобранный запрос.
+ * @param candidate_count Количество документов, получивших релевантность.
+ * @param result_count Количество документов в результате.
+ * @param times Моменты окончания этапов.
+ */
+void SearchServer::RecordSlowQuery(const std::string& raw_query, const Query& query, size_t candidate_count,
+                                   size_t result_count, const QueryPhaseTimes& times) const {
+    const auto total_time = times.selected - times.start;
+    if (total_time < slow_query_log_->GetThreshold()) {
+        return;
+    }
+
+    SlowQueryRecord record;
+    record.raw_query = raw_query;
+    // Каждое слово запроса просматривает весь свой список словопозиций
+    const auto add_terms = [this, &record](const std::set<std::string>& words, bool is_minus) {
+        for (const std::string& word : words) {
+            const auto it = word_to_document_freqs_.find(word);
+            const size_t document_freq = it == word_to_document_freqs_.end() ? 0 : it->second.size();
+            record.terms.push_back({word, is_minus, document_freq});
+            record.postings_scanned += document_freq;
+        }
+    };
+    add_terms(query.plus_words, false);
+    add_terms(query.minus_words, true);
+    record.candidates_scored = candidate_count;
+    record.result_count = result_count;
+    record.parse_time = times.parsed - times.start;
+    record.score_time = times.scored - times.parsed;
+    record.select_time = times.selected - times.scored;
+    record.total_time = total_time;
+    slow_query_log_->Push(record);
+}
+
+/**
+ * @brief Разбирает фразу в последовательность ключей словаря.
+ * @param raw_phrase Фраза.
+ * @return Ключи словаря слов фразы; пустой вектор, если какого-либо слова нет в индексе.
+ * @throws invalid_argument Если фраза содержит недопустимые символы или минус-слова.
+ */
+std::vector<std::string_view> SearchServer::ParsePhrase(const std::string& raw_phrase) const {
+    if (!IsValidWord(raw_phrase)) {
+        throw std::invalid_argument("Invalid word in ParsePhrase function");
+    }
+
+    std::vector<std::string_view> phrase;
+    bool has_unknown_word = false;
+    for (const std::string& word : SplitIntoWords(raw_phrase)) {
+        if (word[0] == '-') {
+            throw std::invalid_argument("Minus words are not allowed in ParsePhrase function");
+        }
+        // Стоп-слова отсутствуют в последовательностях слов документов, поэтому пропускаются и во фразе
+        if (IsStopWord(word)) {
+            continue;
+        }
+        const auto it = word_to_document_freqs_.find(word);
+        if (it == word_to_document_freqs_.end()) {
+            has_unknown_word = true;
+            continue;
+        }
+        phrase.push_back(it->first);
+    }
+    if (has_unknown_word) {
+        phrase.clear();
+    }
+    return phrase;
+}
+
+/**
+ * @brief Находит документы, в которых слова фразы идут подряд.
+ * @param phrase Ключи словаря слов фразы.
+ * @return Отсортированные идентификаторы документов.
+ */
+std::vector<int> SearchServer::FindPhraseDocumentIds(const std::vector<std::string_view>& phrase) const {
+    // Выбираем самый короткий источник кандидатов: список слова или список пары из индекса пар
+    const CowMap<int, double>* word_candidates = nullptr;
+    for (const std::string_view word : phrase) {
+        const auto& word_documents = word_to_document_freqs_.at(word);
+        if (word_candidates == nullptr || word_documents.size() < word_candidates->size()) {
+            word_candidates = &word_documents;
+        }
+    }
+    const std::vector<int>* shingle_candidates = nullptr;
+    for (size_t i = 1; i < phrase.size(); ++i) {
+        const auto it = shingle_to_documents_->find({phrase[i - 1], phrase[i]});
+        if (it != shingle_to_documents_->end()
+            && (shingle_candidates == nullptr || it->second.size() < shingle_candidates->size())) {
+            shingle_candidates = &it->second;
+        }
+    }
+
+    std::vector<int> candidates;
+    if (shingle_candidates != nullptr && shingle_candidates->size() <= word_candidates->size()) {
+        candidates = *shingle_candidates;
+    } else {
+        for (const auto& [document_id, _] : *word_candidates) {
+            candidates.push_back(document_id);
+        }
+    }
+    if (phrase.size() == 1) {
+        return candidates;
+    }
+
+    // Проверяем, что слова идут подряд; ключи словаря уникальны, поэтому сравниваем их по адресу
+    std::vector<int> document_ids;
+    for (const int document_id : candidates) {
+        const std::vector<std::string_view>& words = document_words_->at(document_id);
+        for (size_t first = 0; first + phrase.size() <= words.size(); ++first) {
+            size_t matched = 0;
+            while (matched < phrase.size() && words[first + matched].data() == phrase[matched].data()) {
+                ++matched;
+            }
+            if (matched == phrase.size()) {
+                document_ids.push_back(document_id);
+                break;
+            }
+        }
+    }
+    return document_ids;
+}
+
+/**
+ * @brief Удаляет документ из индексов, таблицы документов, хранилища и векторного индекса.
+ * @details Колонки документов не изменяются: см. EraseDocumentColumns.
+ * @param document_id Идентификатор существующего документа.
+ */
+void SearchServer::EraseDocument(int document_id) {
+    SEARCH_TRACE(remove__document, document_id);
+
+    if (document_words_) {
+        EraseDocumentWords(document_id);
+    }
+
+    const std::map<std::string_view, double>& word_freqs = *document_to_word_freqs_.at(document_id);
+    posting_count_ -= word_freqs.size();
+    for (const auto& [word, _] : word_freqs) {
+        if (word_to_document_freqs_.at(word).size() == 1) {
+            word_to_document_freqs_.Erase(word);
+        } else {
+            word_to_document_freqs_.Mutable(word).second.Erase(document_id);
+        }
+    }
+    document_to_word_freqs_.Erase(document_id);
+
+    // Срок жизни документа снимается, чтобы очередь удаления не удалила новый документ с тем же идентификатором
+    const std::chrono::system_clock::time_point expires_at = documents_.at(document_id).expires_at;
+    if (expiry_queue_->count({expires_at, document_id})) {
+        expiry_queue_.Mutable().erase({expires_at, document_id});
+    } else if (expired_documents_->count(document_id)) {
+        expired_documents_.Mutable().erase(document_id);
+    }
+    documents_.Erase(document_id);
+
+    if (document_store_) {
+        document_store_.Mutable().RemoveDocument(document_id);
+    }
+    if (vector_index_) {
+        vector_index_.Mutable().Remove(document_id);
+    }
+    if (static_rank_index_) {
+        static_rank_index_.Mutable().Remove(document_id);
+    }
+}
+
+/**
+ * @brief Удаляет последовательность слов документа и документ из списков индекса пар.
+ * @param document_id Идентификатор документа с сохранённой последовательностью слов.
+ */
+void SearchServer::EraseDocumentWords(int document_id) {
+    // Пары удаляются до слов документа: список слов нужен для поиска пар
+    auto& document_words = document_words_.Mutable();
+    const auto document_words_it = document_words.find(document_id);
+    const std::vector<std::string_view>& words = document_words_it->second;
+    if (!shingle_to_documents_->empty()) {
+        auto& shingle_to_documents = shingle_to_documents_.Mutable();
+        for (size_t i = 1; i < words.size(); ++i) {
+            const auto it = shingle_to_documents.find({words[i - 1], words[i]});
+            if (it == shingle_to_documents.end()) {
+                continue;
+            }
+            std::vector<int>& shingle_documents = it->second;
+            const auto position = std::lower_bound(shingle_documents.begin(), shingle_documents.end(), document_id);
+            if (position != shingle_documents.end() && *position == document_id) {
+                shingle_documents.erase(position);
+            }
+            if (shingle_documents.empty()) {
+                shingle_to_documents.erase(it);
+            }
+        }
+    }
+    document_words.erase(document_words_it);
+}
+
+/**
+ * @brief Удаляет документы из колонок идентификаторов, рейтингов и статусов за один проход.
+ * @details Позиции сдвинутых документов в document_columns_ обновляются тем же проходом.
+ * @param document_ids_to_erase Идентификаторы удаляемых документов.
+ */
+void SearchServer::EraseDocumentColumns(const std::set<int>& document_ids_to_erase) {
+    std::vector<int>& ids = document_ids.Mutable();
+    std::vector<int>& ratings = document_ratings_.Mutable();
+    std::vector<DocumentStatus>& statuses = document_statuses_.Mutable();
+    size_t kept = 0;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        if (document_ids_to_erase.count(ids[i])) {
+            document_columns_.Erase(ids[i]);
+            continue;
+        }
+        if (kept != i) {
+            document_columns_.Mutable(ids[i]).second = kept;
+        }
+        ids[kept] = ids[i];
+        ratings[kept] = ratings[i];
+        statuses[kept] = statuses[i];
+        ++kept;
+    }
+    ids.resize(kept);
+    ratings.resize(kept);
+    statuses.resize(kept);
 }
 
 /**
@@ -106,7 +1110,7 @@ int SearchServer::GetDocumentId(const int index) const {
  * @return true, если слово является стоп-словом, иначе false.
  */
 bool SearchServer::IsStopWord(const std::string& word) const {
-    return stop_words_.count(word) > 0;
+    return stop_words_->count(word) > 0;
 }
 
 /**
@@ -137,13 +1141,35 @@ int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
     return std::accumulate(ratings.begin(), ratings.end(), 0) / static_cast<int>(ratings.size());
 }
 
+/**
+ * @brief Отбирает лучшие документы по релевантности, затем по рейтингу.
+ * @param documents Оценённые документы; при равенстве ключей выше стоит документ с меньшим индексом.
+ * @param count Наибольшее количество документов в результате.
+ * @return Не более count лучших документов по убыванию оценки.
+ */
+std::vector<Document> SearchServer::SelectTopDocuments(std::vector<Document> documents, size_t count) {
+    std::vector<RankedCandidate> ranked(documents.size());
+    for (size_t i = 0; i < documents.size(); ++i) {
+        ranked[i] = {MakeRankKey(documents[i].relevance, documents[i].rating), static_cast<uint32_t>(i)};
+    }
+    SelectTopCandidates(ranked, count);
+
+    std::vector<Document> top_documents;
+    top_documents.reserve(ranked.size());
+    for (const RankedCandidate& candidate : ranked) {
+        top_documents.push_back(documents[candidate.index]);
+    }
+    return top_documents;
+}
+
 /**
  * @brief Разбирает слово запроса и определяет, является ли оно минус-словом или стоп-словом.
  * @param text Текст слова запроса.
+ * @param query_stop_words Стоп-слова запроса.
  * @return Структура QueryWord с информацией о слове.
  * @throws invalid_argument Если слово содержит недопустимые символы или имеет неверный формат минус-слова.
  */
-SearchServer::QueryWord SearchServer::ParseQueryWord(std::string text) const {
+SearchServer::QueryWord SearchServer::ParseQueryWord(std::string text, const QueryStopWords& query_stop_words) const {
     QueryWord result;
     bool is_minus = false;
 
@@ -160,18 +1186,23 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(std::string text) const {
         throw std::invalid_argument("Invalid minus word in ParseQueryWord function");
     }
 
-    return { text, is_minus, IsStopWord(text) };
+    const bool is_stop = IsStopWord(text) || query_stop_words.words.count(text) > 0;
+    return { text, is_minus, is_stop };
 }
 
 /**
  * @brief Разбирает текст запроса и формирует структуру Query с плюс-словами и минус-словами.
  * @param text Текст поискового запроса.
+ * @param skip_frequent_words Пропускать ли слишком частые плюс-слова (см. SetStopWordDocumentShare).
  * @return Структура Query с плюс-словами и минус-словами.
  */
-SearchServer::Query SearchServer::ParseQuery(const std::string& text) const {
+SearchServer::Query SearchServer::ParseQuery(const std::string& text, bool skip_frequent_words) const {
+    // Один снимок настроек на весь запрос, даже если они заменяются параллельно
+    const std::shared_ptr<const QueryStopWords> query_stop_words = std::atomic_load(&query_stop_words_);
+
     Query query;
     for (const std::string& word : SplitIntoWords(text)) {
-        const QueryWord query_word = ParseQueryWord(word);
+        const QueryWord query_word = ParseQueryWord(word, *query_stop_words);
         if (!query_word.is_stop) {
             if (query_word.is_minus) {
                 query.minus_words.insert(query_word.data);
@@ -180,6 +1211,25 @@ SearchServer::Query SearchServer::ParseQuery(const std::string& text) const {
             }
         }
     }
+    if (!skip_frequent_words) {
+        return query;
+    }
+
+    // Если частыми оказались все плюс-слова, запрос оставляется как есть: иначе он ничего бы не нашёл
+    const double max_document_freq = query_stop_words->max_document_share * GetDocumentCount();
+    std::set<std::string> frequent_words;
+    for (const std::string& word : query.plus_words) {
+        const auto it = word_to_document_freqs_.find(word);
+        if (it != word_to_document_freqs_.end() && it->second.size() > max_document_freq) {
+            frequent_words.insert(word);
+        }
+    }
+    if (frequent_words.size() < query.plus_words.size()) {
+        for (const std::string& word : frequent_words) {
+            query.plus_words.erase(word);
+        }
+        query.frequent_words = std::move(frequent_words);
+    }
     return query;
 }
 
@@ -188,7 +1238,7 @@ SearchServer::Query SearchServer::ParseQuery(const std::string& text) const {
  * @param word Слово для вычисления.
  * @return Значение IDF (inverse document frequency).
  */
-double SearchServer::ComputeWordInverseDocumentFreq(const std::string& word) const {
+double SearchServer::ComputeWordInverseDocumentFreq(std::string_view word) const {
     return std::log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
 }
 
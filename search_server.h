@@ -1,25 +1,99 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <exception>
+#include <execution>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <numeric>
+#include <optional>
 #include <set>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <tuple>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "cow_shared.h"
 #include "document.h"
+#include "document_store.h"
+#include "metrics.h"
+#include "paginator.h"
+#include "ranking.h"
+#include "reranking.h"
 #include "read_input_functions.h"
+#include "shadow_executor.h"
+#include "slow_query_log.h"
+#include "static_rank_index.h"
 #include "string_processing.h"
+#include "term_dictionary.h"
+#include "tracing.h"
+#include "vector_index.h"
+
+/**
+ * @brief Количество слов документа с наибольшим весом TF-IDF, используемых при поиске похожих документов.
+ */
+const size_t SIMILAR_QUERY_TERM_COUNT = 25;
+
+/**
+ * @brief Количество документов с истёкшим сроком жизни, удаляемых за один вызов PurgeExpiredDocuments по умолчанию.
+ * @details Столько же документов должно ожидать удаления, чтобы AddDocument удалил пачку сам.
+ */
+const size_t EXPIRED_PURGE_BATCH_SIZE = 1024;
 
 /**
  * @brief Класс SearchServer для поисковой системы.
  */
 class SearchServer {
 public:
+    /**
+     * @brief Результат сопоставления запроса с одним документом.
+     */
+    struct DocumentMatch {
+        std::vector<bool> matched_words;  ///< i-й бит установлен, если документ содержит i-е плюс-слово запроса.
+        DocumentStatus status;            ///< Статус документа.
+    };
+
+    /**
+     * @brief Вклад одного плюс-слова в релевантность документа.
+     */
+    struct TermExplanation {
+        std::string word;                     ///< Плюс-слово запроса.
+        double term_freq = 0.0;               ///< Частота слова в документе (TF).
+        size_t document_freq = 0;             ///< Количество документов, содержащих слово (DF).
+        double inverse_document_freq = 0.0;   ///< Обратная частота документа (IDF).
+        double contribution = 0.0;            ///< Вклад слова в релевантность (TF * IDF).
+    };
+
+    /**
+     * @brief Объяснение релевантности документа для запроса.
+     */
+    struct ScoreExplanation {
+        int document_id = 0;                            ///< Идентификатор документа.
+        std::vector<TermExplanation> terms;             ///< Совпавшие плюс-слова и их вклад.
+        std::vector<std::string> excluding_minus_words; ///< Минус-слова, исключившие документ.
+        std::vector<std::string> skipped_words;         ///< Плюс-слова, пропущенные как слишком частые (см. SetStopWordDocumentShare).
+        bool excluded_by_predicate = false;             ///< Исключён ли документ предикатом или истечением срока жизни.
+        bool is_found = false;                          ///< Попадает ли документ в результаты FindAllDocuments.
+        double relevance = 0.0;                         ///< Итоговая релевантность документа.
+        int rating = 0;                                 ///< Рейтинг, сравниваемый при равной релевантности.
+    };
+
+    /**
+     * @brief Результат сопоставления одного запроса с набором документов.
+     */
+    struct QueryMatches {
+        std::vector<std::string> words;        ///< Плюс-слова запроса в порядке битов масок.
+        std::vector<DocumentMatch> documents;  ///< Результаты в порядке переданных идентификаторов.
+    };
+
     /**
      * @brief Конструктор класса SearchServer.
      * @tparam StringContainer Тип контейнера со строками (например, std::vector<std::string>).
@@ -36,6 +110,17 @@ public:
     explicit SearchServer(const std::string& stop_words_text)
             : SearchServer(SplitIntoWords(stop_words_text)) {}
 
+    /**
+     * @brief Копирует поисковую систему.
+     * @details Индексы хранят string_view на слова словаря, а не на ключи других индексов. Словарь
+     *          разделяется копиями и живёт, пока жива хотя бы одна из них, поэтому копия остаётся
+     *          действительной после уничтожения или изменения исходной системы.
+     */
+    SearchServer(const SearchServer&) = default;
+    SearchServer(SearchServer&&) = default;
+    SearchServer& operator=(const SearchServer&) = default;
+    SearchServer& operator=(SearchServer&&) = default;
+
     // Методы поисковой системы
 
     /**
@@ -50,6 +135,82 @@ public:
     void AddDocument(int document_id, const std::string& document, DocumentStatus status,
                      const std::vector<int>& ratings);
 
+    /**
+     * @brief Удаляет документ из поисковой системы.
+     * @details Документ удаляется из индексов, индекса пар, хранилища текстов и векторного индекса.
+     *          Слова, не встречающиеся больше ни в одном документе, удаляются из обратного индекса.
+     *          Удаление отсутствующего документа ничего не делает.
+     * @param document_id Идентификатор документа.
+     */
+    void RemoveDocument(int document_id);
+
+    /**
+     * @brief Добавляет в поисковую систему документ с ограниченным сроком жизни.
+     * @details Начиная с expires_at, документ не попадает в результаты поиска: каждый запрос один раз
+     *          читает часы и сравнивает с ними срок жизни кандидатов вместе с предикатом. Из индексов
+     *          документ удаляется позже, пачкой, см. ExpireDocuments и PurgeExpiredDocuments.
+     * @param document_id Уникальный идентификатор документа.
+     * @param document Текст документа.
+     * @param status Статус документа.
+     * @param ratings Вектор рейтингов документа.
+     * @param expires_at Момент истечения срока жизни.
+     * @throws invalid_argument Если document_id меньше нуля или уже существует,
+     *                           или если document содержит недопустимые символы.
+     */
+    void AddDocument(int document_id, const std::string& document, DocumentStatus status,
+                     const std::vector<int>& ratings, std::chrono::system_clock::time_point expires_at);
+
+    /**
+     * @brief Ставит в очередь удаления документы, срок жизни которых истёк.
+     * @details Просматривает только истёкшие записи индекса сроков и не изменяет таблицу документов:
+     *          скрывать документы не нужно, это делает проверка срока при поиске. До удаления
+     *          документы с истёкшим сроком учитываются в GetDocumentCount и IDF, а MatchDocument и
+     *          GetDocumentText их находят. AddDocument вызывает этот метод сам; отдельный вызов нужен,
+     *          только чтобы удалить документы без добавления новых.
+     * @param now Текущий момент.
+     * @return Количество документов, поставленных в очередь.
+     */
+    size_t ExpireDocuments(std::chrono::system_clock::time_point now = std::chrono::system_clock::now());
+
+    /**
+     * @brief Удаляет из индексов пачку документов с истёкшим сроком жизни из очереди удаления.
+     * @details Документы удаляются по прямому индексу, как RemoveDocument, а колонки документов
+     *          сжимаются один раз на пачку. Затем освобождаются блоки хранилища текстов, в которых
+     *          удалено больше половины данных, и, если словарь не разделяется копиями и вырос вдвое с
+     *          прошлой очистки, слова, не встречающиеся в документах. Размер пачки ограничивает время,
+     *          на которое поисковая система занята изменением. AddDocument удаляет пачку сам, когда
+     *          очередь достигает EXPIRED_PURGE_BATCH_SIZE документов.
+     * @param max_count Максимальное количество удаляемых документов.
+     * @return Количество удалённых документов.
+     */
+    size_t PurgeExpiredDocuments(size_t max_count = EXPIRED_PURGE_BATCH_SIZE);
+
+    /**
+     * @brief Возвращает количество документов в очереди удаления.
+     * @return Количество документов.
+     */
+    size_t GetExpiredDocumentCount() const;
+
+    /**
+     * @brief Изменяет статус документа.
+     * @param document_id Идентификатор документа.
+     * @param status Новый статус.
+     * @throws out_of_range Если документ не найден.
+     */
+    void SetDocumentStatus(int document_id, DocumentStatus status);
+
+    /**
+     * @brief Создаёт копию поисковой системы для экспериментов.
+     * @details Копия разделяет с исходной системой индексы, таблицы документов, хранилище текстов,
+     *          векторный индекс и словарь слов. Индексы и таблицы документов разбиты на сегменты
+     *          до 128 записей; изменение копирует только затронутые сегменты и их каталоги, поэтому
+     *          первая запись после клонирования не копирует индекс целиком. Смена стоп-слов запроса
+     *          не копирует ничего. Журнал медленных запросов, метрики и теневое выполнение в копию
+     *          не переносятся.
+     * @return Копия.
+     */
+    SearchServer Clone() const;
+
     /**
      * @brief Поиск топовых документов по запросу с указанным статусом.
      * @param raw_query Необработанный запрос.
@@ -70,6 +231,97 @@ public:
     template<typename predicate>
     std::vector<Document> FindTopDocuments(const std::string& raw_query, predicate predict) const;
 
+    /**
+     * @brief Находит большое количество лучших документов для последующего переранжирования.
+     * @param raw_query Необработанный запрос.
+     * @param count Количество документов, которое нужно найти (например, 1000-10000).
+     * @param result Буфер, в который записываются документы от лучшего к худшему; прежнее содержимое удаляется.
+     * @param status Статус документа для поиска (по умолчанию DocumentStatus::ACTUAL).
+     * @throws invalid_argument Если запрос содержит недопустимые символы.
+     */
+    void FindTopCandidates(const std::string& raw_query, size_t count, DocumentColumns& result,
+                           DocumentStatus status = DocumentStatus::ACTUAL) const;
+
+    /**
+     * @brief Находит большое количество лучших документов с заданным предикатом.
+     * @details В отличие от FindTopDocuments, количество результатов не ограничено MAX_RESULT_DOCUMENT_COUNT,
+     *          промежуточный вектор Document не создаётся, а полностью сортируются только отобранные документы.
+     * @tparam predicate Тип предиката для фильтрации документов.
+     * @param raw_query Необработанный запрос.
+     * @param count Количество документов, которое нужно найти.
+     * @param result Буфер, в который записываются документы от лучшего к худшему; прежнее содержимое удаляется.
+     * @param predict Предикат для фильтрации документов.
+     * @throws invalid_argument Если запрос содержит недопустимые символы.
+     */
+    template<typename predicate>
+    void FindTopCandidates(const std::string& raw_query, size_t count, DocumentColumns& result,
+                           predicate predict) const;
+
+    /**
+     * @brief Двухэтапный поиск с пользовательской функцией переранжирования.
+     * @details На первом этапе выбираются options.candidate_count лучших документов по TF-IDF.
+     *          Затем для них параллельно извлекаются признаки (частоты слов запроса, близость слов
+     *          запроса в тексте, рейтинг), и функция reranker параллельно вычисляет итоговую оценку.
+     *          Кандидаты переранжируются пачками по options.batch_size, и бюджет времени проверяется
+     *          перед каждой пачкой: если он исчерпан, возвращаются результаты первого этапа.
+     *          Близость слов считается, только если включено хранение последовательностей слов
+     *          (см. EnableWordPositions); иначе она равна нулю. Если reranker выбросил исключение,
+     *          первое из них выбрасывается после завершения параллельного этапа.
+     * @tparam Reranker Тип функции double(const RerankFeatures&); должна быть безопасна для параллельного вызова.
+     * @tparam predicate Тип предиката для фильтрации документов.
+     * @param raw_query Необработанный запрос.
+     * @param options Параметры поиска.
+     * @param reranker Функция переранжирования.
+     * @param predict Предикат для фильтрации документов.
+     * @return Документы от лучшего к худшему; поле relevance содержит оценку reranker.
+     * @throws invalid_argument Если запрос содержит недопустимые символы.
+     */
+    template<typename Reranker, typename predicate>
+    std::vector<Document> FindTopDocumentsReranked(const std::string& raw_query, const RerankOptions& options,
+                                                   Reranker reranker, predicate predict) const;
+
+    /**
+     * @brief Двухэтапный поиск с пользовательской функцией переранжирования по статусу документа.
+     * @tparam Reranker Тип функции double(const RerankFeatures&).
+     * @param raw_query Необработанный запрос.
+     * @param options Параметры поиска.
+     * @param reranker Функция переранжирования.
+     * @param status Статус документа для поиска (по умолчанию DocumentStatus::ACTUAL).
+     * @return Документы от лучшего к худшему; поле relevance содержит оценку reranker.
+     * @throws invalid_argument Если запрос содержит недопустимые символы.
+     */
+    template<typename Reranker>
+    std::vector<Document> FindTopDocumentsReranked(const std::string& raw_query, const RerankOptions& options,
+                                                   Reranker reranker,
+                                                   DocumentStatus status = DocumentStatus::ACTUAL) const;
+
+    /**
+     * @brief Объясняет релевантность документа для запроса с указанным статусом.
+     * @param raw_query Необработанный запрос.
+     * @param document_id Идентификатор документа.
+     * @param status Статус документа для поиска (по умолчанию DocumentStatus::ACTUAL).
+     * @return Вклад каждого плюс-слова, исключившие документ минус-слова и итоговая релевантность.
+     * @throws invalid_argument Если запрос содержит недопустимые символы.
+     * @throws out_of_range Если документ не найден.
+     */
+    ScoreExplanation ExplainScore(const std::string& raw_query, int document_id,
+                                  DocumentStatus status = DocumentStatus::ACTUAL) const;
+
+    /**
+     * @brief Объясняет релевантность документа для запроса с заданным предикатом.
+     * @details Использует те же вычисления IDF и вклада слова, что и ComputeDocumentRelevance, поэтому
+     *          итоговая релевантность совпадает с релевантностью в результатах поиска.
+     * @tparam predicate Тип предиката для фильтрации документов.
+     * @param raw_query Необработанный запрос.
+     * @param document_id Идентификатор документа.
+     * @param predict Предикат для фильтрации документов.
+     * @return Вклад каждого плюс-слова, исключившие документ минус-слова и итоговая релевантность.
+     * @throws invalid_argument Если запрос содержит недопустимые символы.
+     * @throws out_of_range Если документ не найден.
+     */
+    template<typename predicate>
+    ScoreExplanation ExplainScore(const std::string& raw_query, int document_id, predicate predict) const;
+
     /**
      * @brief Возвращает количество документов в поисковой системе.
      * @return Количество документов.
@@ -85,6 +337,67 @@ public:
      */
     std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(const std::string& raw_query, int document_id) const;
 
+    /**
+     * @brief Сопоставляет один запрос с набором документов.
+     * @details Запрос разбирается один раз, слова запроса один раз разрешаются в словаре индекса,
+     *          после чего документы проверяются параллельно по прямому индексу. Если документ
+     *          содержит минус-слово, все биты его маски сброшены.
+     * @param raw_query Необработанный запрос.
+     * @param document_ids Идентификаторы документов.
+     * @return Плюс-слова запроса и маски совпадений для каждого документа.
+     * @throws invalid_argument Если запрос содержит недопустимые символы.
+     * @throws out_of_range Если какой-либо документ не найден.
+     */
+    QueryMatches MatchDocuments(const std::string& raw_query, const std::vector<int>& document_ids) const;
+
+    /**
+     * @brief Включает хранение сжатых исходных текстов документов.
+     * @details Тексты хранятся в блоках, сжатых LZ-кодеком, вместе со смещениями слов, что позволяет
+     *          строить фрагменты результатов с подсветкой, распаковывая один блок на документ.
+     * @param block_size Размер несжатого блока хранилища.
+     * @param cache_blocks Количество распакованных блоков, хранимых в кеше.
+     * @throws logic_error Если в поисковую систему уже добавлены документы.
+     */
+    void EnableDocumentStore(size_t block_size = DocumentStore::DEFAULT_BLOCK_SIZE,
+                             size_t cache_blocks = DocumentStore::DEFAULT_CACHE_BLOCKS);
+
+    /**
+     * @brief Включает хранение последовательностей слов документов.
+     * @details Последовательности нужны для поиска по фразе, индекса пар и близости слов запроса при
+     *          переранжировании. Они занимают 16 байт на каждое слово документа, поэтому по умолчанию
+     *          не хранятся.
+     * @throws logic_error Если в поисковую систему уже добавлены документы.
+     */
+    void EnableWordPositions();
+
+    /**
+     * @brief Строит фрагменты найденных документов с подсветкой плюс-слов запроса.
+     * @param raw_query Необработанный запрос.
+     * @param documents Документы, для которых нужно построить фрагменты.
+     * @param window_words Максимальное количество слов во фрагменте.
+     * @return Фрагменты в порядке переданных документов.
+     * @throws invalid_argument Если запрос содержит недопустимые символы.
+     * @throws logic_error Если хранилище текстов не включено.
+     */
+    std::vector<Snippet> GetSnippets(const std::string& raw_query, const std::vector<Document>& documents,
+                                     size_t window_words = SNIPPET_WORD_COUNT) const;
+
+    /**
+     * @brief Возвращает исходный текст документа из хранилища текстов.
+     * @param document_id Идентификатор документа.
+     * @return Текст документа.
+     * @throws logic_error Если хранилище текстов не включено.
+     * @throws out_of_range Если документ не найден.
+     */
+    std::string GetDocumentText(int document_id) const;
+
+    /**
+     * @brief Возвращает статистику хранилища текстов.
+     * @return Статистика хранилища.
+     * @throws logic_error Если хранилище текстов не включено.
+     */
+    DocumentStore::Stats GetDocumentStoreStats() const;
+
     /**
      * @brief Возвращает идентификатор документа по его индексу.
      * @param index Индекс документа.
@@ -92,16 +405,406 @@ public:
      */
     int GetDocumentId(const int index) const;
 
+    /**
+     * @brief Возвращает итератор на первый идентификатор документа.
+     * @details Идентификаторы хранятся в непрерывном массиве в порядке добавления документов.
+     *          Итераторы остаются действительными до следующего вызова AddDocument или RemoveDocument.
+     * @return Итератор начала последовательности идентификаторов.
+     */
+    std::vector<int>::const_iterator begin() const;
+
+    /**
+     * @brief Возвращает итератор за последним идентификатором документа.
+     * @return Итератор конца последовательности идентификаторов.
+     */
+    std::vector<int>::const_iterator end() const;
+
+    /**
+     * @brief Возвращает колонку рейтингов документов.
+     * @details i-й элемент соответствует i-му идентификатору из диапазона [begin(), end()).
+     * @return Диапазон рейтингов документов.
+     */
+    IteratorRange<std::vector<int>::const_iterator> GetDocumentRatings() const;
+
+    /**
+     * @brief Возвращает колонку статусов документов.
+     * @details i-й элемент соответствует i-му идентификатору из диапазона [begin(), end()).
+     * @return Диапазон статусов документов.
+     */
+    IteratorRange<std::vector<DocumentStatus>::const_iterator> GetDocumentStatuses() const;
+
+    /**
+     * @brief Находит документы, содержащие фразу, с указанным статусом.
+     * @param raw_phrase Фраза: слова, которые должны идти в документе подряд (стоп-слова пропускаются).
+     * @param status Статус документа для поиска (по умолчанию DocumentStatus::ACTUAL).
+     * @return Лучшие документы, отсортированные по релевантности слов фразы.
+     * @throws invalid_argument Если фраза содержит недопустимые символы или минус-слова.
+     * @throws logic_error Если хранение последовательностей слов не включено (см. EnableWordPositions).
+     */
+    std::vector<Document> FindTopDocumentsByPhrase(const std::string& raw_phrase,
+                                                   DocumentStatus status = DocumentStatus::ACTUAL) const;
+
+    /**
+     * @brief Находит документы, содержащие фразу, с заданным предикатом.
+     * @details Кандидаты берутся из самого короткого списка среди списков слов фразы и списков
+     *          пар соседних слов из индекса пар (см. BuildShingleIndex), затем проверяются по
+     *          последовательности слов документа.
+     * @tparam predicate Тип предиката для фильтрации документов.
+     * @param raw_phrase Фраза.
+     * @param predict Предикат для фильтрации документов.
+     * @return Лучшие документы, отсортированные по релевантности слов фразы.
+     * @throws invalid_argument Если фраза содержит недопустимые символы или минус-слова.
+     * @throws logic_error Если хранение последовательностей слов не включено (см. EnableWordPositions).
+     */
+    template<typename predicate>
+    std::vector<Document> FindTopDocumentsByPhrase(const std::string& raw_phrase, predicate predict) const;
+
+    /**
+     * @brief Находит документы, похожие на заданный, с указанным статусом.
+     * @param document_id Идентификатор исходного документа.
+     * @param count Количество документов.
+     * @param status Статус документа для поиска (по умолчанию DocumentStatus::ACTUAL).
+     * @return Похожие документы; поле relevance содержит сходство.
+     * @throws out_of_range Если документ не найден.
+     */
+    std::vector<Document> FindSimilarDocuments(int document_id, size_t count = MAX_RESULT_DOCUMENT_COUNT,
+                                               DocumentStatus status = DocumentStatus::ACTUAL) const;
+
+    /**
+     * @brief Находит документы, похожие на заданный, с заданным предикатом.
+     * @details Слова исходного документа из прямого индекса взвешиваются по TF-IDF, и
+     *          SIMILAR_QUERY_TERM_COUNT слов с наибольшим весом используются как взвешенный запрос.
+     *          Сходство - скалярное произведение TF-IDF векторов по этим словам. Исходный документ
+     *          в результат не попадает.
+     * @tparam predicate Тип предиката для фильтрации документов.
+     * @param document_id Идентификатор исходного документа.
+     * @param count Количество документов.
+     * @param predict Предикат для фильтрации документов.
+     * @return Похожие документы; поле relevance содержит сходство.
+     * @throws out_of_range Если документ не найден.
+     */
+    template<typename predicate>
+    std::vector<Document> FindSimilarDocuments(int document_id, size_t count, predicate predict) const;
+
+    /**
+     * @brief Строит индекс частых пар соседних слов.
+     * @details Для каждой пары соседних слов, встретившейся хотя бы в min_pair_document_count документах,
+     *          оценивается выигрыш от её списка документов: насколько он короче списка более редкого
+     *          из двух слов. Пары добавляются в порядке убывания выигрыша, пока оценка занимаемой
+     *          памяти не превысит memory_budget. Документы, добавленные позже, попадают в списки уже
+     *          выбранных пар. Повторный вызов перестраивает индекс.
+     * @param memory_budget Допустимый объём памяти индекса пар в байтах.
+     * @param min_pair_document_count Минимальное количество документов с парой.
+     * @return Количество пар в индексе.
+     * @throws logic_error Если хранение последовательностей слов не включено (см. EnableWordPositions).
+     */
+    size_t BuildShingleIndex(size_t memory_budget, size_t min_pair_document_count = 2);
+
+    /**
+     * @brief Включает хранение векторных представлений документов.
+     * @param dimension Размерность векторов.
+     * @param quantize Хранить ли векторы квантованными в int8 (в 4 раза меньше памяти).
+     * @throws invalid_argument Если размерность равна нулю.
+     */
+    void EnableVectorIndex(size_t dimension, bool quantize = false);
+
+    /**
+     * @brief Задаёт векторное представление документа.
+     * @param document_id Идентификатор документа.
+     * @param embedding Вектор документа.
+     * @throws logic_error Если векторный индекс не включён.
+     * @throws out_of_range Если документ не найден.
+     * @throws invalid_argument Если размерность вектора не совпадает с размерностью индекса.
+     */
+    void SetDocumentEmbedding(int document_id, const std::vector<float>& embedding);
+
+    /**
+     * @brief Строит приближённый векторный индекс (IVF) по заданным векторам.
+     * @details До вызова векторный поиск просматривает все векторы.
+     * @param list_count Количество списков; 0 - корень из количества векторов.
+     * @throws logic_error Если векторный индекс не включён.
+     */
+    void BuildVectorIndex(size_t list_count = 0);
+
+    /**
+     * @brief Гибридный поиск по запросу и вектору запроса с указанным статусом.
+     * @param raw_query Необработанный запрос.
+     * @param query_embedding Вектор запроса.
+     * @param options Параметры поиска.
+     * @param status Статус документа для поиска (по умолчанию DocumentStatus::ACTUAL).
+     * @return Лучшие документы; поле relevance содержит оценку слияния.
+     * @throws invalid_argument Если запрос содержит недопустимые символы или размерность вектора неверна.
+     * @throws logic_error Если векторный индекс не включён.
+     */
+    std::vector<Document> FindTopDocumentsHybrid(const std::string& raw_query, const std::vector<float>& query_embedding,
+                                                 const HybridOptions& options = {},
+                                                 DocumentStatus status = DocumentStatus::ACTUAL) const;
+
+    /**
+     * @brief Гибридный поиск по запросу и вектору запроса с заданным предикатом.
+     * @details Лексические кандидаты отбираются по TF-IDF, векторные - по скалярному произведению
+     *          в векторном индексе. Векторные кандидаты, не прошедшие предикат или содержащие минус-слова
+     *          запроса, отбрасываются. Списки объединяются методом Reciprocal Rank Fusion:
+     *          оценка документа - сумма 1 / (rrf_k + позиция) по спискам, где он встретился.
+     * @tparam predicate Тип предиката для фильтрации документов.
+     * @param raw_query Необработанный запрос.
+     * @param query_embedding Вектор запроса.
+     * @param options Параметры поиска.
+     * @param predict Предикат для фильтрации документов.
+     * @return Лучшие документы; поле relevance содержит оценку слияния.
+     * @throws invalid_argument Если запрос содержит недопустимые символы или размерность вектора неверна.
+     * @throws logic_error Если векторный индекс не включён.
+     */
+    template<typename predicate>
+    std::vector<Document> FindTopDocumentsHybrid(const std::string& raw_query, const std::vector<float>& query_embedding,
+                                                 const HybridOptions& options, predicate predict) const;
+
+    /**
+     * @brief Строит индекс, упорядоченный по взвешенному рейтингу документов.
+     * @details Статическая оценка документа - rating_weight * рейтинг. Повторный вызов перестраивает индекс.
+     * @param rating_weight Вес рейтинга в оценке документа.
+     */
+    void BuildStaticRankIndex(double rating_weight = 1.0);
+
+    /**
+     * @brief Строит индекс, упорядоченный по заданной статической оценке документов.
+     * @details Функция вызывается и для документов, добавленных после построения, поэтому должна
+     *          оставаться корректной, пока индекс используется. Повторный вызов перестраивает индекс.
+     * @param static_score Функция статической оценки документа по идентификатору и рейтингу.
+     */
+    void BuildStaticRankIndex(StaticRankIndex::StaticScore static_score);
+
+    /**
+     * @brief Поиск по сумме релевантности и статической оценки с указанным статусом.
+     * @param raw_query Необработанный запрос.
+     * @param status Статус документа для поиска (по умолчанию DocumentStatus::ACTUAL).
+     * @return Лучшие документы; поле relevance содержит сумму релевантности и статической оценки.
+     * @throws invalid_argument Если запрос содержит недопустимые символы.
+     * @throws logic_error Если индекс по статической оценке не построен.
+     */
+    std::vector<Document> FindTopDocumentsByStaticRank(const std::string& raw_query,
+                                                       DocumentStatus status = DocumentStatus::ACTUAL) const;
+
+    /**
+     * @brief Поиск по сумме релевантности и статической оценки с заданным предикатом.
+     * @details Документы просматриваются по убыванию статической оценки (см. StaticRankIndex), и
+     *          просмотр прекращается, когда ни один из оставшихся документов уже не может попасть
+     *          в результат. Поэтому для запросов из частых слов по документам с высоким рейтингом
+     *          читается лишь начало списков слов.
+     * @tparam predicate Тип предиката для фильтрации документов.
+     * @param raw_query Необработанный запрос.
+     * @param predict Предикат для фильтрации документов.
+     * @return Лучшие документы; поле relevance содержит сумму релевантности и статической оценки.
+     * @throws invalid_argument Если запрос содержит недопустимые символы.
+     * @throws logic_error Если индекс по статической оценке не построен.
+     */
+    template<typename predicate>
+    std::vector<Document> FindTopDocumentsByStaticRank(const std::string& raw_query, predicate predict) const;
+
+    /**
+     * @brief Задаёт стоп-слова, применяемые при разборе запроса.
+     * @details В отличие от стоп-слов конструктора, эти слова не удаляются из индекса, поэтому их набор
+     *          можно менять без переиндексации. Чтобы индексировать все слова, создайте поисковую систему
+     *          с пустым списком стоп-слов. Новый набор публикуется атомарно: уже выполняющиеся запросы
+     *          дорабатывают со старым набором. Вызовы методов настройки не должны выполняться одновременно.
+     * @tparam StringContainer Тип контейнера со строками.
+     * @param stop_words Контейнер со стоп-словами.
+     * @throws invalid_argument Если какое-либо стоп-слово содержит недопустимые символы.
+     */
+    template <typename StringContainer>
+    void SetQueryStopWords(const StringContainer& stop_words);
+
+    /**
+     * @brief Задаёт стоп-слова, применяемые при разборе запроса.
+     * @param stop_words_text Текст со стоп-словами.
+     * @throws invalid_argument Если какое-либо стоп-слово содержит недопустимые символы.
+     */
+    void SetQueryStopWords(const std::string& stop_words_text);
+
+    /**
+     * @brief Задаёт долю документов, начиная с которой плюс-слово запроса считается стоп-словом.
+     * @details Плюс-слова, встречающиеся более чем в max_document_share * GetDocumentCount() документов,
+     *          не участвуют в ранжировании: FindTopDocuments, FindTopCandidates, FindTopDocumentsReranked,
+     *          FindTopDocumentsHybrid и FindTopDocumentsByStaticRank. Документы, содержащие из плюс-слов
+     *          только частые, поэтому не находятся. Если частыми оказались все плюс-слова запроса,
+     *          ни одно не пропускается. ExplainScore перечисляет пропущенные слова. MatchDocument,
+     *          MatchDocuments и GetSnippets учитывают все слова. Минус-слова не пропускаются.
+     *          Значение 1.0 (по умолчанию) отключает автоматическое определение.
+     * @param max_document_share Доля документов от 0 до 1.
+     * @throws invalid_argument Если доля вне диапазона [0, 1].
+     */
+    void SetStopWordDocumentShare(double max_document_share);
+
+    /**
+     * @brief Включает журнал медленных запросов FindTopDocuments.
+     * @details Запрос, выполнявшийся не меньше threshold, сохраняется со словами, их частотой документов,
+     *          количеством просмотренных словопозиций и кандидатов и временем разбора, вычисления
+     *          релевантности и отбора. Пока журнал включён, каждый запрос четырежды читает часы;
+     *          подробности собираются только для медленных запросов.
+     * @param threshold Время запроса, начиная с которого он считается медленным.
+     * @param capacity Вместимость буфера записей; степень двойки. Лишние записи отбрасываются.
+     * @throws invalid_argument Если вместимость не является степенью двойки.
+     */
+    void EnableSlowQueryLog(std::chrono::microseconds threshold, size_t capacity = SlowQueryLog::DEFAULT_CAPACITY);
+
+    /**
+     * @brief Выключает журнал медленных запросов; накопленные записи теряются.
+     */
+    void DisableSlowQueryLog();
+
+    /**
+     * @brief Забирает накопленные записи о медленных запросах.
+     * @details Может вызываться одновременно с поиском.
+     * @return Записи в порядке сохранения; пустой вектор, если журнал выключен.
+     */
+    std::vector<SlowQueryRecord> DrainSlowQueries() const;
+
+    /**
+     * @brief Возвращает количество записей о медленных запросах, не поместившихся в буфер.
+     * @return Количество отброшенных записей; 0, если журнал выключен.
+     */
+    uint64_t GetDroppedSlowQueryCount() const;
+
+    /**
+     * @brief Этап выполнения запроса FindTopDocuments.
+     */
+    enum class QueryPhase {
+        PARSE,  ///< Проверка и разбор запроса.
+        SCORE,  ///< Вычисление релевантности по спискам словопозиций.
+        SELECT  ///< Отбор и упорядочивание лучших документов.
+    };
+
+    /**
+     * @brief Наблюдатель этапов запросов FindTopDocuments, например для чтения счётчиков производительности.
+     */
+    class QueryPhaseObserver {
+    public:
+        virtual ~QueryPhaseObserver() = default;
+
+        /**
+         * @brief Вызывается по окончании каждого этапа запроса.
+         * @param phase Завершившийся этап.
+         */
+        virtual void OnPhaseEnd(QueryPhase phase) = 0;
+
+        /**
+         * @brief Вызывается по окончании запроса, после этапа SELECT.
+         * @param postings_scanned Количество просмотренных словопозиций.
+         * @param candidates_scored Количество документов, получивших релевантность.
+         */
+        virtual void OnQueryEnd(size_t postings_scanned, size_t candidates_scored) = 0;
+    };
+
+    /**
+     * @brief Задаёт наблюдателя этапов для запросов, выполняемых в текущем потоке.
+     * @param observer Наблюдатель; nullptr отключает наблюдение.
+     */
+    static void SetQueryPhaseObserver(QueryPhaseObserver* observer);
+
+    /**
+     * @brief Регистрирует метрики поисковой системы и начинает их обновлять.
+     * @details Метрики: search_server_documents_added_total (скорость индексации - rate от него),
+     *          search_server_documents, search_server_terms, search_server_postings и счётчики кеша
+     *          хранилища текстов search_server_document_store_cache_hits_total и _misses_total. Значения обновляются при
+     *          добавлении документов и чтении текстов, поэтому вывод метрик в другом потоке
+     *          не обращается к индексу. Копии поисковой системы обновляют те же метрики.
+     * @param registry Реестр метрик; должен жить дольше поисковой системы.
+     * @throws invalid_argument Если метрики с такими именами уже зарегистрированы.
+     */
+    void EnableMetrics(MetricsRegistry& registry);
+
+    /**
+     * @brief Включает теневое выполнение запросов альтернативным движком.
+     * @details Запросы FindTopDocuments по статусу передаются в ShadowExecutor вместе с результатом
+     *          и временем выполнения; выборку, ограничение частоты и сравнение выполняет он.
+     *          Запросы с произвольным предикатом не повторяются: предикат может ссылаться на
+     *          данные, не живущие до выполнения теневого запроса.
+     * @param shadow_executor Исполнитель теневых запросов; nullptr выключает теневое выполнение.
+     *        Теневой движок не должен быть этой же поисковой системой или её копией с включённым
+     *        теневым выполнением.
+     */
+    void EnableShadowExecution(std::shared_ptr<ShadowExecutor> shadow_executor);
+
 private:
+    // Коллекции разбирают тексты и отбирают результаты так же, как поисковая система
+    friend class CollectionServer;
+
     struct DocumentData {
         int rating;             ///< Рейтинг документа.
         DocumentStatus status;  ///< Статус документа.
+        std::chrono::system_clock::time_point expires_at = std::chrono::system_clock::time_point::max(); ///< Момент истечения срока жизни, с которого документ скрыт из результатов.
+    };
+
+    /**
+     * @brief Настройки стоп-слов, применяемых при разборе запроса.
+     */
+    struct QueryStopWords {
+        std::set<std::string> words;        ///< Стоп-слова запроса.
+        double max_document_share = 1.0;    ///< Доля документов, выше которой плюс-слово пропускается.
     };
 
-    std::set<std::string> stop_words_;                           ///< Множество стоп-слов.
-    std::map<std::string, std::map<int, double>> word_to_document_freqs_;  ///< Частота слов в документах.
-    std::map<int, DocumentData> documents_;                      ///< Документы в поисковой системе.
-    std::vector<int> document_ids;                               ///< Идентификаторы документов.
+    std::shared_ptr<const std::set<std::string>> stop_words_;    ///< Множество стоп-слов; разделяется копиями.
+    std::shared_ptr<const QueryStopWords> query_stop_words_ = std::make_shared<QueryStopWords>(); ///< Стоп-слова запроса, заменяемые атомарно.
+    SharedTermDictionary dictionary_;                            ///< Словарь слов, на который ссылаются индексы; разделяется копиями.
+    size_t swept_dictionary_size_ = 0;                           ///< Размер словаря после последнего удаления неиспользуемых слов.
+    CowMap<std::string_view, CowMap<int, double>> word_to_document_freqs_;  ///< Частота слов в документах; список каждого слова разделяется копиями отдельно.
+    CowMap<int, CowShared<std::map<std::string_view, double>>> document_to_word_freqs_;  ///< Прямой индекс: частоты слов документа; ключи - слова dictionary_.
+    CowShared<std::map<int, std::vector<std::string_view>>> document_words_ = nullptr;  ///< Слова документов без стоп-слов в порядке следования; пусто, если не хранятся.
+    CowShared<std::map<std::pair<std::string_view, std::string_view>, std::vector<int>>> shingle_to_documents_; ///< Индекс пар: отсортированные идентификаторы документов с парой.
+    CowMap<int, DocumentData> documents_;                        ///< Документы в поисковой системе.
+    CowShared<std::vector<int>> document_ids;                    ///< Идентификаторы документов.
+    CowShared<std::vector<int>> document_ratings_;               ///< Рейтинги документов в порядке document_ids.
+    CowShared<std::vector<DocumentStatus>> document_statuses_;   ///< Статусы документов в порядке document_ids.
+    CowMap<int, size_t> document_columns_;                       ///< Позиции документов в document_ids и колонках рейтингов и статусов.
+    CowShared<std::set<std::pair<std::chrono::system_clock::time_point, int>>> expiry_queue_; ///< Документы с ограниченным сроком жизни, ещё не ожидающие удаления, в порядке истечения.
+    CowShared<std::set<int>> expired_documents_;                 ///< Документы с истёкшим сроком жизни, ожидающие удаления.
+    CowShared<DocumentStore> document_store_ = nullptr;          ///< Хранилище сжатых текстов документов; пусто, если выключено.
+    CowShared<VectorIndex> vector_index_ = nullptr;              ///< Векторные представления документов; пусто, если выключены.
+    CowShared<StaticRankIndex> static_rank_index_ = nullptr;     ///< Индекс по статической оценке; пусто, если не построен.
+    std::shared_ptr<SlowQueryLog> slow_query_log_;               ///< Журнал медленных запросов; пуст, если выключен.
+    inline static thread_local QueryPhaseObserver* query_phase_observer_ = nullptr; ///< Наблюдатель этапов запросов потока.
+
+    /**
+     * @brief Метрики поисковой системы в реестре.
+     */
+    struct ServerMetrics {
+        Counter* documents_added;   ///< Количество добавленных документов.
+        Gauge* documents;           ///< Количество документов.
+        Gauge* terms;               ///< Количество слов словаря.
+        Gauge* postings;            ///< Количество словопозиций.
+        Counter* store_cache_hits;  ///< Попадания в кеш блоков хранилища.
+        Counter* store_cache_misses; ///< Промахи кеша блоков хранилища.
+        mutable std::atomic<uint64_t> exported_store_cache_hits{0};   ///< Попадания, уже добавленные в счётчик.
+        mutable std::atomic<uint64_t> exported_store_cache_misses{0}; ///< Промахи, уже добавленные в счётчик.
+    };
+
+    size_t posting_count_ = 0;                                   ///< Количество словопозиций.
+    std::shared_ptr<const ServerMetrics> metrics_;               ///< Метрики; пусто, если не включены.
+    std::shared_ptr<ShadowExecutor> shadow_executor_;            ///< Исполнитель теневых запросов; пуст, если выключен.
+
+    /**
+     * @brief Удаляет документ из индексов, таблицы документов, хранилища и векторного индекса.
+     * @param document_id Идентификатор существующего документа.
+     */
+    void EraseDocument(int document_id);
+
+    /**
+     * @brief Ставит в очередь удаления истёкшие документы и удаляет пачку, если очередь достигла
+     *        EXPIRED_PURGE_BATCH_SIZE; вызывается при добавлении документов.
+     */
+    void PurgeExpiredDocumentsOnWrite();
+
+    /**
+     * @brief Удаляет последовательность слов документа и документ из списков индекса пар.
+     * @param document_id Идентификатор документа с сохранённой последовательностью слов.
+     */
+    void EraseDocumentWords(int document_id);
+
+    /**
+     * @brief Удаляет документы из колонок идентификаторов, рейтингов и статусов за один проход.
+     * @param document_ids_to_erase Идентификаторы удаляемых документов.
+     */
+    void EraseDocumentColumns(const std::set<int>& document_ids_to_erase);
 
     /**
      * @brief Проверяет, является ли слово стоп-словом.
@@ -136,31 +839,38 @@ private:
     /**
      * @brief Разбирает слово запроса и определяет его тип (плюс, минус или стоп).
      * @param text Текст слова запроса.
+     * @param query_stop_words Стоп-слова запроса.
      * @return Структура QueryWord с информацией о слове.
      */
-    QueryWord ParseQueryWord(std::string text) const;
+    QueryWord ParseQueryWord(std::string text, const QueryStopWords& query_stop_words) const;
 
     /**
      * @brief Структура для представления запроса.
      */
     struct Query {
-        std::set<std::string> plus_words;   ///< Множество плюс-слов запроса.
-        std::set<std::string> minus_words;  ///< Множество минус-слов запроса.
+        std::set<std::string> plus_words;       ///< Множество плюс-слов запроса.
+        std::set<std::string> minus_words;      ///< Множество минус-слов запроса.
+        std::set<std::string> frequent_words;   ///< Плюс-слова, пропущенные как слишком частые.
     };
 
     /**
      * @brief Разбирает текст запроса и формирует структуру Query с плюс- и минус-словами.
+     * @details Частые плюс-слова пропускаются только по запросу: это нужно методам ранжирования, но не
+     *          сопоставлению запроса с документами. Если частыми оказываются все плюс-слова, ни одно
+     *          из них не пропускается.
      * @param text Текст поискового запроса.
+     * @param skip_frequent_words Пропускать ли плюс-слова, встречающиеся в доле документов больше
+     *        max_document_share (см. SetStopWordDocumentShare).
      * @return Структура Query с плюс- и минус-словами.
      */
-    Query ParseQuery(const std::string& text) const;
+    Query ParseQuery(const std::string& text, bool skip_frequent_words = false) const;
 
     /**
      * @brief Вычисляет обратную частоту документа для слова.
      * @param word Слово для вычисления IDF.
      * @return Значение IDF (inverse document frequency).
      */
-    double ComputeWordInverseDocumentFreq(const std::string& word) const;
+    double ComputeWordInverseDocumentFreq(std::string_view word) const;
 
     /**
      * @brief Проверяет, является ли слово допустимым для использования в поисковом запросе.
@@ -169,6 +879,70 @@ private:
      */
     static bool IsValidWord(const std::string& word);
 
+    /**
+     * @brief Создаёт предикат, пропускающий документы с заданным статусом.
+     * @param status Статус документа.
+     * @return Предикат с сигнатурой методов поиска.
+     */
+    static auto MakeStatusPredicate(DocumentStatus status) {
+        return [status](int, DocumentStatus document_status, int) {
+            return document_status == status;
+        };
+    }
+
+    /**
+     * @brief Отбирает лучшие документы по релевантности, затем по рейтингу.
+     * @details При равных релевантности и рейтинге сохраняется входной порядок документов.
+     * @param documents Оценённые документы.
+     * @param count Наибольшее количество документов в результате.
+     * @return Не более count лучших документов по убыванию оценки.
+     */
+    static std::vector<Document> SelectTopDocuments(std::vector<Document> documents, size_t count);
+
+    /**
+     * @brief Вычисляет релевантность всех документов, соответствующих запросу и предикату.
+     * @tparam DocPredicate Тип предиката для фильтрации документов.
+     * @param query Запрос.
+     * @param doc_pred Предикат для фильтрации документов.
+     * @return Релевантности документов по возрастанию идентификатора.
+     */
+    template<typename DocPredicate>
+    std::map<int, double> ComputeDocumentRelevance(const Query& query, DocPredicate doc_pred) const;
+
+    /**
+     * @brief Выбирает лучших кандидатов для разобранного запроса.
+     * @tparam DocPredicate Тип предиката для фильтрации документов.
+     * @param query Запрос.
+     * @param count Количество кандидатов.
+     * @param result Буфер для кандидатов от лучшего к худшему.
+     * @param doc_pred Предикат для фильтрации документов.
+     */
+    template<typename DocPredicate>
+    void CollectTopCandidates(const Query& query, size_t count, DocumentColumns& result, DocPredicate doc_pred) const;
+
+    /**
+     * @brief Параллельно заполняет частоты слов и близость слов запроса для части кандидатов.
+     * @param batch Набор с заполненными словами запроса и кандидатами и размеченными столбцами признаков.
+     * @param first Номер первого кандидата.
+     * @param last Номер за последним кандидатом.
+     */
+    void ExtractRerankFeatures(FeatureBatch& batch, size_t first, size_t last) const;
+
+    /**
+     * @brief Разбирает фразу в последовательность ключей словаря.
+     * @param raw_phrase Фраза.
+     * @return Ключи словаря слов фразы; пустой вектор, если какого-либо слова нет в индексе.
+     * @throws invalid_argument Если фраза содержит недопустимые символы или минус-слова.
+     */
+    std::vector<std::string_view> ParsePhrase(const std::string& raw_phrase) const;
+
+    /**
+     * @brief Находит документы, в которых слова фразы идут подряд.
+     * @param phrase Ключи словаря слов фразы.
+     * @return Отсортированные идентификаторы документов.
+     */
+    std::vector<int> FindPhraseDocumentIds(const std::vector<std::string_view>& phrase) const;
+
     /**
      * @brief Возвращает все документы, соответствующие запросу и предикату.
      * @tparam DocPredicate Тип предиката для фильтрации документов.
@@ -178,19 +952,69 @@ private:
      */
     template<typename DocPredicate>
     std::vector<Document> FindAllDocuments(const Query& query, DocPredicate doc_pred) const;
+
+    /**
+     * @brief Моменты окончания этапов запроса.
+     */
+    struct QueryPhaseTimes {
+        std::chrono::steady_clock::time_point start;    ///< Начало запроса.
+        std::chrono::steady_clock::time_point parsed;   ///< Окончание разбора.
+        std::chrono::steady_clock::time_point scored;   ///< Окончание вычисления релевантности.
+        std::chrono::steady_clock::time_point selected; ///< Окончание отбора.
+    };
+
+    /**
+     * @brief Сохраняет запрос в журнал медленных запросов, если он выполнялся дольше порога.
+     * @param raw_query Необработанный запрос.
+     * @param query Разобранный запрос.
+     * @param candidate_count Количество документов, получивших релевантность.
+     * @param result_count Количество документов в результате.
+     * @param times Моменты окончания этапов.
+     */
+    void RecordSlowQuery(const std::string& raw_query, const Query& query, size_t candidate_count,
+                         size_t result_count, const QueryPhaseTimes& times) const;
+
+    /**
+     * @brief Считает словопозиции, просматриваемые запросом.
+     * @param query Разобранный запрос.
+     * @return Сумма длин списков словопозиций плюс- и минус-слов.
+     */
+    size_t CountQueryPostings(const Query& query) const;
+
+    /**
+     * @brief Обновляет метрики размера индекса.
+     */
+    void UpdateIndexMetrics() const;
+
+    /**
+     * @brief Обновляет метрики кеша хранилища текстов.
+     */
+    void UpdateStoreCacheMetrics() const;
 };
 
 template <typename StringContainer>
 SearchServer::SearchServer(const StringContainer& stop_words)
-        : stop_words_(MakeUniqueNonEmptyStrings(stop_words)) {
+        : stop_words_(std::make_shared<const std::set<std::string>>(MakeUniqueNonEmptyStrings(stop_words))) {
     // Проверяем каждое стоп-слово на допустимость
-    for(const auto& stop_word: stop_words_){
+    for(const auto& stop_word: *stop_words_){
         if(!IsValidWord(stop_word)){
             throw std::invalid_argument("invalid word in class constructor");
         }
     }
 }
 
+template <typename StringContainer>
+void SearchServer::SetQueryStopWords(const StringContainer& stop_words) {
+    auto query_stop_words = std::make_shared<QueryStopWords>(*std::atomic_load(&query_stop_words_));
+    query_stop_words->words = MakeUniqueNonEmptyStrings(stop_words);
+    for(const auto& stop_word: query_stop_words->words){
+        if(!IsValidWord(stop_word)){
+            throw std::invalid_argument("invalid word in SetQueryStopWords function");
+        }
+    }
+    std::atomic_store(&query_stop_words_, std::shared_ptr<const QueryStopWords>(std::move(query_stop_words)));
+}
+
 template<typename predicate>
 std::vector<Document> SearchServer::FindTopDocuments(const std::string& raw_query, predicate predict) const {
     // Проверяем валидность запроса
@@ -198,33 +1022,420 @@ std::vector<Document> SearchServer::FindTopDocuments(const std::string& raw_quer
         throw std::invalid_argument("Invalid word in FindTopDocument function");
     }
 
+    SEARCH_TRACE(query__start, raw_query.c_str());
+
+    // Время этапов измеряется, только если включён журнал медленных запросов
+    using Clock = std::chrono::steady_clock;
+    const bool profile = slow_query_log_ != nullptr;
+    QueryPhaseTimes times;
+    if(profile){
+        times.start = Clock::now();
+    }
+    QueryPhaseObserver* const observer = query_phase_observer_;
+
     // Парсим запрос
-    const Query query = ParseQuery(raw_query);
+    const Query query = ParseQuery(raw_query, true);
+    if(profile){
+        times.parsed = Clock::now();
+    }
+    if(observer){
+        observer->OnPhaseEnd(QueryPhase::PARSE);
+    }
+    SEARCH_TRACE(query__parsed, query.plus_words.size(), query.minus_words.size());
 
     // Находим все документы, удовлетворяющие запросу и предикату
-    auto matched_documents = FindAllDocuments(query, predict);
+    std::vector<Document> matched_documents = FindAllDocuments(query, predict);
+    const size_t matched_count = matched_documents.size();
+    if(profile){
+        times.scored = Clock::now();
+    }
+    if(observer){
+        observer->OnPhaseEnd(QueryPhase::SCORE);
+    }
 
-    // Сортируем документы по релевантности и рейтингу
-    std::sort(matched_documents.begin(), matched_documents.end(),
-              [](const Document& lhs, const Document& rhs) {
-                  if (std::abs(lhs.relevance - rhs.relevance) < std::numeric_limits<double>::epsilon()) {
-                      return lhs.rating > rhs.rating;
-                  }
-                  return lhs.relevance > rhs.relevance;
-              });
+    // FindAllDocuments возвращает документы по возрастанию идентификатора, что задаёт последний критерий
+    const std::vector<Document> top_documents = SelectTopDocuments(std::move(matched_documents),
+                                                                   MAX_RESULT_DOCUMENT_COUNT);
 
-    // Ограничиваем количество возвращаемых документов
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    if(profile){
+        times.selected = Clock::now();
+        RecordSlowQuery(raw_query, query, matched_count, top_documents.size(), times);
     }
+    if(observer){
+        observer->OnPhaseEnd(QueryPhase::SELECT);
+        observer->OnQueryEnd(CountQueryPostings(query), matched_count);
+    }
+    SEARCH_TRACE(query__done, raw_query.c_str(), matched_count, top_documents.size());
+    return top_documents;
+}
 
-    return matched_documents;
+template<typename predicate>
+std::vector<Document> SearchServer::FindTopDocumentsByPhrase(const std::string& raw_phrase, predicate predict) const {
+    if(!document_words_) {
+        throw std::logic_error("Word positions are not enabled");
+    }
+    const std::vector<std::string_view> phrase = ParsePhrase(raw_phrase);
+    if(phrase.empty()) {
+        return {};
+    }
+
+    // Релевантность считается по словам фразы тем же способом, что и в ComputeDocumentRelevance
+    const std::set<std::string> phrase_words(phrase.begin(), phrase.end());
+    std::vector<double> inverse_document_freqs;
+    for(const std::string& word : phrase_words) {
+        inverse_document_freqs.push_back(ComputeWordInverseDocumentFreq(word));
+    }
+
+    // Срок жизни сравнивается с одним моментом на весь запрос
+    const std::chrono::system_clock::time_point query_time = std::chrono::system_clock::now();
+    std::vector<Document> matched_documents;
+    for(const int document_id : FindPhraseDocumentIds(phrase)) {
+        const auto& document_info = documents_.at(document_id);
+        if(document_info.expires_at <= query_time || !predict(document_id, document_info.status, document_info.rating)) {
+            continue;
+        }
+        const auto& word_freqs = *document_to_word_freqs_.at(document_id);
+        double relevance = 0.0;
+        size_t word_index = 0;
+        for(const std::string& word : phrase_words) {
+            relevance += ComputeTermRelevance(word_freqs.at(word), inverse_document_freqs[word_index++]);
+        }
+        matched_documents.push_back({document_id, relevance, document_info.rating});
+    }
+    return SelectTopDocuments(std::move(matched_documents), MAX_RESULT_DOCUMENT_COUNT);
+}
+
+template<typename predicate>
+std::vector<Document> SearchServer::FindTopDocumentsHybrid(const std::string& raw_query,
+                                                           const std::vector<float>& query_embedding,
+                                                           const HybridOptions& options, predicate predict) const {
+    if(!vector_index_) {
+        throw std::logic_error("Vector index is not enabled");
+    }
+    if(!IsValidWord(raw_query)){
+        throw std::invalid_argument("Invalid word in FindTopDocumentsHybrid function");
+    }
+
+    const Query query = ParseQuery(raw_query, true);
+    DocumentColumns lexical;
+    CollectTopCandidates(query, options.candidate_count, lexical, predict);
+
+    // Позиции считаются с единицы; карта упорядочена по идентификатору для последнего критерия ранжирования
+    std::map<int, double> document_to_score;
+    for(size_t rank = 0; rank < lexical.size(); ++rank) {
+        document_to_score[lexical.ids[rank]] += 1.0 / (options.rrf_k + rank + 1);
+    }
+
+    const std::chrono::system_clock::time_point query_time = std::chrono::system_clock::now();
+    size_t rank = 0;
+    for(const auto& [document_id, similarity] : vector_index_->Search(query_embedding, options.candidate_count,
+                                                                       options.probe_lists)) {
+        const auto& document_info = documents_.at(document_id);
+        if(document_info.expires_at <= query_time || !predict(document_id, document_info.status, document_info.rating)) {
+            continue;
+        }
+        const auto& word_freqs = *document_to_word_freqs_.at(document_id);
+        const bool has_minus_word = std::any_of(query.minus_words.begin(), query.minus_words.end(),
+                                                [&word_freqs](const std::string& word) {
+                                                    return word_freqs.count(word) > 0;
+                                                });
+        if(!has_minus_word) {
+            document_to_score[document_id] += 1.0 / (options.rrf_k + ++rank);
+        }
+    }
+
+    std::vector<Document> fused_documents;
+    fused_documents.reserve(document_to_score.size());
+    for(const auto& [document_id, score] : document_to_score) {
+        fused_documents.push_back({document_id, score, documents_.at(document_id).rating});
+    }
+    return SelectTopDocuments(std::move(fused_documents), options.result_count);
+}
+
+template<typename predicate>
+std::vector<Document> SearchServer::FindTopDocumentsByStaticRank(const std::string& raw_query, predicate predict) const {
+    if(!static_rank_index_) {
+        throw std::logic_error("Static rank index is not built");
+    }
+    if(!IsValidWord(raw_query)){
+        throw std::invalid_argument("Invalid word in FindTopDocumentsByStaticRank function");
+    }
+
+    const Query query = ParseQuery(raw_query, true);
+    std::vector<StaticRankIndex::Term> terms;
+    for(const std::string& word : query.plus_words) {
+        const auto it = word_to_document_freqs_.find(word);
+        if(it != word_to_document_freqs_.end()) {
+            terms.push_back({it->first, ComputeWordInverseDocumentFreq(word)});
+        }
+    }
+
+    const std::chrono::system_clock::time_point query_time = std::chrono::system_clock::now();
+    const auto accept = [this, &query, &predict, query_time](int document_id) {
+        const auto& document_info = documents_.at(document_id);
+        if(document_info.expires_at <= query_time || !predict(document_id, document_info.status, document_info.rating)) {
+            return false;
+        }
+        const auto& word_freqs = *document_to_word_freqs_.at(document_id);
+        return std::none_of(query.minus_words.begin(), query.minus_words.end(), [&word_freqs](const std::string& word) {
+            return word_freqs.count(word) > 0;
+        });
+    };
+    const StaticRankIndex::SearchResult result = static_rank_index_->Search(terms, MAX_RESULT_DOCUMENT_COUNT, accept);
+    SEARCH_TRACE(static__rank__done, raw_query.c_str(), result.postings_scanned, result.postings_total);
+
+    // Документы приходят в порядке просмотра; при равных оценках выше должен стоять меньший идентификатор
+    std::vector<Document> matched_documents;
+    matched_documents.reserve(result.documents.size());
+    for(const auto& [document_id, score] : result.documents) {
+        matched_documents.push_back({document_id, score, documents_.at(document_id).rating});
+    }
+    std::sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
+        return lhs.id < rhs.id;
+    });
+    return SelectTopDocuments(std::move(matched_documents), MAX_RESULT_DOCUMENT_COUNT);
+}
+
+template<typename predicate>
+std::vector<Document> SearchServer::FindSimilarDocuments(int document_id, size_t count, predicate predict) const {
+    // Взвешиваем слова исходного документа и оставляем самые значимые
+    std::vector<std::pair<double, std::string_view>> weighted_words;
+    for(const auto& [word, term_freq] : *document_to_word_freqs_.at(document_id)) {
+        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
+        weighted_words.emplace_back(ComputeTermRelevance(term_freq, inverse_document_freq), word);
+    }
+    const size_t term_count = std::min(SIMILAR_QUERY_TERM_COUNT, weighted_words.size());
+    std::partial_sort(weighted_words.begin(), weighted_words.begin() + term_count, weighted_words.end(),
+                      [](const auto& lhs, const auto& rhs) {
+                          return lhs.first > rhs.first || (lhs.first == rhs.first && lhs.second < rhs.second);
+                      });
+    weighted_words.resize(term_count);
+
+    // Слова прямого индекса - ключи словаря, поэтому ищутся без построения строк
+    const std::chrono::system_clock::time_point query_time = std::chrono::system_clock::now();
+    std::map<int, Document> document_to_similarity;
+    for(const auto& [weight, word] : weighted_words) {
+        if(weight <= 0.0) {
+            continue;
+        }
+        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
+        for(const auto& [other_id, term_freq] : word_to_document_freqs_.at(word)) {
+            if(other_id == document_id) {
+                continue;
+            }
+            const auto& document_info = documents_.at(other_id);
+            if(document_info.expires_at > query_time && predict(other_id, document_info.status, document_info.rating)) {
+                Document& similar = document_to_similarity.try_emplace(other_id, other_id, 0.0,
+                                                                       document_info.rating).first->second;
+                similar.relevance += weight * ComputeTermRelevance(term_freq, inverse_document_freq);
+            }
+        }
+    }
+
+    // Отбираем по целочисленным ключам и копируем только отобранные документы; кандидаты
+    // пронумерованы по возрастанию идентификатора, что задаёт последний критерий
+    std::vector<const Document*> candidates;
+    std::vector<RankedCandidate> ranked;
+    candidates.reserve(document_to_similarity.size());
+    ranked.reserve(document_to_similarity.size());
+    for(const auto& [other_id, similar] : document_to_similarity) {
+        ranked.push_back({MakeRankKey(similar.relevance, similar.rating), static_cast<uint32_t>(candidates.size())});
+        candidates.push_back(&similar);
+    }
+    SelectTopCandidates(ranked, count);
+
+    std::vector<Document> top_documents;
+    top_documents.reserve(ranked.size());
+    for(const RankedCandidate& candidate : ranked) {
+        top_documents.push_back(*candidates[candidate.index]);
+    }
+    return top_documents;
+}
+
+template<typename predicate>
+SearchServer::ScoreExplanation SearchServer::ExplainScore(const std::string& raw_query, int document_id,
+                                                          predicate predict) const {
+    if(!IsValidWord(raw_query)){
+        throw std::invalid_argument("Invalid word in ExplainScore function");
+    }
+
+    const Query query = ParseQuery(raw_query, true);
+    const auto& document_info = documents_.at(document_id);
+
+    ScoreExplanation explanation;
+    explanation.document_id = document_id;
+    explanation.rating = document_info.rating;
+    explanation.excluded_by_predicate = document_info.expires_at <= std::chrono::system_clock::now()
+                                        || !predict(document_id, document_info.status, document_info.rating);
+    explanation.skipped_words.assign(query.frequent_words.begin(), query.frequent_words.end());
+
+    // Слова обходятся в том же порядке, что и в ComputeDocumentRelevance, поэтому сумма вкладов совпадает
+    double relevance = 0.0;
+    for(const std::string& word : query.plus_words) {
+        const auto word_it = word_to_document_freqs_.find(word);
+        if(word_it == word_to_document_freqs_.end()) {
+            continue;
+        }
+        const auto freq_it = word_it->second.find(document_id);
+        if(freq_it == word_it->second.end()) {
+            continue;
+        }
+
+        TermExplanation term;
+        term.word = word;
+        term.term_freq = freq_it->second;
+        term.document_freq = word_it->second.size();
+        term.inverse_document_freq = ComputeWordInverseDocumentFreq(word);
+        term.contribution = ComputeTermRelevance(term.term_freq, term.inverse_document_freq);
+        relevance += term.contribution;
+        explanation.terms.push_back(std::move(term));
+    }
+
+    for(const std::string& word : query.minus_words) {
+        const auto word_it = word_to_document_freqs_.find(word);
+        if(word_it != word_to_document_freqs_.end() && word_it->second.count(document_id)) {
+            explanation.excluding_minus_words.push_back(word);
+        }
+    }
+
+    explanation.is_found = !explanation.terms.empty() && !explanation.excluded_by_predicate
+                           && explanation.excluding_minus_words.empty();
+    explanation.relevance = explanation.is_found ? relevance : 0.0;
+    return explanation;
+}
+
+template<typename predicate>
+void SearchServer::FindTopCandidates(const std::string& raw_query, size_t count, DocumentColumns& result,
+                                     predicate predict) const {
+    if(!IsValidWord(raw_query)){
+        throw std::invalid_argument("Invalid word in FindTopCandidates function");
+    }
+
+    const Query query = ParseQuery(raw_query, true);
+    CollectTopCandidates(query, count, result, predict);
+}
+
+template<typename Reranker, typename predicate>
+std::vector<Document> SearchServer::FindTopDocumentsReranked(const std::string& raw_query,
+                                                             const RerankOptions& options,
+                                                             Reranker reranker, predicate predict) const {
+    const auto start = std::chrono::steady_clock::now();
+    const auto is_over_budget = [&start, &options]() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start)
+               >= options.latency_budget;
+    };
+
+    if(!IsValidWord(raw_query)){
+        throw std::invalid_argument("Invalid word in FindTopDocumentsReranked function");
+    }
+
+    // Первый этап: дешёвый отбор кандидатов по TF-IDF
+    const Query query = ParseQuery(raw_query, true);
+    FeatureBatch batch;
+    batch.terms.assign(query.plus_words.begin(), query.plus_words.end());
+    CollectTopCandidates(query, options.candidate_count, batch.candidates, predict);
+    const DocumentColumns& candidates = batch.candidates;
+
+    const auto first_stage_documents = [&candidates, &options]() {
+        std::vector<Document> documents;
+        for(size_t i = 0; i < candidates.size() && i < options.result_count; ++i) {
+            documents.push_back({candidates.ids[i], candidates.relevances[i], candidates.ratings[i]});
+        }
+        return documents;
+    };
+    // Второй этап: параллельное переранжирование пачками; при равных оценках сохраняется порядок первого этапа
+    batch.proximities.assign(candidates.size(), 0.0);
+    batch.term_freqs.assign(candidates.size() * batch.terms.size(), 0.0);
+    std::vector<double> scores(candidates.size());
+    std::vector<RankedCandidate> ranked(candidates.size());
+    for(size_t i = 0; i < ranked.size(); ++i) {
+        ranked[i].index = static_cast<uint32_t>(i);
+    }
+    // Исключение из параллельного участка приводит к std::terminate, поэтому первое исключение
+    // функции переранжирования сохраняется и выбрасывается после обработки
+    std::exception_ptr reranker_error;
+    std::mutex reranker_error_mutex;
+    const size_t batch_size = std::max<size_t>(options.batch_size, 1);
+    for(size_t first = 0; first < ranked.size(); first += batch_size) {
+        if(is_over_budget()) {
+            return first_stage_documents();
+        }
+        const size_t last = std::min(ranked.size(), first + batch_size);
+        ExtractRerankFeatures(batch, first, last);
+        std::for_each(std::execution::par, ranked.begin() + first, ranked.begin() + last, [&](RankedCandidate& candidate) {
+            double score = 0.0;
+            try {
+                score = reranker(batch.Row(candidate.index));
+            } catch(...) {
+                std::lock_guard guard(reranker_error_mutex);
+                if(!reranker_error) {
+                    reranker_error = std::current_exception();
+                }
+                return;
+            }
+            scores[candidate.index] = score;
+            candidate.key = MakeRankKey(score, candidates.ratings[candidate.index]);
+        });
+        if(reranker_error) {
+            std::rethrow_exception(reranker_error);
+        }
+    }
+    SelectTopCandidates(ranked, options.result_count);
+
+    std::vector<Document> documents;
+    documents.reserve(ranked.size());
+    for(const RankedCandidate& candidate : ranked) {
+        documents.push_back({candidates.ids[candidate.index], scores[candidate.index], candidates.ratings[candidate.index]});
+    }
+    return documents;
+}
+
+template<typename Reranker>
+std::vector<Document> SearchServer::FindTopDocumentsReranked(const std::string& raw_query,
+                                                             const RerankOptions& options,
+                                                             Reranker reranker, DocumentStatus status) const {
+    return FindTopDocumentsReranked(raw_query, options, reranker, MakeStatusPredicate(status));
 }
 
 template<typename DocPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocPredicate doc_pred) const {
+void SearchServer::CollectTopCandidates(const Query& query, size_t count, DocumentColumns& result,
+                                        DocPredicate doc_pred) const {
+    const std::map<int, double> document_to_relevance = ComputeDocumentRelevance(query, doc_pred);
+
+    // Кандидаты нумеруются по возрастанию идентификатора, что задаёт последний критерий ранжирования
+    std::vector<int> ids;
+    std::vector<double> relevances;
+    std::vector<int> ratings;
+    std::vector<RankedCandidate> ranked;
+    ids.reserve(document_to_relevance.size());
+    relevances.reserve(document_to_relevance.size());
+    ratings.reserve(document_to_relevance.size());
+    ranked.reserve(document_to_relevance.size());
+    for(const auto& [document_id, relevance] : document_to_relevance) {
+        const int rating = documents_.at(document_id).rating;
+        ranked.push_back({MakeRankKey(relevance, rating), static_cast<uint32_t>(ids.size())});
+        ids.push_back(document_id);
+        relevances.push_back(relevance);
+        ratings.push_back(rating);
+    }
+    SelectTopCandidates(ranked, count);
+
+    result.clear();
+    result.ids.reserve(ranked.size());
+    result.relevances.reserve(ranked.size());
+    result.ratings.reserve(ranked.size());
+    for(const RankedCandidate& candidate : ranked) {
+        result.ids.push_back(ids[candidate.index]);
+        result.relevances.push_back(relevances[candidate.index]);
+        result.ratings.push_back(ratings[candidate.index]);
+    }
+}
+
+template<typename DocPredicate>
+std::map<int, double> SearchServer::ComputeDocumentRelevance(const Query& query, DocPredicate doc_pred) const {
     // Карта для хранения релевантности каждого документа
     std::map<int, double> document_to_relevance;
+    const std::chrono::system_clock::time_point query_time = std::chrono::system_clock::now();
 
     // Вычисляем релевантность для плюс-слов
     for(const std::string& word : query.plus_words) {
@@ -233,11 +1444,13 @@ std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocPred
         }
 
         const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
+        const auto& postings = word_to_document_freqs_.at(word);
+        SEARCH_TRACE(term__scan, word.c_str(), postings.size(), 0);
 
-        for(const auto& [document_id, term_freq] : word_to_document_freqs_.at(word)) {
+        for(const auto& [document_id, term_freq] : postings) {
             const auto& document_info = documents_.at(document_id);
-            if(doc_pred(document_id, document_info.status, document_info.rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+            if(document_info.expires_at > query_time && doc_pred(document_id, document_info.status, document_info.rating)) {
+                document_to_relevance[document_id] += ComputeTermRelevance(term_freq, inverse_document_freq);
             }
         }
     }
@@ -248,14 +1461,22 @@ std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocPred
             continue;
         }
 
-        for(const auto& [document_id, _] : word_to_document_freqs_.at(word)) {
+        const auto& postings = word_to_document_freqs_.at(word);
+        SEARCH_TRACE(term__scan, word.c_str(), postings.size(), 1);
+
+        for(const auto& [document_id, _] : postings) {
             document_to_relevance.erase(document_id);
         }
     }
 
-    // Преобразуем карту в вектор документов и возвращаем его
+    return document_to_relevance;
+}
+
+template<typename DocPredicate>
+std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocPredicate doc_pred) const {
+    // Преобразуем карту релевантностей в вектор документов и возвращаем его
     std::vector<Document> matched_documents;
-    for(const auto& [document_id, relevance] : document_to_relevance) {
+    for(const auto& [document_id, relevance] : ComputeDocumentRelevance(query, doc_pred)) {
         matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
     }
 
@@ -0,0 +1,182 @@
+#include "shadow_executor.h"
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+/**
+ * @brief Конструктор класса ShadowExecutor: запускает фоновый поток.
+ * @param shadow_engine Теневой движок.
+ * @param options Параметры теневого выполнения.
+ * @throws invalid_argument Если доля выборки вне [0, 1] или вместимости не степени двойки.
+ */
+ShadowExecutor::ShadowExecutor(QueryEngine shadow_engine, const ShadowOptions& options)
+        : shadow_engine_(std::move(shadow_engine))
+        , options_(options)
+        , tasks_(options.queue_capacity)
+        , mismatches_(options.mismatch_capacity)
+        , rate_refill_(std::chrono::steady_clock::now())
+        , rate_tokens_(static_cast<double>(options.max_queries_per_second)) {
+    if (!(options.sample_rate >= 0.0 && options.sample_rate <= 1.0)) {
+        throw std::invalid_argument("Shadow sample rate must be in [0, 1]");
+    }
+    worker_ = std::thread(&ShadowExecutor::Run, this);
+}
+
+/**
+ * @brief Деструктор: дожидается выполнения поставленных в очередь запросов.
+ */
+ShadowExecutor::~ShadowExecutor() {
+    stopping_.store(true, std::memory_order_release);
+    worker_.join();
+}
+
+/**
+ * @brief Предлагает запрос основного движка для теневого выполнения.
+ * @param raw_query Необработанный запрос.
+ * @param status Статус документов запроса.
+ * @param primary_result Результат основного движка.
+ * @param primary_time Время основного движка.
+ */
+void ShadowExecutor::Submit(const std::string& raw_query, DocumentStatus status,
+                            const std::vector<Document>& primary_result, std::chrono::nanoseconds primary_time) {
+    thread_local std::minstd_rand generator(std::random_device{}());
+    if (std::uniform_real_distribution<double>(0.0, 1.0)(generator) >= options_.sample_rate) {
+        return;
+    }
+    sampled_.fetch_add(1, std::memory_order_relaxed);
+    if (!TryAcquireRate()) {
+        rate_limited_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    ShadowTask task;
+    task.raw_query = raw_query;
+    task.status = status;
+    task.primary_ids.reserve(primary_result.size());
+    for (const Document& document : primary_result) {
+        task.primary_ids.push_back(document.id);
+    }
+    task.primary_time = primary_time;
+    if (!tasks_.TryPush(task)) {
+        queue_full_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Возвращает статистику теневого выполнения.
+ * @return Статистика.
+ */
+ShadowStats ShadowExecutor::GetStats() const {
+    ShadowStats stats;
+    stats.sampled = sampled_.load(std::memory_order_relaxed);
+    stats.rate_limited = rate_limited_.load(std::memory_order_relaxed);
+    stats.queue_full = queue_full_.load(std::memory_order_relaxed);
+    stats.executed = executed_.load(std::memory_order_relaxed);
+    stats.failed = failed_.load(std::memory_order_relaxed);
+    stats.mismatched = mismatched_.load(std::memory_order_relaxed);
+    stats.primary_time = std::chrono::nanoseconds(primary_time_.load(std::memory_order_relaxed));
+    stats.shadow_time = std::chrono::nanoseconds(shadow_time_.load(std::memory_order_relaxed));
+    return stats;
+}
+
+/**
+ * @brief Забирает накопленные расхождения.
+ * @return Расхождения в порядке обнаружения.
+ */
+std::vector<ShadowMismatch> ShadowExecutor::DrainMismatches() {
+    std::vector<ShadowMismatch> result;
+    ShadowMismatch mismatch;
+    while (mismatches_.TryPop(mismatch)) {
+        result.push_back(std::move(mismatch));
+    }
+    return result;
+}
+
+/**
+ * @brief Проверяет ограничение частоты и расходует разрешение.
+ */
+bool ShadowExecutor::TryAcquireRate() {
+    // Корзина разрешений пополняется со скоростью max_queries_per_second и вмещает секундный запас
+    const double rate = static_cast<double>(options_.max_queries_per_second);
+    const auto now = std::chrono::steady_clock::now();
+    std::lock_guard guard(rate_mutex_);
+    rate_tokens_ = std::min(rate, rate_tokens_ + std::chrono::duration<double>(now - rate_refill_).count() * rate);
+    rate_refill_ = now;
+    if (rate_tokens_ < 1.0) {
+        return false;
+    }
+    rate_tokens_ -= 1.0;
+    return true;
+}
+
+/**
+ * @brief Цикл фонового потока.
+ */
+void ShadowExecutor::Run() {
+    ShadowTask task;
+    for (;;) {
+        // Признак читаем до опустошения очереди: после него новых запросов уже не будет
+        const bool stopping = stopping_.load(std::memory_order_acquire);
+        bool popped = false;
+        while (tasks_.TryPop(task)) {
+            popped = true;
+            Execute(task);
+        }
+        if (stopping) {
+            break;
+        }
+        if (!popped) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+/**
+ * @brief Выполняет теневой запрос и сравнивает результаты.
+ */
+void ShadowExecutor::Execute(ShadowTask& task) {
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<Document> shadow_result;
+    try {
+        shadow_result = shadow_engine_(task.raw_query, task.status);
+    } catch (...) {
+        failed_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    const auto shadow_time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start);
+    executed_.fetch_add(1, std::memory_order_relaxed);
+    primary_time_.fetch_add(task.primary_time.count(), std::memory_order_relaxed);
+    shadow_time_.fetch_add(shadow_time.count(), std::memory_order_relaxed);
+
+    std::vector<int> shadow_ids;
+    shadow_ids.reserve(shadow_result.size());
+    for (const Document& document : shadow_result) {
+        shadow_ids.push_back(document.id);
+    }
+    if (shadow_ids == task.primary_ids) {
+        return;
+    }
+    mismatched_.fetch_add(1, std::memory_order_relaxed);
+
+    std::vector<int> primary_sorted = task.primary_ids;
+    std::vector<int> shadow_sorted = shadow_ids;
+    std::sort(primary_sorted.begin(), primary_sorted.end());
+    std::sort(shadow_sorted.begin(), shadow_sorted.end());
+    std::vector<int> common;
+    std::set_intersection(primary_sorted.begin(), primary_sorted.end(), shadow_sorted.begin(), shadow_sorted.end(),
+                          std::back_inserter(common));
+
+    ShadowMismatch mismatch;
+    mismatch.raw_query = std::move(task.raw_query);
+    mismatch.status = task.status;
+    mismatch.primary_ids = std::move(task.primary_ids);
+    mismatch.shadow_ids = std::move(shadow_ids);
+    mismatch.common_count = common.size();
+    mismatch.primary_time = task.primary_time;
+    mismatch.shadow_time = shadow_time;
+    mismatches_.TryPush(mismatch);
+}
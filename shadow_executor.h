@@ -0,0 +1,156 @@
+/**
+ * @file shadow_executor.h
+ * @brief Содержит теневое выполнение запросов альтернативным движком для сравнения с основным.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.h"
+#include "document.h"
+
+/**
+ * @brief Альтернативный движок: выполняет запрос с фильтром по статусу.
+ */
+using QueryEngine = std::function<std::vector<Document>(const std::string& raw_query, DocumentStatus status)>;
+
+/**
+ * @brief Параметры теневого выполнения.
+ */
+struct ShadowOptions {
+    double sample_rate = 0.01;          ///< Доля запросов, повторяемых теневым движком.
+    size_t max_queries_per_second = 100;///< Максимальное количество теневых запросов в секунду.
+    size_t queue_capacity = 1024;       ///< Вместимость очереди теневых запросов; степень двойки.
+    size_t mismatch_capacity = 256;     ///< Вместимость буфера расхождений; степень двойки.
+};
+
+/**
+ * @brief Статистика теневого выполнения.
+ */
+struct ShadowStats {
+    uint64_t sampled = 0;                       ///< Запросы, выбранные для теневого выполнения.
+    uint64_t rate_limited = 0;                  ///< Выбранные запросы, отброшенные ограничением частоты.
+    uint64_t queue_full = 0;                    ///< Выбранные запросы, отброшенные из-за заполненной очереди.
+    uint64_t executed = 0;                      ///< Выполненные теневые запросы.
+    uint64_t failed = 0;                        ///< Теневые запросы, завершившиеся исключением.
+    uint64_t mismatched = 0;                    ///< Запросы, результаты которых различаются.
+    std::chrono::nanoseconds primary_time{0};   ///< Суммарное время основного движка на выполненных запросах.
+    std::chrono::nanoseconds shadow_time{0};    ///< Суммарное время теневого движка.
+};
+
+/**
+ * @brief Расхождение результатов основного и теневого движков.
+ */
+struct ShadowMismatch {
+    std::string raw_query;                          ///< Необработанный запрос.
+    DocumentStatus status = DocumentStatus::ACTUAL; ///< Статус документов запроса.
+    std::vector<int> primary_ids;                   ///< Идентификаторы результата основного движка.
+    std::vector<int> shadow_ids;                    ///< Идентификаторы результата теневого движка.
+    size_t common_count = 0;                        ///< Количество документов, найденных обоими движками.
+    std::chrono::nanoseconds primary_time{0};       ///< Время основного движка.
+    std::chrono::nanoseconds shadow_time{0};        ///< Время теневого движка.
+};
+
+/**
+ * @brief Повторяет выборку запросов альтернативным движком в фоновом потоке и сравнивает результаты.
+ * @details Submit вызывается на пути ответа: невыбранный запрос стоит одного случайного числа,
+ *          выбранный - ещё проверки ограничения частоты и копирования идентификаторов результата
+ *          в неблокирующую очередь. Теневые запросы выполняет один фоновый поток, поэтому они
+ *          занимают не больше одного ядра и не больше max_queries_per_second запросов в секунду.
+ *          Результаты совпадают, если совпадают идентификаторы в том же порядке.
+ */
+class ShadowExecutor {
+public:
+    /**
+     * @brief Конструктор класса ShadowExecutor: запускает фоновый поток.
+     * @param shadow_engine Теневой движок; не должен сам отправлять запросы в этот же ShadowExecutor.
+     * @param options Параметры теневого выполнения.
+     * @throws invalid_argument Если доля выборки вне [0, 1] или вместимости не степени двойки.
+     */
+    explicit ShadowExecutor(QueryEngine shadow_engine, const ShadowOptions& options = {});
+
+    ShadowExecutor(const ShadowExecutor&) = delete;
+    ShadowExecutor& operator=(const ShadowExecutor&) = delete;
+
+    /**
+     * @brief Деструктор: дожидается выполнения поставленных в очередь запросов.
+     */
+    ~ShadowExecutor();
+
+    /**
+     * @brief Предлагает запрос основного движка для теневого выполнения.
+     * @param raw_query Необработанный запрос.
+     * @param status Статус документов запроса.
+     * @param primary_result Результат основного движка.
+     * @param primary_time Время основного движка.
+     */
+    void Submit(const std::string& raw_query, DocumentStatus status, const std::vector<Document>& primary_result,
+                std::chrono::nanoseconds primary_time);
+
+    /**
+     * @brief Возвращает статистику теневого выполнения.
+     * @return Статистика.
+     */
+    ShadowStats GetStats() const;
+
+    /**
+     * @brief Забирает накопленные расхождения; лишние расхождения отбрасываются, но учитываются в статистике.
+     * @return Расхождения в порядке обнаружения.
+     */
+    std::vector<ShadowMismatch> DrainMismatches();
+
+private:
+    /**
+     * @brief Запрос, ожидающий теневого выполнения.
+     */
+    struct ShadowTask {
+        std::string raw_query;                          ///< Необработанный запрос.
+        DocumentStatus status = DocumentStatus::ACTUAL; ///< Статус документов запроса.
+        std::vector<int> primary_ids;                   ///< Идентификаторы результата основного движка.
+        std::chrono::nanoseconds primary_time{0};       ///< Время основного движка.
+    };
+
+    QueryEngine shadow_engine_;                             ///< Теневой движок.
+    ShadowOptions options_;                                 ///< Параметры.
+    BoundedQueue<ShadowTask> tasks_;                        ///< Очередь теневых запросов.
+    BoundedQueue<ShadowMismatch> mismatches_;               ///< Найденные расхождения.
+
+    std::mutex rate_mutex_;                                 ///< Мьютекс ограничения частоты.
+    std::chrono::steady_clock::time_point rate_refill_;     ///< Время последнего пополнения разрешений.
+    double rate_tokens_;                                    ///< Доступные разрешения на теневые запросы.
+
+    std::atomic<uint64_t> sampled_{0};                      ///< Выбранные запросы.
+    std::atomic<uint64_t> rate_limited_{0};                 ///< Отброшенные ограничением частоты.
+    std::atomic<uint64_t> queue_full_{0};                   ///< Отброшенные из-за заполненной очереди.
+    std::atomic<uint64_t> executed_{0};                     ///< Выполненные теневые запросы.
+    std::atomic<uint64_t> failed_{0};                       ///< Завершившиеся исключением.
+    std::atomic<uint64_t> mismatched_{0};                   ///< Запросы с расхождениями.
+    std::atomic<int64_t> primary_time_{0};                  ///< Время основного движка, нс.
+    std::atomic<int64_t> shadow_time_{0};                   ///< Время теневого движка, нс.
+
+    std::atomic<bool> stopping_{false};                     ///< Признак остановки.
+    std::thread worker_;                                    ///< Фоновый поток.
+
+    /**
+     * @brief Проверяет ограничение частоты и расходует разрешение.
+     */
+    bool TryAcquireRate();
+
+    /**
+     * @brief Цикл фонового потока.
+     */
+    void Run();
+
+    /**
+     * @brief Выполняет теневой запрос и сравнивает результаты.
+     */
+    void Execute(ShadowTask& task);
+};
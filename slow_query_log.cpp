@@ -0,0 +1,56 @@
+#include "slow_query_log.h"
+
+#include <utility>
+
+/**
+ * @brief Конструктор класса SlowQueryLog.
+ * @param threshold Время запроса, начиная с которого он считается медленным.
+ * @param capacity Вместимость буфера; степень двойки.
+ * @throws invalid_argument Если вместимость не является степенью двойки.
+ */
+SlowQueryLog::SlowQueryLog(std::chrono::nanoseconds threshold, size_t capacity)
+        : threshold_(threshold)
+        , records_(capacity) {
+}
+
+/**
+ * @brief Возвращает порог медленного запроса.
+ * @return Порог.
+ */
+std::chrono::nanoseconds SlowQueryLog::GetThreshold() const {
+    return threshold_;
+}
+
+/**
+ * @brief Сохраняет запись о медленном запросе.
+ * @param record Запись; перемещается только при успехе.
+ * @return true, если запись сохранена; false, если буфер заполнен.
+ */
+bool SlowQueryLog::Push(SlowQueryRecord& record) {
+    if (!records_.TryPush(record)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Забирает все накопленные записи.
+ * @return Записи в порядке сохранения.
+ */
+std::vector<SlowQueryRecord> SlowQueryLog::Drain() {
+    std::vector<SlowQueryRecord> result;
+    SlowQueryRecord record;
+    while (records_.TryPop(record)) {
+        result.push_back(std::move(record));
+    }
+    return result;
+}
+
+/**
+ * @brief Возвращает количество отброшенных записей.
+ * @return Количество записей, не поместившихся в буфер.
+ */
+uint64_t SlowQueryLog::GetDroppedCount() const {
+    return dropped_.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,86 @@
+/**
+ * @file slow_query_log.h
+ * @brief Содержит журнал медленных запросов с разбивкой времени по этапам.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "bounded_queue.h"
+
+/**
+ * @brief Слово медленного запроса.
+ */
+struct SlowQueryTerm {
+    std::string word;           ///< Слово.
+    bool is_minus = false;      ///< Является ли слово минус-словом.
+    size_t document_freq = 0;   ///< Количество документов со словом (длина списка словопозиций).
+};
+
+/**
+ * @brief Запись о медленном запросе.
+ */
+struct SlowQueryRecord {
+    std::string raw_query;                  ///< Необработанный запрос.
+    std::vector<SlowQueryTerm> terms;       ///< Разобранные плюс- и минус-слова.
+    size_t postings_scanned = 0;            ///< Количество просмотренных словопозиций.
+    size_t candidates_scored = 0;           ///< Количество документов, получивших релевантность.
+    size_t result_count = 0;                ///< Количество документов в результате.
+    std::chrono::nanoseconds parse_time{0}; ///< Время разбора запроса.
+    std::chrono::nanoseconds score_time{0}; ///< Время вычисления релевантности.
+    std::chrono::nanoseconds select_time{0};///< Время отбора лучших документов.
+    std::chrono::nanoseconds total_time{0}; ///< Общее время запроса.
+};
+
+/**
+ * @brief Ограниченный буфер записей о медленных запросах.
+ * @details Запросы пишут в буфер без блокировок; при переполнении запись отбрасывается и
+ *          учитывается в GetDroppedCount. Записи забираются методом Drain.
+ */
+class SlowQueryLog {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 1024;   ///< Вместимость буфера по умолчанию.
+
+    /**
+     * @brief Конструктор класса SlowQueryLog.
+     * @param threshold Время запроса, начиная с которого он считается медленным.
+     * @param capacity Вместимость буфера; степень двойки.
+     * @throws invalid_argument Если вместимость не является степенью двойки.
+     */
+    SlowQueryLog(std::chrono::nanoseconds threshold, size_t capacity);
+
+    /**
+     * @brief Возвращает порог медленного запроса.
+     * @return Порог.
+     */
+    std::chrono::nanoseconds GetThreshold() const;
+
+    /**
+     * @brief Сохраняет запись о медленном запросе.
+     * @param record Запись; перемещается только при успехе.
+     * @return true, если запись сохранена; false, если буфер заполнен.
+     */
+    bool Push(SlowQueryRecord& record);
+
+    /**
+     * @brief Забирает все накопленные записи.
+     * @return Записи в порядке сохранения.
+     */
+    std::vector<SlowQueryRecord> Drain();
+
+    /**
+     * @brief Возвращает количество отброшенных записей.
+     * @return Количество записей, не поместившихся в буфер.
+     */
+    uint64_t GetDroppedCount() const;
+
+private:
+    std::chrono::nanoseconds threshold_;        ///< Порог медленного запроса.
+    BoundedQueue<SlowQueryRecord> records_;     ///< Записи.
+    std::atomic<uint64_t> dropped_{0};          ///< Количество отброшенных записей.
+};
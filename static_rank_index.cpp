@@ -0,0 +1,95 @@
+#include "static_rank_index.h"
+
+#include <algorithm>
+
+/**
+ * @brief Строит индекс.
+ * @param static_score Функция статической оценки.
+ * @param document_ratings Рейтинги документов по идентификаторам.
+ * @param word_to_document_freqs Частоты слов в документах.
+ */
+StaticRankIndex::StaticRankIndex(StaticScore static_score, const std::map<int, int>& document_ratings,
+                                 const CowMap<std::string_view, CowMap<int, double>>& word_to_document_freqs)
+        : static_score_(std::move(static_score)) {
+    // Устойчивая сортировка сохраняет порядок идентификаторов при равных оценках
+    std::vector<std::pair<double, int>> ordered;
+    ordered.reserve(document_ratings.size());
+    for (const auto& [document_id, rating] : document_ratings) {
+        ordered.emplace_back(static_score_(document_id, rating), document_id);
+    }
+    std::stable_sort(ordered.begin(), ordered.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first > rhs.first;
+    });
+
+    ids_.reserve(ordered.size());
+    static_scores_.reserve(ordered.size());
+    for (const auto& [score, document_id] : ordered) {
+        ranks_.emplace(document_id, static_cast<uint32_t>(ids_.size()));
+        ids_.push_back(document_id);
+        static_scores_.push_back(score);
+    }
+
+    for (const auto& [word, document_freqs] : word_to_document_freqs) {
+        PostingList& list = lists_[word];
+        list.postings.reserve(document_freqs.size());
+        for (const auto& [document_id, term_freq] : document_freqs) {
+            list.postings.push_back({ranks_.at(document_id), term_freq});
+        }
+        std::sort(list.postings.begin(), list.postings.end(), [](const Posting& lhs, const Posting& rhs) {
+            return lhs.rank < rhs.rank;
+        });
+
+        // Граница блока учитывает и все следующие блоки, поэтому не растёт по мере продвижения по списку
+        list.block_max_freqs.resize((list.postings.size() + BLOCK_SIZE - 1) / BLOCK_SIZE);
+        double max_freq = 0.0;
+        for (size_t block = list.block_max_freqs.size(); block-- > 0;) {
+            const size_t end = std::min(list.postings.size(), (block + 1) * BLOCK_SIZE);
+            for (size_t i = block * BLOCK_SIZE; i < end; ++i) {
+                max_freq = std::max(max_freq, list.postings[i].term_freq);
+            }
+            list.block_max_freqs[block] = max_freq;
+        }
+    }
+}
+
+/**
+ * @brief Добавляет документ, появившийся после построения индекса.
+ * @param document_id Идентификатор документа, отсутствующего в индексе.
+ * @param rating Рейтинг документа.
+ * @param word_freqs Частоты слов документа.
+ */
+void StaticRankIndex::Add(int document_id, int rating, const std::map<std::string_view, double>& word_freqs) {
+    unranked_[document_id] = {static_score_(document_id, rating), word_freqs};
+}
+
+/**
+ * @brief Удаляет документ; отсутствующий документ игнорируется.
+ * @param document_id Идентификатор документа.
+ */
+void StaticRankIndex::Remove(int document_id) {
+    if (unranked_.erase(document_id) > 0) {
+        return;
+    }
+    const auto it = ranks_.find(document_id);
+    if (it != ranks_.end()) {
+        ids_[it->second] = -1;
+        ranks_.erase(it);
+    }
+}
+
+/**
+ * @brief Проверяет, есть ли у слова упорядоченный список.
+ * @param word Слово.
+ * @return true, если список есть.
+ */
+bool StaticRankIndex::HasWord(std::string_view word) const {
+    return lists_.count(word) > 0;
+}
+
+/**
+ * @brief Возвращает количество документов, добавленных после построения.
+ * @return Количество документов вне упорядоченных списков.
+ */
+size_t StaticRankIndex::GetUnrankedCount() const {
+    return unranked_.size();
+}
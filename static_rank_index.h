@@ -0,0 +1,229 @@
+/**
+ * @file static_rank_index.h
+ * @brief Содержит индекс, упорядоченный по статической оценке документов, с ранней остановкой поиска.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <queue>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "cow_shared.h"
+#include "ranking.h"
+
+/**
+ * @brief Инвертированный индекс, в котором документы пронумерованы по убыванию статической оценки.
+ * @details Статическая оценка не зависит от запроса: по умолчанию это взвешенный рейтинг, но её
+ *          можно задать функцией. Оценка документа в поиске - сумма TF-IDF по плюс-словам запроса
+ *          и статической оценки; TF-IDF считается так же, как в основном поиске (ComputeTermRelevance по тем же
+ *          частотам), поэтому релевантность документа совпадает с FindTopDocuments. Списки слов упорядочены по номеру документа, то есть по убыванию
+ *          статической оценки, и для каждого блока из BLOCK_SIZE словопозиций хранится наибольшая
+ *          частота слова в этом и следующих блоках. Поиск идёт по всем спискам одновременно и
+ *          останавливается, как только верхняя граница оценки непросмотренных документов станет
+ *          меньше count-й лучшей оценки, поэтому для частых запросов просматривается лишь начало
+ *          списков. Документы, добавленные после построения, хранятся отдельно и просматриваются
+ *          целиком; удалённые помечаются и пропускаются. Если таких документов много, индекс
+ *          следует перестроить.
+ */
+class StaticRankIndex {
+public:
+    /**
+     * @brief Количество словопозиций в блоке, для которого хранится верхняя граница частоты.
+     */
+    static const size_t BLOCK_SIZE = 128;
+
+    /**
+     * @brief Функция статической оценки документа по идентификатору и рейтингу.
+     */
+    using StaticScore = std::function<double(int document_id, int rating)>;
+
+    /**
+     * @brief Слово запроса с обратной частотой документа.
+     */
+    struct Term {
+        std::string_view word;          ///< Слово.
+        double inverse_document_freq;   ///< Обратная частота документа для слова.
+    };
+
+    /**
+     * @brief Результат поиска.
+     */
+    struct SearchResult {
+        std::vector<std::pair<int, double>> documents;  ///< Оценённые документы в порядке просмотра; лучшие count среди них.
+        size_t postings_scanned = 0;                    ///< Количество просмотренных словопозиций.
+        size_t postings_total = 0;                      ///< Общая длина списков слов запроса.
+    };
+
+    /**
+     * @brief Строит индекс.
+     * @param static_score Функция статической оценки.
+     * @param document_ratings Рейтинги документов по идентификаторам.
+     * @param word_to_document_freqs Частоты слов в документах.
+     */
+    StaticRankIndex(StaticScore static_score, const std::map<int, int>& document_ratings,
+                    const CowMap<std::string_view, CowMap<int, double>>& word_to_document_freqs);
+
+    /**
+     * @brief Добавляет документ, появившийся после построения индекса.
+     * @param document_id Идентификатор документа, отсутствующего в индексе.
+     * @param rating Рейтинг документа.
+     * @param word_freqs Частоты слов документа.
+     */
+    void Add(int document_id, int rating, const std::map<std::string_view, double>& word_freqs);
+
+    /**
+     * @brief Удаляет документ; отсутствующий документ игнорируется.
+     * @param document_id Идентификатор документа.
+     */
+    void Remove(int document_id);
+
+    /**
+     * @brief Проверяет, есть ли у слова упорядоченный список.
+     * @details Списки не удаляются вместе с документами, поэтому ключи списков могут ссылаться на слова,
+     *          которых уже нет в индексе поисковой системы.
+     * @param word Слово.
+     * @return true, если список есть.
+     */
+    bool HasWord(std::string_view word) const;
+
+    /**
+     * @brief Находит документы с наибольшей суммой релевантности и статической оценки.
+     * @tparam DocPredicate Тип предиката, принимающего идентификатор документа.
+     * @param terms Плюс-слова запроса.
+     * @param count Количество лучших документов, после которого допустима ранняя остановка.
+     * @param accept Предикат: может ли документ попасть в результат.
+     * @return Оценённые документы; среди них есть count лучших, если столько нашлось.
+     */
+    template <typename DocPredicate>
+    SearchResult Search(const std::vector<Term>& terms, size_t count, DocPredicate accept) const;
+
+    /**
+     * @brief Возвращает количество документов, добавленных после построения.
+     * @return Количество документов вне упорядоченных списков.
+     */
+    size_t GetUnrankedCount() const;
+
+private:
+    /**
+     * @brief Словопозиция: номер документа и частота слова в нём.
+     */
+    struct Posting {
+        uint32_t rank;      ///< Номер документа по убыванию статической оценки.
+        double term_freq;   ///< Частота слова в документе, как в основном индексе.
+    };
+
+    /**
+     * @brief Список слова с верхними границами частоты по блокам.
+     */
+    struct PostingList {
+        std::vector<Posting> postings;      ///< Словопозиции по возрастанию номера.
+        std::vector<double> block_max_freqs; ///< Наибольшая частота в блоке и всех следующих.
+    };
+
+    /**
+     * @brief Документ, добавленный после построения.
+     */
+    struct UnrankedDocument {
+        double static_score;                            ///< Статическая оценка.
+        std::map<std::string_view, double> word_freqs;  ///< Частоты слов.
+    };
+
+    StaticScore static_score_;                          ///< Функция статической оценки.
+    std::vector<int> ids_;                              ///< Идентификаторы документов по номерам; -1 - удалён.
+    std::vector<double> static_scores_;                 ///< Статические оценки по номерам, по невозрастанию.
+    std::map<int, uint32_t> ranks_;                     ///< Номер каждого документа упорядоченной части.
+    std::map<std::string_view, PostingList> lists_;     ///< Списки слов.
+    std::map<int, UnrankedDocument> unranked_;          ///< Документы, добавленные после построения.
+};
+
+template <typename DocPredicate>
+StaticRankIndex::SearchResult StaticRankIndex::Search(const std::vector<Term>& terms, size_t count,
+                                                      DocPredicate accept) const {
+    SearchResult result;
+    if (count == 0) {
+        return result;
+    }
+
+    // Оценки лучших count документов; вершина - порог, который нужно превзойти
+    std::priority_queue<double, std::vector<double>, std::greater<>> top_scores;
+    const auto offer = [&](int document_id, double score) {
+        result.documents.emplace_back(document_id, score);
+        top_scores.push(score);
+        if (top_scores.size() > count) {
+            top_scores.pop();
+        }
+    };
+
+    // Документы вне упорядоченной части просматриваются первыми, чтобы сразу поднять порог
+    for (const auto& [document_id, document] : unranked_) {
+        double relevance = 0.0;
+        bool matched = false;
+        for (const Term& term : terms) {
+            const auto it = document.word_freqs.find(term.word);
+            if (it != document.word_freqs.end()) {
+                relevance += ComputeTermRelevance(it->second, term.inverse_document_freq);
+                matched = true;
+            }
+        }
+        if (matched && accept(document_id)) {
+            offer(document_id, relevance + document.static_score);
+        }
+    }
+
+    struct Cursor {
+        const PostingList* list;
+        size_t position;
+        double inverse_document_freq;
+    };
+    std::vector<Cursor> cursors;
+    for (const Term& term : terms) {
+        const auto it = lists_.find(term.word);
+        if (it != lists_.end()) {
+            cursors.push_back({&it->second, 0, term.inverse_document_freq});
+            result.postings_total += it->second.postings.size();
+        }
+    }
+
+    while (true) {
+        uint32_t rank = std::numeric_limits<uint32_t>::max();
+        double relevance_bound = 0.0;
+        for (const Cursor& cursor : cursors) {
+            if (cursor.position < cursor.list->postings.size()) {
+                rank = std::min(rank, cursor.list->postings[cursor.position].rank);
+                relevance_bound += ComputeTermRelevance(cursor.list->block_max_freqs[cursor.position / BLOCK_SIZE],
+                                                        cursor.inverse_document_freq);
+            }
+        }
+        if (rank == std::numeric_limits<uint32_t>::max()) {
+            break;
+        }
+        // Статические оценки дальше по спискам не больше текущей. Сравнение в точности float, как
+        // в ключе ранжирования: документ с равной в этой точности оценкой может обойти порог по рейтингу
+        if (top_scores.size() == count
+            && static_cast<float>(relevance_bound + static_scores_[rank]) < static_cast<float>(top_scores.top())) {
+            break;
+        }
+
+        double relevance = 0.0;
+        for (Cursor& cursor : cursors) {
+            if (cursor.position < cursor.list->postings.size() && cursor.list->postings[cursor.position].rank == rank) {
+                relevance += ComputeTermRelevance(cursor.list->postings[cursor.position].term_freq,
+                                                  cursor.inverse_document_freq);
+                ++cursor.position;
+                ++result.postings_scanned;
+            }
+        }
+        const int document_id = ids_[rank];
+        if (document_id >= 0 && accept(document_id)) {
+            offer(document_id, relevance + static_scores_[rank]);
+        }
+    }
+    return result;
+}
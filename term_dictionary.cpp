@@ -0,0 +1,132 @@
+#include "term_dictionary.h"
+
+/**
+ * @brief Возвращает слово словаря, добавляя его при отсутствии.
+ * @param word Слово.
+ * @return Ссылка на слово, действительная, пока жив словарь.
+ */
+std::string_view TermDictionary::Intern(std::string_view word) {
+    std::lock_guard guard(mutex_);
+    Term& term = terms_[FindOrAdd(word)];
+    term.is_interned = true;
+    return term.word;
+}
+
+/**
+ * @brief Добавляет ссылку на слово, добавляя слово при отсутствии.
+ * @param word Слово.
+ * @return Идентификатор слова.
+ */
+TermDictionary::TermId TermDictionary::Acquire(std::string_view word) {
+    std::lock_guard guard(mutex_);
+    const TermId id = FindOrAdd(word);
+    ++terms_[id].references;
+    return id;
+}
+
+/**
+ * @brief Освобождает ссылку на слово; слово без ссылок удаляется.
+ * @param term Идентификатор слова.
+ */
+void TermDictionary::Release(TermId term) {
+    std::lock_guard guard(mutex_);
+    Term& entry = terms_[term];
+    if (--entry.references > 0 || entry.is_interned) {
+        return;
+    }
+    ids_.erase(ids_.find(entry.word));
+    entry = Term();
+    free_ids_.push_back(term);
+}
+
+/**
+ * @brief Ищет слово.
+ * @param word Слово.
+ * @return Идентификатор слова или nullopt.
+ */
+std::optional<TermDictionary::TermId> TermDictionary::Find(std::string_view word) const {
+    std::lock_guard guard(mutex_);
+    const auto it = ids_.find(word);
+    if (it == ids_.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+/**
+ * @brief Удаляет слова Intern без ссылок Acquire, которые больше не используются.
+ * @param is_used Возвращает true для используемых слов.
+ * @return Количество удалённых слов; 0, если у словаря несколько владельцев.
+ */
+size_t TermDictionary::RemoveUnused(const std::function<bool(std::string_view)>& is_used) {
+    std::lock_guard guard(mutex_);
+    if (owners_ > 1) {
+        return 0;
+    }
+    size_t removed_count = 0;
+    for (auto it = ids_.begin(); it != ids_.end();) {
+        const TermId id = it->second;
+        Term& term = terms_[id];
+        if (term.references > 0 || is_used(term.word)) {
+            ++it;
+            continue;
+        }
+        it = ids_.erase(it);
+        term = Term();
+        free_ids_.push_back(id);
+        ++removed_count;
+    }
+    return removed_count;
+}
+
+/**
+ * @brief Возвращает количество слов.
+ * @return Количество слов.
+ */
+size_t TermDictionary::GetSize() const {
+    std::lock_guard guard(mutex_);
+    return ids_.size();
+}
+
+/**
+ * @brief Возвращает идентификатор слова, добавляя слово при отсутствии.
+ * @param word Слово.
+ * @return Идентификатор слова.
+ */
+TermDictionary::TermId TermDictionary::FindOrAdd(std::string_view word) {
+    auto it = ids_.find(word);
+    if (it != ids_.end()) {
+        return it->second;
+    }
+    TermId id;
+    if (free_ids_.empty()) {
+        id = static_cast<TermId>(terms_.size());
+        terms_.emplace_back();
+    } else {
+        id = free_ids_.back();
+        free_ids_.pop_back();
+    }
+    it = ids_.emplace(word, id).first;
+    terms_[id].word = it->first;
+    return id;
+}
+
+SharedTermDictionary::SharedTermDictionary()
+        : dictionary_(std::make_shared<TermDictionary>()) {
+    dictionary_->owners_ = 1;
+}
+
+SharedTermDictionary::SharedTermDictionary(const SharedTermDictionary& other)
+        : dictionary_(other.dictionary_) {
+    if (dictionary_) {
+        std::lock_guard guard(dictionary_->mutex_);
+        ++dictionary_->owners_;
+    }
+}
+
+SharedTermDictionary::~SharedTermDictionary() {
+    if (dictionary_) {
+        std::lock_guard guard(dictionary_->mutex_);
+        --dictionary_->owners_;
+    }
+}
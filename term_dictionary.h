@@ -0,0 +1,131 @@
+/**
+ * @file term_dictionary.h
+ * @brief Содержит словарь слов, разделяемый копиями поисковой системы и коллекциями.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Пополняемый словарь слов с постоянными адресами и идентификаторами.
+ * @details Индексы поисковой системы хранят string_view на слова словаря, поэтому копии
+ *          поисковой системы, разделяющие словарь, можно копировать без перестройки ссылок.
+ *          Слова, полученные через Intern, удаляются только RemoveUnused. Слова, полученные через
+ *          Acquire, считаются по ссылкам и удаляются вместе с последней ссылкой; их идентификаторы
+ *          используются повторно. Все методы потокобезопасны.
+ */
+class TermDictionary {
+public:
+    using TermId = uint32_t;    ///< Идентификатор слова.
+
+    /**
+     * @brief Возвращает слово словаря, добавляя его при отсутствии.
+     * @details Слово не удаляется из словаря после Release всех ссылок Acquire, а только RemoveUnused.
+     * @param word Слово.
+     * @return Ссылка на слово, действительная, пока жив словарь и слово не удалено RemoveUnused.
+     */
+    std::string_view Intern(std::string_view word);
+
+    /**
+     * @brief Добавляет ссылку на слово, добавляя слово при отсутствии.
+     * @param word Слово.
+     * @return Идентификатор слова, действительный до освобождения ссылки.
+     */
+    TermId Acquire(std::string_view word);
+
+    /**
+     * @brief Освобождает ссылку на слово; слово без ссылок удаляется.
+     * @param term Идентификатор слова, полученный через Acquire.
+     */
+    void Release(TermId term);
+
+    /**
+     * @brief Ищет слово.
+     * @param word Слово.
+     * @return Идентификатор слова или nullopt, если слова нет.
+     */
+    std::optional<TermId> Find(std::string_view word) const;
+
+    /**
+     * @brief Удаляет слова Intern без ссылок Acquire, которые больше не используются.
+     * @details Выполняется, только если у словаря не больше одного владельца SharedTermDictionary:
+     *          слова разделяемого словаря могут использоваться другими владельцами. Проверяет
+     *          все слова под мьютексом словаря.
+     * @param is_used Возвращает true для слов, на которые ещё ссылается владелец.
+     * @return Количество удалённых слов.
+     */
+    size_t RemoveUnused(const std::function<bool(std::string_view)>& is_used);
+
+    /**
+     * @brief Возвращает количество слов.
+     * @return Количество слов.
+     */
+    size_t GetSize() const;
+
+private:
+    friend class SharedTermDictionary;
+
+    /**
+     * @brief Слово с количеством ссылок.
+     */
+    struct Term {
+        std::string_view word;      ///< Слово; ключ ids_.
+        size_t references = 0;      ///< Количество ссылок; 0 - идентификатор свободен.
+        bool is_interned = false;   ///< Получено ли слово через Intern и потому не удаляется.
+    };
+
+    mutable std::mutex mutex_;                          ///< Мьютекс словаря.
+    std::map<std::string, TermId, std::less<>> ids_;    ///< Идентификаторы слов.
+    std::vector<Term> terms_;                           ///< Слова по идентификатору.
+    std::vector<TermId> free_ids_;                      ///< Свободные идентификаторы.
+    size_t owners_ = 0;                                 ///< Количество владельцев SharedTermDictionary.
+
+    /**
+     * @brief Возвращает идентификатор слова, добавляя слово при отсутствии; вызывается под мьютексом.
+     * @param word Слово.
+     * @return Идентификатор слова.
+     */
+    TermId FindOrAdd(std::string_view word);
+};
+
+/**
+ * @brief Словарь, разделяемый копиями владельца, с явным счётом владельцев.
+ * @details Копирование разделяет словарь и увеличивает счётчик владельцев, уничтожение - уменьшает.
+ *          Счётчик изменяется под мьютексом словаря, поэтому чтения слов копией, уничтоженной в другом
+ *          потоке, завершаются до того, как RemoveUnused единственного оставшегося владельца удалит слова.
+ */
+class SharedTermDictionary {
+public:
+    SharedTermDictionary();
+
+    SharedTermDictionary(const SharedTermDictionary& other);
+
+    SharedTermDictionary(SharedTermDictionary&& other) noexcept = default;
+
+    SharedTermDictionary& operator=(SharedTermDictionary other) noexcept {
+        std::swap(dictionary_, other.dictionary_);
+        return *this;
+    }
+
+    ~SharedTermDictionary();
+
+    TermDictionary& operator*() const {
+        return *dictionary_;
+    }
+
+    TermDictionary* operator->() const {
+        return dictionary_.get();
+    }
+
+private:
+    std::shared_ptr<TermDictionary> dictionary_;    ///< Словарь; пуст после перемещения.
+};
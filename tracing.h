@@ -0,0 +1,32 @@
+/**
+ * @file tracing.h
+ * @brief Содержит статические точки трассировки (USDT) для bpftrace, perf и SystemTap.
+ *
+ * Если при сборке доступен заголовок <sys/sdt.h> (пакет systemtap-sdt-dev), точки компилируются
+ * в инструкцию nop и запись в секции .note.stapsdt; пока к процессу не подключён трассировщик,
+ * аргументы не вычисляются сверх обычных регистровых пересылок. Без заголовка или при
+ * определённом SEARCH_SERVER_NO_TRACING точки не генерируют кода.
+ *
+ * Провайдер точек - search_server, например:
+ * @code
+ * bpftrace -e 'usdt:./search_server:search_server:query__done { @[str(arg0)] = count(); }'
+ * @endcode
+ */
+
+#pragma once
+
+#if !defined(SEARCH_SERVER_NO_TRACING) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define SEARCH_SERVER_TRACING 1
+#endif
+#endif
+
+#ifdef SEARCH_SERVER_TRACING
+/**
+ * @brief Точка трассировки провайдера search_server с именем name и аргументами (не больше 12).
+ */
+#define SEARCH_TRACE(name, ...) STAP_PROBEV(search_server, name, ##__VA_ARGS__)
+#else
+#define SEARCH_TRACE(name, ...) ((void)0)
+#endif
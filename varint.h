@@ -0,0 +1,68 @@
+/**
+ * @file varint.h
+ * @brief Содержит функции кодирования целых чисел переменной длины (varint).
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Дописывает беззнаковое число в буфер в формате varint.
+ *
+ * Число записывается группами по 7 бит, начиная с младших; старший бит каждого байта
+ * указывает, что за ним следует продолжение.
+ *
+ * @param out Буфер, в который дописывается число.
+ * @param value Записываемое число.
+ */
+inline void AppendVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+/**
+ * @brief Отображает знаковое число в беззнаковое так, что малые по модулю числа остаются малыми.
+ * @param value Знаковое число.
+ * @return Число для записи в varint.
+ */
+inline uint64_t ZigzagEncode(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+/**
+ * @brief Обратное преобразование к ZigzagEncode.
+ * @param value Число, считанное из varint.
+ * @return Знаковое число.
+ */
+inline int64_t ZigzagDecode(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+/**
+ * @brief Считывает число в формате varint из начала буфера и сдвигает буфер за него.
+ * @param in Буфер с закодированными данными.
+ * @return Считанное число.
+ * @throws invalid_argument Если буфер закончился посреди числа.
+ */
+inline uint64_t ReadVarint(std::string_view& in) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (in.empty()) {
+            throw std::invalid_argument("Truncated varint");
+        }
+        const auto byte = static_cast<unsigned char>(in.front());
+        in.remove_prefix(1);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    throw std::invalid_argument("Varint is too long");
+}
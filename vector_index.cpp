@@ -0,0 +1,357 @@
+#include "vector_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+/**
+ * @brief Вычисляет скалярное произведение векторов.
+ * @param lhs Первый вектор.
+ * @param rhs Второй вектор.
+ * @param size Размерность.
+ * @return Скалярное произведение.
+ */
+float DotProduct(const float* lhs, const float* rhs, size_t size) {
+    float sums[8] = {};
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        for (size_t lane = 0; lane < 8; ++lane) {
+            sums[lane] += lhs[i + lane] * rhs[i + lane];
+        }
+    }
+    float result = ((sums[0] + sums[1]) + (sums[2] + sums[3])) + ((sums[4] + sums[5]) + (sums[6] + sums[7]));
+    for (; i < size; ++i) {
+        result += lhs[i] * rhs[i];
+    }
+    return result;
+}
+
+/**
+ * @brief Вычисляет скалярное произведение векторов из 8-битных целых.
+ * @param lhs Первый вектор.
+ * @param rhs Второй вектор.
+ * @param size Размерность.
+ * @return Скалярное произведение.
+ */
+int32_t DotProduct(const int8_t* lhs, const int8_t* rhs, size_t size) {
+    int32_t result = 0;
+    for (size_t i = 0; i < size; ++i) {
+        result += static_cast<int32_t>(lhs[i]) * rhs[i];
+    }
+    return result;
+}
+
+namespace {
+
+/**
+ * @brief Квантует вектор в int8 с симметричным масштабом.
+ * @return Масштаб, на который нужно умножить коды, чтобы получить исходные значения.
+ */
+float Quantize(const float* values, size_t size, int8_t* codes) {
+    float max_abs = 0.0f;
+    for (size_t i = 0; i < size; ++i) {
+        max_abs = std::max(max_abs, std::abs(values[i]));
+    }
+    const float scale = max_abs > 0.0f ? max_abs / 127.0f : 1.0f;
+    for (size_t i = 0; i < size; ++i) {
+        codes[i] = static_cast<int8_t>(std::lround(values[i] / scale));
+    }
+    return scale;
+}
+
+} // namespace
+
+/**
+ * @brief Конструктор класса VectorIndex.
+ * @param dimension Размерность векторов.
+ * @param quantize Хранить ли векторы квантованными в int8.
+ * @throws invalid_argument Если размерность равна нулю.
+ */
+VectorIndex::VectorIndex(size_t dimension, bool quantize)
+        : dimension_(dimension)
+        , quantize_(quantize) {
+    if (dimension == 0) {
+        throw std::invalid_argument("Vector dimension must be positive");
+    }
+}
+
+/**
+ * @brief Добавляет или заменяет вектор документа.
+ * @param document_id Идентификатор документа.
+ * @param embedding Вектор документа.
+ * @throws invalid_argument Если размерность вектора не совпадает с размерностью индекса.
+ */
+void VectorIndex::Add(int document_id, const std::vector<float>& embedding) {
+    if (embedding.size() != dimension_) {
+        throw std::invalid_argument("Embedding dimension mismatch");
+    }
+
+    const auto [it, inserted] = rows_.emplace(document_id, static_cast<uint32_t>(ids_.size()));
+    const uint32_t row = it->second;
+    if (inserted) {
+        ids_.push_back(document_id);
+        if (quantize_) {
+            codes_.resize(codes_.size() + dimension_);
+            scales_.push_back(0.0f);
+        } else {
+            vectors_.resize(vectors_.size() + dimension_);
+        }
+    }
+
+    if (quantize_) {
+        scales_[row] = Quantize(embedding.data(), dimension_, codes_.data() + row * dimension_);
+    } else {
+        std::copy(embedding.begin(), embedding.end(), vectors_.begin() + row * dimension_);
+    }
+
+    // После построения списков новый или изменённый вектор сразу попадает в ближайший список
+    if (!lists_.empty()) {
+        if (!inserted) {
+            std::vector<uint32_t>& old_list = lists_[row_lists_[row]];
+            old_list.erase(std::find(old_list.begin(), old_list.end(), row));
+        } else {
+            row_lists_.push_back(0);
+        }
+        AssignRow(row, FindNearestList(embedding.data()));
+    }
+}
+
+/**
+ * @brief Удаляет вектор документа.
+ * @param document_id Идентификатор документа.
+ * @return true, если вектор документа был в индексе.
+ */
+bool VectorIndex::Remove(int document_id) {
+    const auto it = rows_.find(document_id);
+    if (it == rows_.end()) {
+        return false;
+    }
+    const uint32_t row = it->second;
+    const uint32_t last_row = static_cast<uint32_t>(ids_.size() - 1);
+    rows_.erase(it);
+
+    if (!lists_.empty()) {
+        std::vector<uint32_t>& list = lists_[row_lists_[row]];
+        list.erase(std::find(list.begin(), list.end(), row));
+    }
+
+    // Переносим последнюю строку на место удалённой
+    if (row != last_row) {
+        ids_[row] = ids_[last_row];
+        rows_[ids_[row]] = row;
+        if (quantize_) {
+            std::copy_n(codes_.begin() + last_row * dimension_, dimension_, codes_.begin() + row * dimension_);
+            scales_[row] = scales_[last_row];
+        } else {
+            std::copy_n(vectors_.begin() + last_row * dimension_, dimension_, vectors_.begin() + row * dimension_);
+        }
+        if (!lists_.empty()) {
+            row_lists_[row] = row_lists_[last_row];
+            std::vector<uint32_t>& list = lists_[row_lists_[row]];
+            *std::find(list.begin(), list.end(), last_row) = row;
+        }
+    }
+
+    ids_.pop_back();
+    if (quantize_) {
+        codes_.resize(codes_.size() - dimension_);
+        scales_.pop_back();
+    } else {
+        vectors_.resize(vectors_.size() - dimension_);
+    }
+    if (!lists_.empty()) {
+        row_lists_.pop_back();
+    }
+    return true;
+}
+
+/**
+ * @brief Разбивает векторы на списки по центроидам.
+ * @param list_count Количество списков; 0 - корень из количества векторов.
+ * @param iterations Количество итераций k-means.
+ */
+void VectorIndex::Build(size_t list_count, size_t iterations) {
+    const size_t row_count = ids_.size();
+    lists_.clear();
+    centroids_.clear();
+    row_lists_.assign(row_count, 0);
+    if (row_count == 0) {
+        return;
+    }
+    if (list_count == 0) {
+        list_count = static_cast<size_t>(std::sqrt(static_cast<double>(row_count)));
+    }
+    list_count = std::clamp<size_t>(list_count, 1, row_count);
+
+    const auto normalize = [this](float* centroid) {
+        const float norm = std::sqrt(DotProduct(centroid, centroid, dimension_));
+        if (norm > 0.0f) {
+            for (size_t i = 0; i < dimension_; ++i) {
+                centroid[i] /= norm;
+            }
+        }
+    };
+
+    // Начальные центроиды - равномерно выбранные векторы
+    centroids_.resize(list_count * dimension_);
+    for (size_t list = 0; list < list_count; ++list) {
+        const std::vector<float> row = GetRow(static_cast<uint32_t>(list * row_count / list_count));
+        std::copy(row.begin(), row.end(), centroids_.begin() + list * dimension_);
+        normalize(centroids_.data() + list * dimension_);
+    }
+    lists_.resize(list_count);
+
+    std::vector<std::vector<float>> rows(row_count);
+    for (uint32_t row = 0; row < row_count; ++row) {
+        rows[row] = GetRow(row);
+    }
+    for (size_t iteration = 0; iteration <= iterations; ++iteration) {
+        for (uint32_t row = 0; row < row_count; ++row) {
+            row_lists_[row] = FindNearestList(rows[row].data());
+        }
+        if (iteration == iterations) {
+            break;
+        }
+
+        // Центроид - нормированное среднее векторов списка; пустой список сохраняет прежний центроид
+        std::vector<float> sums(list_count * dimension_, 0.0f);
+        std::vector<size_t> sizes(list_count, 0);
+        for (uint32_t row = 0; row < row_count; ++row) {
+            float* sum = sums.data() + row_lists_[row] * dimension_;
+            for (size_t i = 0; i < dimension_; ++i) {
+                sum[i] += rows[row][i];
+            }
+            ++sizes[row_lists_[row]];
+        }
+        for (size_t list = 0; list < list_count; ++list) {
+            if (sizes[list] > 0) {
+                std::copy(sums.begin() + list * dimension_, sums.begin() + (list + 1) * dimension_,
+                          centroids_.begin() + list * dimension_);
+                normalize(centroids_.data() + list * dimension_);
+            }
+        }
+    }
+
+    for (uint32_t row = 0; row < row_count; ++row) {
+        lists_[row_lists_[row]].push_back(row);
+    }
+}
+
+/**
+ * @brief Находит документы с наибольшим сходством с запросом.
+ * @param query Вектор запроса.
+ * @param count Количество документов.
+ * @param probe_lists Количество просматриваемых списков.
+ * @return Пары (идентификатор документа, сходство) по убыванию сходства.
+ * @throws invalid_argument Если размерность запроса не совпадает с размерностью индекса.
+ */
+std::vector<std::pair<int, float>> VectorIndex::Search(const std::vector<float>& query, size_t count,
+                                                       size_t probe_lists) const {
+    if (query.size() != dimension_) {
+        throw std::invalid_argument("Query embedding dimension mismatch");
+    }
+
+    std::vector<int8_t> query_codes;
+    float query_scale = 1.0f;
+    if (quantize_) {
+        query_codes.resize(dimension_);
+        query_scale = Quantize(query.data(), dimension_, query_codes.data());
+    }
+    const auto similarity = [&](uint32_t row) {
+        if (quantize_) {
+            return static_cast<float>(DotProduct(query_codes.data(), codes_.data() + row * dimension_, dimension_))
+                   * query_scale * scales_[row];
+        }
+        return DotProduct(query.data(), vectors_.data() + row * dimension_, dimension_);
+    };
+
+    std::vector<std::pair<float, uint32_t>> scored;
+    if (lists_.empty()) {
+        scored.reserve(ids_.size());
+        for (uint32_t row = 0; row < ids_.size(); ++row) {
+            scored.emplace_back(similarity(row), row);
+        }
+    } else {
+        // Выбираем списки с центроидами, ближайшими к запросу
+        std::vector<std::pair<float, uint32_t>> list_scores(lists_.size());
+        for (uint32_t list = 0; list < lists_.size(); ++list) {
+            list_scores[list] = {DotProduct(query.data(), centroids_.data() + list * dimension_, dimension_), list};
+        }
+        const size_t probes = std::clamp<size_t>(probe_lists, 1, list_scores.size());
+        std::partial_sort(list_scores.begin(), list_scores.begin() + probes, list_scores.end(),
+                          [](const auto& lhs, const auto& rhs) {
+                              return lhs.first > rhs.first;
+                          });
+        for (size_t probe = 0; probe < probes; ++probe) {
+            for (const uint32_t row : lists_[list_scores[probe].second]) {
+                scored.emplace_back(similarity(row), row);
+            }
+        }
+    }
+
+    const size_t result_count = std::min(count, scored.size());
+    std::partial_sort(scored.begin(), scored.begin() + result_count, scored.end(),
+                      [this](const auto& lhs, const auto& rhs) {
+                          return lhs.first > rhs.first || (lhs.first == rhs.first && ids_[lhs.second] < ids_[rhs.second]);
+                      });
+    std::vector<std::pair<int, float>> result;
+    result.reserve(result_count);
+    for (size_t i = 0; i < result_count; ++i) {
+        result.emplace_back(ids_[scored[i].second], scored[i].first);
+    }
+    return result;
+}
+
+/**
+ * @brief Возвращает размерность векторов.
+ * @return Размерность.
+ */
+size_t VectorIndex::GetDimension() const {
+    return dimension_;
+}
+
+/**
+ * @brief Возвращает количество векторов.
+ * @return Количество векторов.
+ */
+size_t VectorIndex::GetSize() const {
+    return ids_.size();
+}
+
+/**
+ * @brief Возвращает вектор строки в формате float.
+ */
+std::vector<float> VectorIndex::GetRow(uint32_t row) const {
+    if (!quantize_) {
+        return {vectors_.begin() + row * dimension_, vectors_.begin() + (row + 1) * dimension_};
+    }
+    std::vector<float> values(dimension_);
+    for (size_t i = 0; i < dimension_; ++i) {
+        values[i] = codes_[row * dimension_ + i] * scales_[row];
+    }
+    return values;
+}
+
+/**
+ * @brief Находит ближайший центроид.
+ */
+uint32_t VectorIndex::FindNearestList(const float* vector) const {
+    uint32_t nearest = 0;
+    float best_similarity = 0.0f;
+    for (uint32_t list = 0; list < lists_.size(); ++list) {
+        const float similarity = DotProduct(vector, centroids_.data() + list * dimension_, dimension_);
+        if (list == 0 || similarity > best_similarity) {
+            nearest = list;
+            best_similarity = similarity;
+        }
+    }
+    return nearest;
+}
+
+/**
+ * @brief Помещает строку в список.
+ */
+void VectorIndex::AssignRow(uint32_t row, uint32_t list) {
+    row_lists_[row] = list;
+    lists_[list].push_back(row);
+}
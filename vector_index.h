@@ -0,0 +1,133 @@
+/**
+ * @file vector_index.h
+ * @brief Содержит векторный индекс ближайших соседей (IVF) для гибридного поиска.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "document.h"
+
+/**
+ * @brief Параметры гибридного (лексического и векторного) поиска.
+ */
+struct HybridOptions {
+    size_t candidate_count = 100;                       ///< Количество кандидатов от каждого из двух способов поиска.
+    size_t probe_lists = 8;                             ///< Количество просматриваемых списков векторного индекса.
+    double rrf_k = 60.0;                                ///< Константа k слияния Reciprocal Rank Fusion.
+    size_t result_count = MAX_RESULT_DOCUMENT_COUNT;    ///< Количество документов в результате.
+};
+
+/**
+ * @brief Вычисляет скалярное произведение векторов.
+ * @details Цикл развёрнут на 8 независимых сумм, что позволяет компилятору векторизовать его.
+ * @param lhs Первый вектор.
+ * @param rhs Второй вектор.
+ * @param size Размерность.
+ * @return Скалярное произведение.
+ */
+float DotProduct(const float* lhs, const float* rhs, size_t size);
+
+/**
+ * @brief Вычисляет скалярное произведение векторов из 8-битных целых.
+ * @param lhs Первый вектор.
+ * @param rhs Второй вектор.
+ * @param size Размерность.
+ * @return Скалярное произведение.
+ */
+int32_t DotProduct(const int8_t* lhs, const int8_t* rhs, size_t size);
+
+/**
+ * @brief Приближённый индекс ближайших соседей с инвертированными списками (IVF).
+ * @details Векторы хранятся в непрерывном массиве, в формате float или квантованными в int8
+ *          с масштабом на вектор. После вызова Build векторы разбиваются на списки по ближайшему
+ *          центроиду (сферический k-means), и поиск просматривает только ближайшие к запросу списки.
+ *          До вызова Build поиск точный. Сходство - скалярное произведение, поэтому для косинусной
+ *          меры векторы следует нормировать.
+ */
+class VectorIndex {
+public:
+    /**
+     * @brief Конструктор класса VectorIndex.
+     * @param dimension Размерность векторов.
+     * @param quantize Хранить ли векторы квантованными в int8.
+     * @throws invalid_argument Если размерность равна нулю.
+     */
+    VectorIndex(size_t dimension, bool quantize);
+
+    /**
+     * @brief Добавляет или заменяет вектор документа.
+     * @param document_id Идентификатор документа.
+     * @param embedding Вектор документа.
+     * @throws invalid_argument Если размерность вектора не совпадает с размерностью индекса.
+     */
+    void Add(int document_id, const std::vector<float>& embedding);
+
+    /**
+     * @brief Удаляет вектор документа.
+     * @details Место удалённой строки занимает последняя строка, поэтому массивы остаются непрерывными.
+     * @param document_id Идентификатор документа.
+     * @return true, если вектор документа был в индексе.
+     */
+    bool Remove(int document_id);
+
+    /**
+     * @brief Разбивает векторы на списки по центроидам.
+     * @param list_count Количество списков; 0 - корень из количества векторов.
+     * @param iterations Количество итераций k-means.
+     */
+    void Build(size_t list_count = 0, size_t iterations = 10);
+
+    /**
+     * @brief Находит документы с наибольшим сходством с запросом.
+     * @param query Вектор запроса.
+     * @param count Количество документов.
+     * @param probe_lists Количество просматриваемых списков.
+     * @return Пары (идентификатор документа, сходство) по убыванию сходства.
+     * @throws invalid_argument Если размерность запроса не совпадает с размерностью индекса.
+     */
+    std::vector<std::pair<int, float>> Search(const std::vector<float>& query, size_t count, size_t probe_lists) const;
+
+    /**
+     * @brief Возвращает размерность векторов.
+     * @return Размерность.
+     */
+    size_t GetDimension() const;
+
+    /**
+     * @brief Возвращает количество векторов.
+     * @return Количество векторов.
+     */
+    size_t GetSize() const;
+
+private:
+    size_t dimension_;                          ///< Размерность векторов.
+    bool quantize_;                             ///< Хранятся ли векторы в int8.
+    std::vector<int> ids_;                      ///< Идентификаторы документов по строкам.
+    std::map<int, uint32_t> rows_;              ///< Строка каждого документа.
+    std::vector<float> vectors_;                ///< Векторы float построчно.
+    std::vector<int8_t> codes_;                 ///< Квантованные векторы построчно.
+    std::vector<float> scales_;                 ///< Масштабы квантованных векторов.
+    std::vector<float> centroids_;              ///< Центроиды списков построчно.
+    std::vector<std::vector<uint32_t>> lists_;  ///< Строки векторов каждого списка.
+    std::vector<uint32_t> row_lists_;           ///< Список каждой строки.
+
+    /**
+     * @brief Возвращает вектор строки в формате float.
+     */
+    std::vector<float> GetRow(uint32_t row) const;
+
+    /**
+     * @brief Находит ближайший центроид.
+     */
+    uint32_t FindNearestList(const float* vector) const;
+
+    /**
+     * @brief Помещает строку в список.
+     */
+    void AssignRow(uint32_t row, uint32_t list);
+};